@@ -0,0 +1,227 @@
+#ifndef INFERENCE_CODEGEN_HPP
+#define INFERENCE_CODEGEN_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "../network/activation.hpp"
+// Generated by CMake from fast_math_source.hpp.in.
+#include "fast_math_source.hpp"
+
+// Ahead-of-time code generation: writes a standalone C++ source file that
+// computes a trained Network's forward pass with the weights baked in as
+// constexpr arrays. The generated code has no dependency on this library, no
+// virtual dispatch, no allocation and no caching. It needs C++20 when a layer
+// uses the fast or hard math modes, whose kernels it copies from
+// ops/fast_math.hpp. Compile it with NN_GENERATED_MAIN defined to get a small
+// binary that reads the inputs from stdin and prints the outputs.
+
+// Layers up to this many weights are emitted as straight-line code, larger
+// ones as fixed-bound loops that the compiler is free to unroll.
+const size_t kCodegenUnrollLimit = 1024;
+
+// Shortest decimal literal that round-trips to the same float. Infinities
+// and NaNs, which have no literal, are spelled through std::numeric_limits.
+inline std::string float_literal(float value) {
+  if (std::isnan(value)) {
+    return "std::numeric_limits<float>::quiet_NaN()";
+  }
+  if (std::isinf(value)) {
+    return value > 0 ? "std::numeric_limits<float>::infinity()"
+                     : "-std::numeric_limits<float>::infinity()";
+  }
+  char buffer[32];
+  for (int precision = 6; precision <= 9; ++precision) {
+    std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+    if (std::strtof(buffer, nullptr) == value) {
+      break;
+    }
+  }
+  std::string literal = buffer;
+  if (literal.find_first_of(".en") == std::string::npos) {
+    literal += ".0";
+  }
+  return literal + "f";
+}
+
+inline void emit_array(std::ostream& out, const std::string& name,
+                       std::span<const float> values) {
+  out << "alignas(64) constexpr float " << name << "[" << values.size()
+      << "] = {";
+  for (size_t i = 0; i < values.size(); ++i) {
+    out << (i % 4 == 0 ? "\n    " : " ") << float_literal(values[i])
+        << (i + 1 < values.size() ? "," : "");
+  }
+  out << "};\n\n";
+}
+
+// The math mode a layer's activation runs in. Only sigmoid and tanh have
+// more than one.
+template <typename LayerT>
+MathMode activation_math_mode(const LayerT& layer) {
+  if constexpr (requires { layer.activation().math_mode(); }) {
+    return layer.activation().math_mode();
+  } else {
+    return MathMode::kPrecise;
+  }
+}
+
+// Emits `dst` = f(`dst`) with the same maths the activation uses in `mode`.
+inline void emit_activation(std::ostream& out, ActivationKind kind,
+                            MathMode mode, const std::string& dst,
+                            size_t size) {
+  std::string x = dst + "[j]";
+  std::string f;
+  switch (kind) {
+    case ActivationKind::kIdentity:
+      return;
+    case ActivationKind::kReLU:
+      f = x + " > 0.0f ? " + x + " : 0.0f";
+      break;
+    case ActivationKind::kSigmoid:
+      switch (mode) {
+        case MathMode::kPrecise:
+          f = "1.0f / (1.0f + std::exp(-" + x + "))";
+          break;
+        case MathMode::kFast:
+          f = "fast_sigmoid(" + x + ")";
+          break;
+        case MathMode::kHard:
+          f = "hard_sigmoid(" + x + ")";
+          break;
+      }
+      break;
+    case ActivationKind::kTanh:
+      switch (mode) {
+        case MathMode::kPrecise:
+          f = "std::tanh(" + x + ")";
+          break;
+        case MathMode::kFast:
+          f = "fast_tanh(" + x + ")";
+          break;
+        case MathMode::kHard:
+          f = "hard_tanh(" + x + ")";
+          break;
+      }
+      break;
+  }
+  out << "  for (int j = 0; j < " << size << "; ++j) " << x << " = " << f
+      << ";\n";
+}
+
+template <typename LayerT>
+void emit_layer_forward(std::ostream& out, const LayerT& layer, size_t index,
+                        const std::string& src, const std::string& dst) {
+  constexpr size_t In = LayerT::kIn;
+  constexpr size_t Out = LayerT::kOut;
+  std::string weights = "kWeights" + std::to_string(index);
+  std::string biases = "kBiases" + std::to_string(index);
+
+  out << "  // Layer " << index << ": " << In << " -> " << Out << "\n";
+  if (In * Out <= kCodegenUnrollLimit) {
+    for (size_t j = 0; j < Out; ++j) {
+      out << "  " << dst << "[" << j << "] = " << biases << "[" << j << "]";
+      for (size_t i = 0; i < In; ++i) {
+        out << "\n      + " << src << "[" << i << "] * " << weights << "["
+            << i * Out + j << "]";
+      }
+      out << ";\n";
+    }
+  } else {
+    out << "  for (int j = 0; j < " << Out << "; ++j) " << dst << "[j] = "
+        << biases << "[j];\n"
+        << "  for (int i = 0; i < " << In << "; ++i) {\n"
+        << "    const float x = " << src << "[i];\n"
+        << "    for (int j = 0; j < " << Out << "; ++j) " << dst
+        << "[j] += x * " << weights << "[i * " << Out << " + j];\n"
+        << "  }\n";
+  }
+  emit_activation(out, LayerT::kActivation::kKind, activation_math_mode(layer),
+                  dst, Out);
+}
+
+template <typename NetworkT, size_t... LayerNums>
+void emit_inference_source_(NetworkT& network, std::ostream& out,
+                            const std::string& function_name,
+                            std::index_sequence<LayerNums...>) {
+  constexpr size_t kNumLayers = NetworkT::kNumLayers;
+  using FirstLayer = std::remove_reference_t<
+      decltype(network.template get_layer<0>())>;
+  using LastLayer = std::remove_reference_t<
+      decltype(network.template get_layer<kNumLayers - 1>())>;
+
+  out << "// Generated by NNLibrary's inference code generator. Do not edit.\n"
+      << "#include <cmath>\n"
+      << "#include <limits>\n";
+  MathMode modes[] = {
+      activation_math_mode(network.template get_layer<LayerNums>())...};
+  if (std::ranges::any_of(modes, [](MathMode mode) {
+        return mode != MathMode::kPrecise;
+      })) {
+    out << kFastMathSource;
+  }
+  out << "\nnamespace generated {\n\n"
+      << "constexpr int kIn = " << FirstLayer::kIn << ";\n"
+      << "constexpr int kOut = " << LastLayer::kOut << ";\n\n";
+  (emit_array(out, "kWeights" + std::to_string(LayerNums),
+              std::as_const(network.template get_layer<LayerNums>())
+                  .get_weights()),
+   ...);
+  (emit_array(out, "kBiases" + std::to_string(LayerNums),
+              std::as_const(network.template get_layer<LayerNums>())
+                  .get_biases()),
+   ...);
+
+  out << "inline void " << function_name
+      << "(const float* input, float* output) {\n";
+  (
+      [&] {
+        using LayerT = std::remove_reference_t<
+            decltype(network.template get_layer<LayerNums>())>;
+        std::string src =
+            LayerNums == 0 ? "input" : "a" + std::to_string(LayerNums - 1);
+        std::string dst = LayerNums + 1 == kNumLayers
+                              ? "output"
+                              : "a" + std::to_string(LayerNums);
+        if (LayerNums + 1 < kNumLayers) {
+          out << "  alignas(64) float " << dst << "[" << LayerT::kOut
+              << "];\n";
+        }
+        emit_layer_forward(out, network.template get_layer<LayerNums>(),
+                           LayerNums, src, dst);
+      }(),
+      ...);
+  out << "}\n\n"
+      << "}  // namespace generated\n\n"
+      << "#ifdef NN_GENERATED_MAIN\n"
+      << "#include <cstdio>\n\n"
+      << "int main() {\n"
+      << "  float input[generated::kIn];\n"
+      << "  float output[generated::kOut];\n"
+      << "  for (float& x : input) {\n"
+      << "    if (std::scanf(\"%f\", &x) != 1) return 1;\n"
+      << "  }\n"
+      << "  generated::" << function_name << "(input, output);\n"
+      << "  for (float y : output) std::printf(\"%.9g\\n\", y);\n"
+      << "  return 0;\n"
+      << "}\n"
+      << "#endif  // NN_GENERATED_MAIN\n";
+}
+
+// Writes the forward pass of `network` as a function
+//   void generated::<function_name>(const float* input, float* output);
+template <typename NetworkT>
+void emit_inference_source(NetworkT& network, std::ostream& out,
+                           const std::string& function_name = "infer") {
+  emit_inference_source_(network, out, function_name,
+                         std::make_index_sequence<NetworkT::kNumLayers>());
+}
+
+#endif  // INFERENCE_CODEGEN_HPP
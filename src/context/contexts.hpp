@@ -2,8 +2,26 @@
 #define CONTEXTS_HPP
 
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
 
+#include "../tensor/cpu_allocator.hpp"
 #include "devices.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
+
+class Autotuner;
+
+// Accuracy of the transcendental element-wise kernels (sigmoid, tanh).
+enum class MathMode {
+  kPrecise,  // Full float precision.
+  kFast,     // Polynomial/rational approximations, relative error < 1e-4.
+  kHard,     // Piecewise-linear hard sigmoid and hard tanh.
+};
 
 template <DeviceType Device>
 class Context {
@@ -11,7 +29,133 @@ class Context {
   static constexpr DeviceType kDevice = Device;
 };
 
-struct CPUContext : public Context<DeviceType::CPU> {};
+struct CPUContext : public Context<DeviceType::CPU> {
+ public:
+  CPUContext() = default;
+
+  // Topology-aware mode: every tensor created with this context is placed on
+  // `numa_node`, and each worker thread is pinned to one of that node's cores.
+  explicit CPUContext(int numa_node, size_t num_threads = 1)
+      : numa_node_(numa_node) {
+    set_num_threads(num_threads);
+  }
+
+  int numa_node() const { return numa_node_; }
+
+  bool topology_aware() const { return numa_node_ != kAnyNumaNode; }
+
+  size_t num_threads() const { return num_threads_; }
+
+  // Copies of a context share its worker pool. The pool only grows, so
+  // lowering the thread count (e.g. for a tuned kernel) keeps the workers.
+  void set_num_threads(size_t num_threads) {
+    num_threads_ = num_threads > 0 ? num_threads : 1;
+    if (num_threads_ > 1 &&
+        (!pool_ || pool_->num_workers() + 1 < num_threads_)) {
+      pool_ = std::make_shared<ThreadPool>(num_threads_ - 1, worker_cpus_());
+    }
+  }
+
+  // Workers for parallel_for; null while the context is single-threaded.
+  ThreadPool* thread_pool() const { return pool_.get(); }
+
+  // Buffers of at least this many bytes get huge pages; zero disables them.
+  void set_huge_page_threshold(size_t bytes) { huge_page_threshold_ = bytes; }
+
+  StorageOptions storage_options() const {
+    return {.numa_node = numa_node_,
+            .huge_page_threshold = huge_page_threshold_,
+            .tracker = memory_tracker_,
+            .tag = memory_tag_};
+  }
+
+  // When set, every tensor created through this context counts towards the
+  // tracker under the context's current memory tag. Their buffers keep the
+  // tracker alive.
+  void set_memory_tracker(std::shared_ptr<MemoryTracker> tracker) {
+    memory_tracker_ = std::move(tracker);
+  }
+
+  MemoryTracker* memory_tracker() const { return memory_tracker_.get(); }
+
+  // Tag for tensors created from now on; see MemoryTagScope.
+  void set_memory_tag(const MemoryTag& tag) { memory_tag_ = tag; }
+
+  MemoryTag memory_tag() const { return memory_tag_; }
+
+  // When set, matmul and mattranspose use the tuner's per-shape kernel choice
+  // instead of always calling Fastor. The tuner must outlive the context.
+  void set_autotuner(Autotuner* autotuner) { autotuner_ = autotuner; }
+
+  Autotuner* autotuner() const { return autotuner_; }
+
+  // Default accuracy of sigmoid and tanh for every layer built on this
+  // context. Activations constructed with their own MathMode ignore it.
+  void set_math_mode(MathMode mode) { math_mode_ = mode; }
+
+  MathMode math_mode() const { return math_mode_; }
+
+  // Seed for parameter initialisation. Each layer draws its own stream, so
+  // building the same network after set_seed(s) reproduces its weights
+  // exactly.
+  void set_seed(uint64_t seed) {
+    seed_ = seed;
+    next_stream_ = 0;
+  }
+
+  uint64_t seed() const { return seed_; }
+
+  uint64_t next_rng_stream() { return next_stream_++; }
+
+  // Pins the calling thread to the cores of this context's NUMA node. Does
+  // nothing when the context is not topology-aware.
+  void pin_current_thread() const {
+    if (!topology_aware()) {
+      return;
+    }
+    const NumaNode* node = CPUTopology::get().node(numa_node_);
+    if (node != nullptr) {
+      ::pin_current_thread(node->cpus);
+    }
+  }
+
+ private:
+  int numa_node_ = kAnyNumaNode;
+  size_t num_threads_ = 1;
+  size_t huge_page_threshold_ = kHugePageThreshold;
+  Autotuner* autotuner_ = nullptr;
+  MathMode math_mode_ = MathMode::kPrecise;
+  std::shared_ptr<MemoryTracker> memory_tracker_;
+  MemoryTag memory_tag_;
+  uint64_t seed_ = std::random_device()();
+  uint64_t next_stream_ = 0;
+  std::shared_ptr<ThreadPool> pool_;
+
+  std::vector<int> worker_cpus_() const {
+    const NumaNode* node =
+        topology_aware() ? CPUTopology::get().node(numa_node_) : nullptr;
+    return node != nullptr ? node->cpus : std::vector<int>{};
+  }
+};
+
+// Tags the tensors created through `ctx` while it is alive, e.g. temporaries
+// inside a layer's backward pass.
+class MemoryTagScope {
+ public:
+  MemoryTagScope(CPUContext& ctx, const MemoryTag& tag)
+      : ctx_(ctx), previous_(ctx.memory_tag()) {
+    ctx_.set_memory_tag(tag);
+  }
+
+  MemoryTagScope(const MemoryTagScope&) = delete;
+  MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+  ~MemoryTagScope() { ctx_.set_memory_tag(previous_); }
+
+ private:
+  CPUContext& ctx_;
+  MemoryTag previous_;
+};
 
 template <typename T>
 concept ValidContext = std::same_as<T, CPUContext>;
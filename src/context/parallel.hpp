@@ -0,0 +1,50 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "contexts.hpp"
+
+// Rough number of scalar operations below which handing a chunk to another
+// thread costs more than it saves.
+inline constexpr size_t kParallelGrainWork = size_t{1} << 14;
+
+// Grain for parallel_for over items that each take about `work_per_item`
+// scalar operations.
+constexpr size_t parallel_grain(size_t work_per_item) {
+  size_t grain = kParallelGrainWork / std::max<size_t>(1, work_per_item);
+  return std::max<size_t>(1, grain);
+}
+
+// Splits [0, n) into at most ctx.num_threads() contiguous chunks of at least
+// `grain` items and calls fn(begin, end) for each. The calling thread takes
+// the first chunk and the context's pooled workers the rest; when n is below
+// two grains everything runs inline. Chunk boundaries only depend on n, the
+// grain and the thread count.
+template <typename Fn>
+void parallel_for(const CPUContext& ctx, size_t n, size_t grain, Fn&& fn) {
+  size_t num_chunks =
+      std::min(ctx.num_threads(), n / std::max<size_t>(1, grain));
+  ThreadPool* pool = ctx.thread_pool();
+  if (num_chunks <= 1 || pool == nullptr) {
+    fn(size_t{0}, n);
+    return;
+  }
+
+  size_t chunk = (n + num_chunks - 1) / num_chunks;
+  num_chunks = (n + chunk - 1) / chunk;
+  auto job = [&](size_t i) {
+    size_t begin = i * chunk;
+    fn(begin, std::min(begin + chunk, n));
+  };
+  pool->run(num_chunks, job);
+}
+
+template <typename Fn>
+void parallel_for(const CPUContext& ctx, size_t n, Fn&& fn) {
+  parallel_for(ctx, n, 1, std::forward<Fn>(fn));
+}
+
+#endif  // PARALLEL_HPP
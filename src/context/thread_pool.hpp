@@ -0,0 +1,117 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "topology.hpp"
+
+// Fixed set of worker threads that live as long as the pool, so that
+// parallel_for does not create and join threads on every call. Worker i is
+// pinned to cpus[(i + 1) % cpus.size()], leaving cpus[0] for the calling
+// thread; with no cpus the workers are not pinned.
+class ThreadPool {
+ public:
+  ThreadPool(size_t num_workers, const std::vector<int>& cpus) {
+    workers_.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+      int cpu = cpus.empty() ? -1 : cpus[(i + 1) % cpus.size()];
+      workers_.emplace_back([this, i, cpu]() {
+        if (cpu >= 0) {
+          pin_current_thread(std::vector<int>{cpu});
+        }
+        work_(i);
+      });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  size_t num_workers() const { return workers_.size(); }
+
+  // Calls job(i) for every i in [0, num_jobs) and returns once all are done.
+  // Job 0 runs on the calling thread and job i on worker i - 1. A call made
+  // while the pool is busy (from a job, or from another thread) runs all of
+  // its jobs on the calling thread instead, as does one with more jobs than
+  // the pool has threads.
+  template <typename Job>
+  void run(size_t num_jobs, Job& job) {
+    std::unique_lock<std::mutex> batch(batch_mutex_, std::try_to_lock);
+    if (!batch.owns_lock() || num_jobs > workers_.size() + 1) {
+      for (size_t i = 0; i < num_jobs; ++i) {
+        job(i);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      call_ = [](void* job, size_t i) { (*static_cast<Job*>(job))(i); };
+      num_jobs_ = num_jobs;
+      pending_ = num_jobs - 1;
+      ++generation_;
+    }
+    wake_.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+ private:
+  std::vector<std::thread> workers_;
+  // Serialises batches; see run.
+  std::mutex batch_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  void* job_ = nullptr;
+  void (*call_)(void*, size_t) = nullptr;
+  size_t num_jobs_ = 0;
+  size_t pending_ = 0;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+
+  void work_(size_t index) {
+    uint64_t seen = 0;
+    while (true) {
+      void* job;
+      void (*call)(void*, size_t);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+        if (index + 1 >= num_jobs_) {
+          continue;
+        }
+        job = job_;
+        call = call_;
+      }
+      call(job, index + 1);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+};
+
+#endif  // THREAD_POOL_HPP
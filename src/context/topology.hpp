@@ -0,0 +1,102 @@
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Sentinel for "no particular NUMA node", i.e. leave placement to the OS.
+const int kAnyNumaNode = -1;
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+// Parses a sysfs cpu list such as "0-3,8-11" into individual cpu ids.
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    size_t dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// NUMA layout of the machine, read once from sysfs. On systems without sysfs
+// (or without NUMA) this reports no nodes and callers fall back to the
+// default, topology-unaware behaviour.
+class CPUTopology {
+ public:
+  static const CPUTopology& get() {
+    static const CPUTopology topology;
+    return topology;
+  }
+
+  const std::vector<NumaNode>& nodes() const { return nodes_; }
+
+  size_t num_nodes() const { return nodes_.size(); }
+
+  const NumaNode* node(int id) const {
+    for (const NumaNode& node : nodes_) {
+      if (node.id == id) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  std::vector<NumaNode> nodes_;
+
+  CPUTopology() {
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string online_list;
+    if (!online || !std::getline(online, online_list)) {
+      return;
+    }
+    for (int id : parse_cpu_list(online_list)) {
+      std::ifstream cpulist("/sys/devices/system/node/node" +
+                            std::to_string(id) + "/cpulist");
+      std::string cpus;
+      std::getline(cpulist, cpus);
+      nodes_.push_back({id, parse_cpu_list(cpus)});
+    }
+  }
+};
+
+// Restricts the calling thread to the given cpus. Returns false if pinning is
+// unsupported or was refused, in which case the thread is left unchanged.
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+#endif  // TOPOLOGY_HPP
@@ -0,0 +1,38 @@
+#include <stdio.h>
+
+#include <fstream>
+
+#include "codegen/inference_codegen.hpp"
+#include "context/contexts.hpp"
+#include "network/activation.hpp"
+#include "network/layer.hpp"
+#include "network/network.hpp"
+
+// Builds the demo network and writes its forward pass as a standalone source
+// file, which CMake compiles into the demo_inference target.
+int main(int argc, char** argv) {
+  const char* output_path = argc > 1 ? argv[1] : "demo_inference.cpp";
+
+  CPUContext ctx = CPUContext();
+  ctx.set_seed(0);
+
+  ReLUActivation<CPUContext, 4> act1(ctx);
+  ReLULayer<CPUContext, 5, 4> layer1(ctx, act1);
+
+  IdentityActivation<CPUContext, 3> act2(ctx);
+  IdentityLayer<CPUContext, 4, 3> layer2(ctx, act2);
+
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>,
+          ReLULayer<CPUContext, 5, 4>, IdentityLayer<CPUContext, 4, 3> >
+      network(ctx, loss_layer, layer1, layer2);
+
+  std::ofstream out(output_path);
+  if (!out) {
+    fprintf(stderr, "Cannot open %s\n", output_path);
+    return 1;
+  }
+  emit_inference_source(network, out);
+  return 0;
+}
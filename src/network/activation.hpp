@@ -2,11 +2,21 @@
 #define ACTIVATION_HPP
 
 #include <concepts>
+#include <optional>
 
 #include "../context/contexts.hpp"
 #include "../ops/operations.hpp"
 #include "../tensor/tensor.hpp"
 
+// Tags for activations whose maths is known outside their class, e.g. by the
+// runtime Sequential model and the inference code generator.
+enum class ActivationKind {
+  kIdentity,
+  kReLU,
+  kSigmoid,
+  kTanh,
+};
+
 template <ValidContext Context, int Out>
 class Activation {
  public:
@@ -25,6 +35,8 @@ class Activation {
 template <ValidContext Context, int Out>
 class IdentityActivation : public Activation<Context, Out> {
  public:
+  static constexpr ActivationKind kKind = ActivationKind::kIdentity;
+
   explicit IdentityActivation(Context& ctx) : Activation<Context, Out>(ctx) {}
 
   void forward(Tensor<Context, 1, Out>& input,
@@ -41,6 +53,8 @@ class IdentityActivation : public Activation<Context, Out> {
 template <ValidContext Context, int Out>
 class ReLUActivation : public Activation<Context, Out> {
  public:
+  static constexpr ActivationKind kKind = ActivationKind::kReLU;
+
   explicit ReLUActivation(Context& ctx)
       : Activation<Context, Out>(ctx), cached_input_(nullptr) {}
 
@@ -59,41 +73,66 @@ class ReLUActivation : public Activation<Context, Out> {
   Tensor<Context, 1, Out>* cached_input_;
 };
 
+// Sigmoid and tanh follow the context's math mode unless given their own,
+// e.g. to keep one output layer precise in an otherwise fast model.
 template <ValidContext Context, int Out>
 class SigmoidActivation : public Activation<Context, Out> {
  public:
+  static constexpr ActivationKind kKind = ActivationKind::kSigmoid;
+
   explicit SigmoidActivation(Context& ctx)
       : Activation<Context, Out>(ctx), cached_output_(nullptr) {}
 
+  SigmoidActivation(Context& ctx, MathMode mode)
+      : Activation<Context, Out>(ctx), mode_(mode), cached_output_(nullptr) {}
+
   void forward(Tensor<Context, 1, Out>& input,
                Tensor<Context, 1, Out>& output) override {
-    sigmoid(this->ctx_, input, output);
+    sigmoid<1, Out>(this->ctx_, input.get(), output.get(), math_mode());
     cached_output_ = &output;
   }
 
   void backward(Tensor<Context, 1, Out>& grad_a_in,
                 Tensor<Context, 1, Out>& grad_z_out) override {
-    sigmoidPrime(this->ctx_, *cached_output_, grad_a_in, grad_z_out);
+    sigmoidPrime<1, Out>(this->ctx_, cached_output_->get(), grad_a_in.get(),
+                         grad_z_out.get(), math_mode());
   }
 
+  MathMode math_mode() const { return mode_.value_or(this->ctx_.math_mode()); }
+
  private:
+  std::optional<MathMode> mode_;
   Tensor<Context, 1, Out>* cached_output_;
 };
 
 template <ValidContext Context, int Out>
 class TanhActivation : public Activation<Context, Out> {
  public:
-  explicit TanhActivation(Context& ctx) : Activation<Context, Out>(ctx) {}
+  static constexpr ActivationKind kKind = ActivationKind::kTanh;
+
+  explicit TanhActivation(Context& ctx)
+      : Activation<Context, Out>(ctx), cached_output_(nullptr) {}
+
+  TanhActivation(Context& ctx, MathMode mode)
+      : Activation<Context, Out>(ctx), mode_(mode), cached_output_(nullptr) {}
 
   void forward(Tensor<Context, 1, Out>& input,
                Tensor<Context, 1, Out>& output) override {
-    // Tanh implementation
+    tanh<1, Out>(this->ctx_, input.get(), output.get(), math_mode());
+    cached_output_ = &output;
   }
 
   void backward(Tensor<Context, 1, Out>& grad_a_in,
                 Tensor<Context, 1, Out>& grad_z_out) override {
-    // Tanh derivative implementation
+    tanhPrime<1, Out>(this->ctx_, cached_output_->get(), grad_a_in.get(),
+                      grad_z_out.get(), math_mode());
   }
+
+  MathMode math_mode() const { return mode_.value_or(this->ctx_.math_mode()); }
+
+ private:
+  std::optional<MathMode> mode_;
+  Tensor<Context, 1, Out>* cached_output_;
 };
 
 template <typename T, typename Context, int Out>
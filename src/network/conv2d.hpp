@@ -0,0 +1,270 @@
+#ifndef CONV2D_HPP
+#define CONV2D_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <stdexcept>
+
+#include "../ops/operations.hpp"
+#include "activation.hpp"
+#include "uniform_distribution.hpp"
+
+// 2D convolution over a single NHWC image, flattened to a 1 x (H * W * C) row
+// so that it chains through Network like any other layer. The output is the
+// NHWC image OH x OW x Filters. Weights are stored as a (Kernel * Kernel *
+// Channels) x Filters matrix, i.e. HWIO, which matches the im2col column order
+// and makes the convolution a single GEMM.
+template <ValidContext Context, int Height, int Width, int Channels,
+          int Filters, int Kernel, int Stride = 1, int Padding = 0,
+          int Dilation = 1,
+          typename Activation = IdentityActivation<
+              Context, ConvGeometry<Height, Width, Channels, Kernel, Stride,
+                                    Padding, Dilation>::kPositions *
+                           Filters>>
+class Conv2D {
+ public:
+  using Geometry =
+      ConvGeometry<Height, Width, Channels, Kernel, Stride, Padding, Dilation>;
+
+  static constexpr int kPositions = Geometry::kPositions;
+  static constexpr int kPatch = Geometry::kPatch;
+  static constexpr int kIn = Height * Width * Channels;
+  static constexpr int kOut = kPositions * Filters;
+  using kContext = Context;
+  using kActivation = Activation;
+  static_assert(ValidActivation<Activation, Context, kOut>);
+
+  static constexpr bool kIdentityActivation =
+      std::same_as<Activation, IdentityActivation<Context, kOut>>;
+
+  // 1x1 convolutions multiply the input directly and keep no im2col matrix.
+  static constexpr bool kPointwise = Geometry::kPointwise;
+  static constexpr int kColsRows = kPointwise ? 1 : kPositions;
+  static constexpr int kColsCols = kPointwise ? 1 : kPatch;
+  // Output pixels per tile of the im2col matrix.
+  static constexpr int kTile = im2col_tile_rows<Geometry>();
+
+  Conv2D(Context& ctx, Activation& act)
+      : ctx_(ctx),
+        act_(act),
+        weights_(ctx),
+        biases_(ctx),
+        linear_output_(ctx),
+        cols_(ctx),
+        weights_T_(ctx),
+        tile_(ctx),
+        cached_grad_z_(ctx),
+        cached_weights_grad_(ctx),
+        cached_biases_grad_(ctx) {
+    initialise_weights_();
+    initialise_biases_();
+  }
+
+  Conv2D(Context& ctx, Activation& act,
+         UniformDistribution<float>& weight_init_dist)
+      : ctx_(ctx),
+        act_(act),
+        weights_(ctx),
+        biases_(ctx),
+        linear_output_(ctx),
+        cols_(ctx),
+        weights_T_(ctx),
+        tile_(ctx),
+        cached_grad_z_(ctx),
+        cached_weights_grad_(ctx),
+        cached_biases_grad_(ctx) {
+    initialise_weights_from_(weight_init_dist);
+    initialise_biases_();
+  }
+
+  // Outside training, forward keeps only one tile of the im2col matrix and
+  // backward throws (unless pointwise, which keeps no im2col matrix).
+  void set_training(bool training) { training_ = training; }
+
+  bool training() const { return training_; }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  // The input is referenced rather than copied, so it must stay alive and
+  // unchanged until backward.
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    cached_input_ = input;
+    Tensor<Context, 1, kOut>& linear =
+        kIdentityActivation ? output : linear_output_;
+    if constexpr (kPointwise) {
+      float* out = linear.mutable_view().data();
+      matmul(ctx_,
+             ConstTensorView<Context, kPositions, Channels>(input.data()),
+             weights_.view(), TensorView<Context, kPositions, Filters>(out));
+    } else {
+      forward_tiled_(input, linear);
+    }
+    add_bias_rows<kPositions, Filters>(linear.get(), biases_.get());
+    if constexpr (!kIdentityActivation) {
+      act_.forward(linear_output_, output);
+    }
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    if (!kPointwise && !training_) {
+      throw std::logic_error("Conv2D backward needs a training forward");
+    }
+    Tensor<Context, 1, kOut>* grad_z = &grad_a_in;
+    if constexpr (!kIdentityActivation) {
+      act_.backward(grad_a_in, cached_grad_z_);
+      grad_z = &cached_grad_z_;
+    }
+    ConstTensorView<Context, kPositions, Filters> grad_z_matrix(
+        grad_z->view().data());
+    const float* cols =
+        kPointwise ? cached_input_.data() : cols_.view().data();
+
+    // Loss w.r.t biases: column sums of grad_z
+    sum_rows<kPositions, Filters>(grad_z_matrix.get(),
+                                  cached_biases_grad_.get(), accumulate_grads_);
+
+    // Loss w.r.t weights (cols^T * grad_z) and inputs (grad_z * W^T, folded
+    // back onto the image), a tile of output pixels at a time.
+    mattranspose(ctx_, weights_.view(), weights_T_.mutable_view());
+    if constexpr (kPointwise) {
+      matmul(ctx_, grad_z_matrix, weights_T_.view(),
+             TensorView<Context, kPositions, Channels>(
+                 grad_x_out.get().data()));
+    } else {
+      std::ranges::fill(grad_x_out.get(), 0.0f);
+    }
+    constexpr int kRemainder = kPositions % kTile;
+    std::span<float, kIn> grad_x = grad_x_out.get();
+    int first = 0;
+    for (; first + kTile <= kPositions; first += kTile) {
+      backward_tile_<kTile>(first, cols, grad_z_matrix.data(), grad_x,
+                            accumulate_grads_ || first > 0);
+    }
+    if constexpr (kRemainder > 0) {
+      backward_tile_<kRemainder>(first, cols, grad_z_matrix.data(), grad_x,
+                                 accumulate_grads_ || first > 0);
+    }
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(weights_.get(), cached_weights_grad_.get(), learning_rate);
+    sgd_update(biases_.get(), cached_biases_grad_.get(), learning_rate);
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(cached_weights_grad_.get(), 0.0f);
+    std::ranges::fill(cached_biases_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, weights_, biases_);
+    set_memory_tag({owner, MemoryRole::kActivation}, linear_output_, cols_);
+    set_memory_tag({owner, MemoryRole::kGrad}, cached_grad_z_,
+                   cached_weights_grad_, cached_biases_grad_);
+    set_memory_tag({owner, MemoryRole::kScratch}, weights_T_, tile_);
+  }
+
+  std::span<float, kPatch * Filters> get_weights() { return weights_.get(); }
+
+  std::span<float, Filters> get_biases() { return biases_.get(); }
+
+ private:
+  Context& ctx_;
+  Activation act_;
+  Tensor<Context, kPatch, Filters> weights_;
+  Tensor<Context, 1, Filters> biases_;
+  Tensor<Context, 1, kOut> linear_output_;
+  Tensor<Context, kColsRows, kColsCols> cols_;
+  Tensor<Context, Filters, kPatch> weights_T_;
+  // One tile of the transposed im2col matrix or of its gradient.
+  Tensor<Context, kTile, kPatch> tile_;
+  Tensor<Context, 1, kOut> cached_grad_z_;
+  Tensor<Context, kPatch, Filters> cached_weights_grad_;
+  Tensor<Context, 1, Filters> cached_biases_grad_;
+  ConstTensorView<Context, 1, kIn> cached_input_;
+  bool accumulate_grads_ = false;
+  bool training_ = true;
+
+  // Builds the im2col matrix a tile of output pixels at a time and multiplies
+  // each tile while it is still in cache. In training the full matrix is
+  // kept for the weight gradient; otherwise every tile reuses tile_.
+  void forward_tiled_(const ConstTensorView<Context, 1, kIn>& input,
+                      Tensor<Context, 1, kOut>& linear) {
+    constexpr int kRemainder = kPositions % kTile;
+    float* out = linear.mutable_view().data();
+    std::span<const float> in(input.data(), kIn);
+    int first = 0;
+    for (; first + kTile <= kPositions; first += kTile) {
+      forward_tile_<kTile>(in, first, out);
+    }
+    if constexpr (kRemainder > 0) {
+      forward_tile_<kRemainder>(in, first, out);
+    }
+  }
+
+  template <int Rows>
+  void forward_tile_(std::span<const float> in, int first, float* out) {
+    float* cols = training_ ? cols_.mutable_view().data() + first * kPatch
+                            : tile_.mutable_view().data();
+    im2col<Geometry>(ctx_, in, first, Rows,
+                     std::span<float>(cols, Rows * kPatch));
+    matmul(ctx_, TensorView<Context, Rows, kPatch>(cols), weights_.view(),
+           TensorView<Context, Rows, Filters>(out + first * Filters));
+  }
+
+  // Adds the weight gradient of output pixels [first, first + Rows) and,
+  // unless pointwise, folds their input gradient back onto `grad_x`. Both go
+  // through tile_, so backward needs no scratch the size of the im2col
+  // matrix.
+  template <int Rows>
+  void backward_tile_(int first, const float* cols, const float* grad_z,
+                      std::span<float, kIn> grad_x, bool accumulate) {
+    float* tile = tile_.mutable_view().data();
+    ConstTensorView<Context, Rows, Filters> grad_z_tile(grad_z +
+                                                        first * Filters);
+    mattranspose(ctx_,
+                 ConstTensorView<Context, Rows, kPatch>(cols + first * kPatch),
+                 TensorView<Context, kPatch, Rows>(tile));
+    matmul(ctx_, ConstTensorView<Context, kPatch, Rows>(tile), grad_z_tile,
+           cached_weights_grad_.mutable_view(), accumulate);
+    if constexpr (!kPointwise) {
+      matmul(ctx_, grad_z_tile, weights_T_.view(),
+             TensorView<Context, Rows, kPatch>(tile));
+      col2im<Geometry>(ctx_, std::span<const float>(tile, Rows * kPatch),
+                       first, Rows, grad_x);
+    }
+  }
+
+  void initialise_weights_from_(UniformDistribution<float>& dist) {
+    dist.fill(weights_.get());
+  }
+
+  void initialise_weights_() {
+    // Xavier Glorot initialization with the receptive field in both fans
+    float limit = std::sqrt(6.0f / (kPatch + Kernel * Kernel * Filters));
+    PhiloxDistribution dist(ctx_, -limit, limit, ctx_.seed(),
+                            ctx_.next_rng_stream());
+    initialise_weights_from_(dist);
+  }
+
+  void initialise_biases_() { std::ranges::fill(biases_.get(), 0.0f); }
+};
+
+#endif  // CONV2D_HPP
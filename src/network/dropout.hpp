@@ -0,0 +1,85 @@
+#ifndef DROPOUT_HPP
+#define DROPOUT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../ops/operations.hpp"
+
+// Inverted dropout over a row of Size activations: in training mode each
+// element is zeroed with probability `rate` and the survivors are scaled by
+// 1 / (1 - rate), so inference mode is a plain copy. The mask is kept as one
+// bit per element for backward. Every forward call draws a fresh mask from
+// this layer's own Philox stream, so results do not depend on the thread
+// count.
+template <ValidContext Context, int Size>
+class Dropout {
+ public:
+  static constexpr int kIn = Size;
+  static constexpr int kOut = Size;
+  static constexpr int kMaskWords = dropout_mask_words(Size);
+  using kContext = Context;
+
+  explicit Dropout(Context& ctx, float rate = 0.5f)
+      : ctx_(ctx),
+        rate_(rate),
+        stream_(ctx.next_rng_stream()),
+        mask_(kMaskWords) {
+    if (!(rate >= 0.0f && rate < 1.0f)) {
+      throw std::invalid_argument("Dropout rate must be in [0, 1)");
+    }
+  }
+
+  void set_training(bool training) { training_ = training; }
+
+  bool training() const { return training_; }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    if (!training_) {
+      std::ranges::copy(input.get(), output.get().begin());
+      return;
+    }
+    dropout<Size>(ctx_, input.get(), output.get(), mask_, rate_, ctx_.seed(),
+                  stream_, step_ * kMaskWords * kDropoutMaskBits);
+    ++step_;
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    if (!training_) {
+      std::ranges::copy(std::as_const(grad_a_in).get(),
+                        grad_x_out.get().begin());
+      return;
+    }
+    dropout_backward<Size>(ctx_, mask_, rate_, grad_a_in.get(),
+                           grad_x_out.get());
+  }
+
+  void update_parameters(float) {}
+
+  float rate() const { return rate_; }
+
+  // Bit b of word w is set when element 32 * w + b was kept by the last
+  // training-mode forward.
+  std::span<const uint32_t> mask() const { return mask_; }
+
+ private:
+  Context& ctx_;
+  float rate_;
+  uint64_t stream_;
+  uint64_t step_ = 0;
+  bool training_ = true;
+  std::vector<uint32_t> mask_;
+};
+
+#endif  // DROPOUT_HPP
@@ -0,0 +1,163 @@
+#ifndef EMBEDDING_HPP
+#define EMBEDDING_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "../ops/operations.hpp"
+#include "uniform_distribution.hpp"
+
+// Lookup table of Rows embeddings of width Dim. The input is a bag of BagSize
+// row ids, passed as floats so that the layer chains through Network (ids are
+// exact up to 2^24); negative ids are padding. The output is either every
+// looked-up row (kNone) or their sum or mean.
+//
+// Forward gathers only the requested rows and backward produces a
+// SparseRowGrad over only those rows, so a step costs O(BagSize * Dim)
+// however large the table is. update_parameters applies sparse SGD, or lazy
+// Adam once enable_adam has been called.
+template <ValidContext Context, int Rows, int Dim, int BagSize = 1,
+          EmbeddingPooling Pooling = EmbeddingPooling::kNone>
+class Embedding {
+ public:
+  static_assert(Rows <= (1 << 24), "Row ids must be exactly representable");
+
+  static constexpr int kIn = BagSize;
+  static constexpr int kOut =
+      Pooling == EmbeddingPooling::kNone ? BagSize * Dim : Dim;
+  using kContext = Context;
+
+  explicit Embedding(Context& ctx) : ctx_(ctx), table_(ctx) {
+    // N(0, 1) is common for embeddings; a uniform with the same variance
+    // keeps initialisation on the counter-based generator.
+    float limit = std::sqrt(3.0f);
+    PhiloxDistribution dist(ctx_, -limit, limit, ctx_.seed(),
+                            ctx_.next_rng_stream());
+    dist.fill(table_.get());
+  }
+
+  Embedding(Context& ctx, UniformDistribution<float>& weight_init_dist)
+      : ctx_(ctx), table_(ctx) {
+    weight_init_dist.fill(table_.get());
+  }
+
+  // Move-only. A copy would share the table until the first update, which
+  // would then copy all of it; pass the layer to Network with std::move.
+  Embedding(const Embedding&) = delete;
+  Embedding(Embedding&&) = default;
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    std::span<const float, kIn> ids = input.get();
+    for (int b = 0; b < BagSize; ++b) {
+      indices_[b] = static_cast<int>(std::lround(ids[b]));
+      if (indices_[b] >= Rows) {
+        throw std::out_of_range("Embedding row " + std::to_string(indices_[b]) +
+                                " is out of range for " +
+                                std::to_string(Rows) + " rows");
+      }
+    }
+    embedding_bag<Dim>(ctx_, table_.get(), indices_, Pooling, output.get());
+  }
+
+  // Row ids have no gradient, so grad_x_out is zero; the table's gradient is
+  // left in sparse_grad(). When accumulating it covers the union of the rows
+  // touched since the last zero_grad.
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    embedding_bag_backward<Dim>(ctx_, indices_, Pooling, grad_a_in.get(),
+                                grad_, accumulate_grads_);
+    std::ranges::fill(grad_x_out.get(), 0.0f);
+  }
+
+  void update_parameters(float learning_rate) {
+    if (adam_) {
+      lazy_adam_update<Dim>(table_.get(), adam_->first_moments.get(),
+                            adam_->second_moments.get(), grad_.rows,
+                            grad_.values, learning_rate, adam_options_,
+                            ++step_);
+    } else {
+      sparse_sgd_update<Dim>(table_.get(), grad_.rows, grad_.values,
+                             learning_rate);
+    }
+  }
+
+  // Switches update_parameters to lazy Adam. The moment tables are allocated
+  // here, so SGD-only models pay nothing for them.
+  void enable_adam(const AdamOptions& options = AdamOptions()) {
+    adam_options_ = options;
+    MemoryTagScope scope(ctx_,
+                         {table_.memory_tag().owner, MemoryRole::kOptimizer});
+    adam_ = std::make_unique<AdamMoments>(ctx_);
+    std::ranges::fill(adam_->first_moments.get(), 0.0f);
+    std::ranges::fill(adam_->second_moments.get(), 0.0f);
+    step_ = 0;
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    grad_.rows.clear();
+    grad_.values.clear();
+  }
+
+  // Multiplies the gradients by `factor`. Network::step calls it instead of
+  // scaling the learning rate, so that lazy Adam's moments see the mean over
+  // accumulated micro-batches. Only the touched rows hold values.
+  void scale_grad(float factor) {
+    for (float& value : grad_.values) {
+      value *= factor;
+    }
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    table_.set_memory_tag({owner, MemoryRole::kWeights});
+    if (adam_) {
+      set_memory_tag({owner, MemoryRole::kOptimizer}, adam_->first_moments,
+                     adam_->second_moments);
+    }
+  }
+
+  const SparseRowGrad& sparse_grad() const { return grad_; }
+
+  std::span<float, Rows * Dim> get_weights() { return table_.get(); }
+
+ private:
+  struct AdamMoments {
+    explicit AdamMoments(Context& ctx)
+        : first_moments(ctx), second_moments(ctx) {}
+
+    Tensor<Context, Rows, Dim> first_moments;
+    Tensor<Context, Rows, Dim> second_moments;
+  };
+
+  Context& ctx_;
+  Tensor<Context, Rows, Dim> table_;
+  std::array<int, BagSize> indices_{};
+  SparseRowGrad grad_;
+  std::unique_ptr<AdamMoments> adam_;
+  AdamOptions adam_options_;
+  long step_ = 0;
+  bool accumulate_grads_ = false;
+};
+
+#endif  // EMBEDDING_HPP
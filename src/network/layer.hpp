@@ -1,7 +1,11 @@
 #ifndef LAYER_HPP
 #define LAYER_HPP
 
+#include <algorithm>
+#include <cmath>
 #include <concepts>
+#include <optional>
+#include <utility>
 
 #include "../ops/operations.hpp"
 #include "activation.hpp"
@@ -14,12 +18,16 @@ class Layer {
   static constexpr int kIn = In;
   static constexpr int kOut = Out;
   using kContext = Context;
+  using kActivation = Activation;
+
+  static constexpr bool kIdentityActivation =
+      std::same_as<Activation, IdentityActivation<Context, Out>>;
 
   Layer(Context& ctx, Activation& act)
       : ctx_(ctx),
         act_(act),
-        weights_(ctx),
-        biases_(ctx),
+        weights_(std::in_place, ctx),
+        biases_(std::in_place, ctx),
         linear_output_(ctx),
         cached_grad_z_(ctx),
         cached_weights_grad_(ctx),
@@ -32,8 +40,8 @@ class Layer {
         UniformDistribution<float>& weight_init_dist)
       : ctx_(ctx),
         act_(act),
-        weights_(ctx),
-        biases_(ctx),
+        weights_(std::in_place, ctx),
+        biases_(std::in_place, ctx),
         linear_output_(ctx),
         cached_grad_z_(ctx),
         cached_weights_grad_(ctx),
@@ -43,82 +51,197 @@ class Layer {
   }
 
   void forward(Tensor<Context, 1, In>& input, Tensor<Context, 1, Out>& output) {
-    cached_input_ = &input;
-    matmul(ctx_, input, weights_, linear_output_);
-    matadd(ctx_, linear_output_, biases_, linear_output_);
-    act_.forward(linear_output_, output);
+    forward(input.view(), output);
+  }
+
+  // The input is referenced rather than copied, so it must stay alive and
+  // unchanged until backward.
+  void forward(const ConstTensorView<Context, 1, In>& input,
+               Tensor<Context, 1, Out>& output) {
+    cached_input_ = input;
+    if (packed_weights_) {
+      forward_packed_(input, output);
+      return;
+    }
+    if constexpr (kIdentityActivation) {
+      // Nothing to apply, so write the affine output straight into `output`.
+      matmul(ctx_, input, weights_->view(), output.mutable_view());
+      matadd(ctx_, output, *biases_, output);
+    } else {
+      matmul(ctx_, input, weights_->view(), linear_output_.mutable_view());
+      matadd(ctx_, linear_output_, *biases_, linear_output_);
+      act_.forward(linear_output_, output);
+    }
   }
 
   void backward(Tensor<Context, 1, Out>& grad_a_in,
                 Tensor<Context, 1, In>& grad_x_out) {
+    Tensor<Context, 1, Out>* grad_z = &grad_a_in;
+    if constexpr (!kIdentityActivation) {
+      act_.backward(grad_a_in, cached_grad_z_);
+      grad_z = &cached_grad_z_;
+    }
+    // A row vector and its transpose share the same layout, so the
+    // transposes below are just differently shaped views.
+    ConstTensorView<Context, In, 1> input_T(cached_input_.data());
+    ConstTensorView<Context, Out, 1> grad_z_T(grad_z->view().data());
+
     // Loss w.r.t weights
-    act_.backward(grad_a_in, cached_grad_z_);
-    Tensor<Context, In, 1> input_T(ctx_);
-    mattranspose(ctx_, *cached_input_, input_T);
-    matmul(ctx_, input_T, cached_grad_z_, cached_weights_grad_);
+    matmul(ctx_, input_T, grad_z->view(), cached_weights_grad_.mutable_view(),
+           accumulate_grads_);
 
     // Loss w.r.t biases
-    Tensor<Context, 1, 1> ones(ctx_);
-    std::array<std::array<float, 1>, 1> ones_values = {{1.0f}};
-    ones.set(ones_values);
-    matmul(ctx_, ones, cached_grad_z_, cached_biases_grad_);
+    if (accumulate_grads_) {
+      matadd(ctx_, cached_biases_grad_, *grad_z, cached_biases_grad_);
+    } else {
+      std::ranges::copy(grad_z->get(), cached_biases_grad_.get().begin());
+    }
+
+    // Loss w.r.t inputs, as (W * grad_z^T)^T
+    unpack_();
+    matmul(ctx_, weights_->view(), grad_z_T,
+           TensorView<Context, In, 1>(grad_x_out.get().data()));
+  }
 
-    // Loss w.r.t inputs
-    Tensor<Context, Out, In> weights_T(ctx_);
-    mattranspose(ctx_, weights_, weights_T);
-    matmul(ctx_, cached_grad_z_, weights_T, grad_x_out);
+  // Packs the weights and biases once into the panel layout used by
+  // packed_matmul_bias, which forward then uses instead of matmul + matadd.
+  // The unpacked copies are released, so a frozen layer holds its parameters
+  // once. Meant for inference: anything that needs the unpacked parameters
+  // (backward, get_weights(), get_biases()) rebuilds them from the packing,
+  // and calling freeze() again releases them. Updating the parameters, or
+  // writable access to them, drops the packing.
+  void freeze() {
+    if (!packed_weights_) {
+      MemoryTagScope scope(ctx_, {memory_owner_(), MemoryRole::kWeights});
+      packed_weights_.emplace(ctx_);
+      pack_weights(ctx_, *weights_, *biases_, *packed_weights_);
+    }
+    weights_.reset();
+    biases_.reset();
+  }
+
+  void unfreeze() {
+    unpack_();
+    packed_weights_.reset();
   }
 
+  bool frozen() const { return packed_weights_.has_value(); }
+
   void update_parameters(float learning_rate) {
-    // Update weights
-    Tensor<Context, In, Out> scaled_weights_grad(ctx_);
-    matmul(ctx_, learning_rate, cached_weights_grad_, scaled_weights_grad);
-    matadd(ctx_, weights_, scaled_weights_grad, weights_, true);
+    unfreeze();
+    sgd_update(weights_->get(), cached_weights_grad_.get(), learning_rate);
+    sgd_update(biases_->get(), cached_biases_grad_.get(), learning_rate);
+  }
 
-    // Update biases
-    Tensor<Context, 1, Out> scaled_biases_grad(ctx_);
-    matmul(ctx_, learning_rate, cached_biases_grad_, scaled_biases_grad);
-    matadd(ctx_, biases_, scaled_biases_grad, biases_, true);
+  // In accumulate mode backward adds to the parameter gradients instead of
+  // overwriting them, so several micro-batches can be summed before
+  // update_parameters. Turning it on zeroes the gradients, as does zero_grad.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
   }
 
-  std::span<float, In * Out> get_weights() { return weights_.get(); }
+  bool gradient_accumulation() const { return accumulate_grads_; }
 
-  std::span<float, 1 * Out> get_biases() { return biases_.get(); }
+  void zero_grad() {
+    std::ranges::fill(cached_weights_grad_.get(), 0.0f);
+    std::ranges::fill(cached_biases_grad_.get(), 0.0f);
+  }
+
+  // Tags this layer's tensors for the context's MemoryTracker. Network calls
+  // it with the layer's index.
+  void set_memory_owner(int owner) {
+    if (weights_) {
+      set_memory_tag({owner, MemoryRole::kWeights}, *weights_, *biases_);
+    }
+    set_memory_tag({owner, MemoryRole::kActivation}, linear_output_);
+    set_memory_tag({owner, MemoryRole::kGrad}, cached_grad_z_,
+                   cached_weights_grad_, cached_biases_grad_);
+    if (packed_weights_) {
+      packed_weights_->set_memory_tag({owner, MemoryRole::kWeights});
+    }
+  }
+
+  // Writable access unfreezes the layer, since the packing would go stale.
+  std::span<float, In * Out> get_weights() {
+    unfreeze();
+    return weights_->get();
+  }
+
+  // On a frozen layer this rebuilds the unpacked parameters (see freeze).
+  std::span<const float, In * Out> get_weights() const {
+    unpack_();
+    return std::as_const(*weights_).get();
+  }
+
+  std::span<float, 1 * Out> get_biases() {
+    unfreeze();
+    return biases_->get();
+  }
+
+  std::span<const float, 1 * Out> get_biases() const {
+    unpack_();
+    return std::as_const(*biases_).get();
+  }
+
+  const Activation& activation() const { return act_; }
 
  private:
   Context& ctx_;
   Activation act_;
-  Tensor<Context, In, Out> weights_;
-  Tensor<Context, 1, Out> biases_;
+  // Empty while frozen, until something needs them (see unpack_).
+  mutable std::optional<Tensor<Context, In, Out>> weights_;
+  mutable std::optional<Tensor<Context, 1, Out>> biases_;
   Tensor<Context, 1, Out> linear_output_;
   Tensor<Context, 1, Out> cached_grad_z_;
   Tensor<Context, In, Out> cached_weights_grad_;
   Tensor<Context, 1, Out> cached_biases_grad_;
-  Tensor<Context, 1, In>* cached_input_;
+  ConstTensorView<Context, 1, In> cached_input_;
+  std::optional<Tensor<Context, 1, packed_size<In, Out>()>> packed_weights_;
+  bool accumulate_grads_ = false;
 
-  void initialise_weights_from_(UniformDistribution<float>& dist) {
-    std::array<std::array<float, Out>, In> temp_weights;
-    for (size_t i = 0; i < In; ++i) {
-      for (size_t j = 0; j < Out; ++j) {
-        temp_weights[i][j] = dist();
-      }
+  // linear_output_ always exists and is tagged with the same owner.
+  int memory_owner_() const { return linear_output_.memory_tag().owner; }
+
+  // Rebuilds weights_ and biases_ from the packing if freeze released them.
+  void unpack_() const {
+    if (weights_) {
+      return;
+    }
+    MemoryTagScope scope(ctx_, {memory_owner_(), MemoryRole::kWeights});
+    weights_.emplace(ctx_);
+    biases_.emplace(ctx_);
+    unpack_weights(ctx_, *packed_weights_, *weights_, *biases_);
+  }
+
+  void forward_packed_(const ConstTensorView<Context, 1, In>& input,
+                       Tensor<Context, 1, Out>& output) {
+    if constexpr (kIdentityActivation) {
+      packed_matmul_bias(ctx_, input, *packed_weights_, output.mutable_view());
+    } else {
+      packed_matmul_bias(ctx_, input, *packed_weights_,
+                         linear_output_.mutable_view());
+      act_.forward(linear_output_, output);
     }
-    weights_.set(temp_weights);
+  }
+
+  void initialise_weights_from_(UniformDistribution<float>& dist) {
+    dist.fill(weights_->get());
   }
 
   void initialise_weights_() {
     // We use Xavier Glorot initialization for weights
     float limit = std::sqrt(6.0f / (In + Out));
-    StdFloatDistribution dist(-limit, limit);
+    PhiloxDistribution dist(ctx_, -limit, limit, ctx_.seed(),
+                            ctx_.next_rng_stream());
     initialise_weights_from_(dist);
   }
 
   void initialise_biases_() {
-    std::array<std::array<float, Out>, 1> temp_biases;
-    for (size_t i = 0; i < Out; ++i) {
-      temp_biases[0][i] = 0.0f;
-    }
-    biases_.set(temp_biases);
+    std::span<float, Out> biases = biases_->get();
+    std::fill(biases.begin(), biases.end(), 0.0f);
   }
 };
 
@@ -0,0 +1,189 @@
+#ifndef MULTI_HEAD_ATTENTION_HPP
+#define MULTI_HEAD_ATTENTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include "../ops/operations.hpp"
+#include "uniform_distribution.hpp"
+
+// Multi-head self-attention over a sequence of T tokens of width Dim. The
+// input and output are T x Dim sequences flattened to 1 x (T * Dim) rows, so
+// the layer chains through Network like any other. Q, K and V come from one
+// fused Dim x 3 Dim projection GEMM; attention itself is computed tile by tile
+// with an online softmax (see flash_attention), so memory is linear in T.
+// With Causal, token t only attends to tokens 0..t.
+template <ValidContext Context, int T, int Dim, int Heads, bool Causal = false>
+class MultiHeadAttention {
+ public:
+  static_assert(Dim % Heads == 0, "Dim must split evenly across heads");
+
+  static constexpr int kIn = T * Dim;
+  static constexpr int kOut = T * Dim;
+  static constexpr int kHeadDim = Dim / Heads;
+  using kContext = Context;
+
+  explicit MultiHeadAttention(Context& ctx)
+      : ctx_(ctx),
+        qkv_weights_(ctx),
+        qkv_biases_(ctx),
+        out_weights_(ctx),
+        out_biases_(ctx),
+        qkv_weights_grad_(ctx),
+        qkv_biases_grad_(ctx),
+        out_weights_grad_(ctx),
+        out_biases_grad_(ctx),
+        qkv_(ctx),
+        attention_(ctx),
+        lse_(ctx),
+        row_scratch_(ctx),
+        grad_attention_(ctx),
+        grad_qkv_(ctx),
+        input_T_(ctx),
+        attention_T_(ctx),
+        qkv_weights_T_(ctx),
+        out_weights_T_(ctx) {
+    initialise_parameters_();
+  }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  // The input is referenced rather than copied, so it must stay alive and
+  // unchanged until backward.
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    cached_input_ = input;
+    matmul(ctx_, ConstTensorView<Context, T, Dim>(input.data()),
+           qkv_weights_.view(), qkv_.mutable_view());
+    add_bias_rows<T, 3 * Dim>(qkv_.get(), qkv_biases_.get());
+
+    flash_attention<T, Dim, Heads, Causal>(ctx_, qkv_.get(), attention_.get(),
+                                           lse_.get(), row_scratch_.get());
+
+    TensorView<Context, T, Dim> out(output.mutable_view().data());
+    matmul(ctx_, attention_.view(), out_weights_.view(), out);
+    add_bias_rows<T, Dim>(output.get(), out_biases_.get());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    ConstTensorView<Context, T, Dim> grad_out(grad_a_in.view().data());
+
+    // Output projection
+    mattranspose(ctx_, attention_.view(), attention_T_.mutable_view());
+    matmul(ctx_, attention_T_.view(), grad_out,
+           out_weights_grad_.mutable_view(), accumulate_grads_);
+    sum_rows<T, Dim>(grad_a_in.get(), out_biases_grad_.get(),
+                     accumulate_grads_);
+    mattranspose(ctx_, out_weights_.view(), out_weights_T_.mutable_view());
+    matmul(ctx_, grad_out, out_weights_T_.view(),
+           grad_attention_.mutable_view());
+
+    flash_attention_backward<T, Dim, Heads, Causal>(
+        ctx_, qkv_.get(), attention_.get(), lse_.get(), grad_attention_.get(),
+        grad_qkv_.get(), row_scratch_.get());
+
+    // Fused Q | K | V projection
+    ConstTensorView<Context, T, Dim> input(cached_input_.data());
+    mattranspose(ctx_, input, input_T_.mutable_view());
+    matmul(ctx_, input_T_.view(), grad_qkv_.view(),
+           qkv_weights_grad_.mutable_view(), accumulate_grads_);
+    sum_rows<T, 3 * Dim>(grad_qkv_.get(), qkv_biases_grad_.get(),
+                         accumulate_grads_);
+    mattranspose(ctx_, qkv_weights_.view(), qkv_weights_T_.mutable_view());
+    matmul(ctx_, grad_qkv_.view(), qkv_weights_T_.view(),
+           TensorView<Context, T, Dim>(grad_x_out.get().data()));
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(qkv_weights_.get(), qkv_weights_grad_.get(), learning_rate);
+    sgd_update(qkv_biases_.get(), qkv_biases_grad_.get(), learning_rate);
+    sgd_update(out_weights_.get(), out_weights_grad_.get(), learning_rate);
+    sgd_update(out_biases_.get(), out_biases_grad_.get(), learning_rate);
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(qkv_weights_grad_.get(), 0.0f);
+    std::ranges::fill(qkv_biases_grad_.get(), 0.0f);
+    std::ranges::fill(out_weights_grad_.get(), 0.0f);
+    std::ranges::fill(out_biases_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, qkv_weights_, qkv_biases_,
+                   out_weights_, out_biases_);
+    set_memory_tag({owner, MemoryRole::kActivation}, qkv_, attention_, lse_);
+    set_memory_tag({owner, MemoryRole::kGrad}, qkv_weights_grad_,
+                   qkv_biases_grad_, out_weights_grad_, out_biases_grad_,
+                   grad_attention_, grad_qkv_);
+    set_memory_tag({owner, MemoryRole::kScratch}, row_scratch_, input_T_,
+                   attention_T_, qkv_weights_T_, out_weights_T_);
+  }
+
+  // Columns are [Q | K | V], each split into Heads blocks of kHeadDim.
+  std::span<float, Dim * 3 * Dim> get_qkv_weights() {
+    return qkv_weights_.get();
+  }
+
+  std::span<float, 3 * Dim> get_qkv_biases() { return qkv_biases_.get(); }
+
+  std::span<float, Dim * Dim> get_out_weights() { return out_weights_.get(); }
+
+  std::span<float, Dim> get_out_biases() { return out_biases_.get(); }
+
+ private:
+  Context& ctx_;
+  Tensor<Context, Dim, 3 * Dim> qkv_weights_;
+  Tensor<Context, 1, 3 * Dim> qkv_biases_;
+  Tensor<Context, Dim, Dim> out_weights_;
+  Tensor<Context, 1, Dim> out_biases_;
+  Tensor<Context, Dim, 3 * Dim> qkv_weights_grad_;
+  Tensor<Context, 1, 3 * Dim> qkv_biases_grad_;
+  Tensor<Context, Dim, Dim> out_weights_grad_;
+  Tensor<Context, 1, Dim> out_biases_grad_;
+
+  // Activations and scratch, all linear in T.
+  Tensor<Context, T, 3 * Dim> qkv_;
+  Tensor<Context, T, Dim> attention_;
+  Tensor<Context, Heads, T> lse_;
+  // Per-query softmax sums in forward and dO . O in backward.
+  Tensor<Context, Heads, T> row_scratch_;
+  Tensor<Context, T, Dim> grad_attention_;
+  Tensor<Context, T, 3 * Dim> grad_qkv_;
+  Tensor<Context, Dim, T> input_T_;
+  Tensor<Context, Dim, T> attention_T_;
+  Tensor<Context, 3 * Dim, Dim> qkv_weights_T_;
+  Tensor<Context, Dim, Dim> out_weights_T_;
+  ConstTensorView<Context, 1, kIn> cached_input_;
+  bool accumulate_grads_ = false;
+
+  void initialise_parameters_() {
+    // Xavier Glorot initialization, per projection
+    float limit = std::sqrt(6.0f / (Dim + Dim));
+    PhiloxDistribution qkv_dist(ctx_, -limit, limit, ctx_.seed(),
+                                ctx_.next_rng_stream());
+    qkv_dist.fill(qkv_weights_.get());
+    PhiloxDistribution out_dist(ctx_, -limit, limit, ctx_.seed(),
+                                ctx_.next_rng_stream());
+    out_dist.fill(out_weights_.get());
+    std::ranges::fill(qkv_biases_.get(), 0.0f);
+    std::ranges::fill(out_biases_.get(), 0.0f);
+  }
+};
+
+#endif  // MULTI_HEAD_ATTENTION_HPP
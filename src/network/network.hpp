@@ -1,7 +1,9 @@
 #ifndef NETWORK_HPP
 #define NETWORK_HPP
 
+#include <stdexcept>
 #include <tuple>
+#include <utility>
 
 #include "../context/contexts.hpp"
 #include "layer.hpp"
@@ -32,40 +34,214 @@ template <ValidContext Context, int In, int Out,
            (std::tuple_element_t<0, std::tuple<Layers...>>::kIn == In)
 class Network {
  public:
+  // Layers are moved in. A layer passed as an lvalue is copied first, and
+  // the copy shares its tensors with the original until either is written,
+  // so large layers such as Embedding should be handed over with std::move.
   Network(Context& ctx, LossLayer loss_layer, Layers... layers)
       : ctx_(ctx),
         loss_layer_(loss_layer),
-        layers_(layers...),
+        layers_(std::move(layers)...),
         layer_outputs_(Tensor<Context, 1, Layers::kOut>(ctx)...),
-        layer_gradients_(Tensor<Context, 1, Layers::kOut>(ctx)...) {}
+        layer_gradients_(Tensor<Context, 1, Layers::kOut>(ctx)...) {
+    set_memory_owners_(std::index_sequence_for<Layers...>());
+  }
 
   Tensor<Context, 1, Out>& forward(Tensor<Context, 1, In>& input) {
-    std::get<0>(layers_).forward(input, std::get<0>(layer_outputs_));
-    forward_recursive_();
+    return forward(input.view());
+  }
+
+  // Runs a single row without copying it, e.g. batch.row(i) of a larger
+  // batch tensor. The row must stay alive until backward.
+  Tensor<Context, 1, Out>& forward(
+      const ConstTensorView<Context, 1, In>& input) {
+    {
+      MemoryTagScope scope(ctx_, {0, MemoryRole::kScratch});
+      std::get<0>(layers_).forward(input, std::get<0>(layer_outputs_));
+    }
+    if constexpr (kNumLayers > 1) {
+      forward_recursive_();
+    }
     return std::get<kNumLayers - 1>(layer_outputs_);
   }
 
   constexpr void backward(Tensor<Context, 1, Out>& targets) {
     loss_layer_.grad(std::get<kNumLayers - 1>(layer_outputs_), targets,
                      std::get<kNumLayers - 1>(layer_gradients_));
-    backward_recursive_();
+    if constexpr (kNumLayers > 1) {
+      backward_recursive_();
+    } else {
+      MemoryTagScope scope(ctx_, {0, MemoryRole::kScratch});
+      Tensor<Context, 1, In> grad_x(ctx_);
+      std::get<0>(layers_).backward(std::get<0>(layer_gradients_), grad_x);
+    }
+  }
+
+  // Packs every layer's weights for inference (see Layer::freeze).
+  void freeze() {
+    std::apply([](auto&... layers) { (freeze_layer_(layers), ...); }, layers_);
+  }
+
+  // Switches every layer that behaves differently in training and inference
+  // (e.g. BatchNorm) to the given mode.
+  void set_training(bool training) {
+    std::apply(
+        [training](auto&... layers) {
+          (set_layer_training_(layers, training), ...);
+        },
+        layers_);
+  }
+
+  // In accumulate mode every backward adds to the layers' parameter
+  // gradients, so a large batch can be run as several micro-batches and
+  // applied with one step (see Layer::set_gradient_accumulation).
+  void set_gradient_accumulation(bool accumulate) {
+    accumulate_grads_ = accumulate;
+    std::apply(
+        [accumulate](auto&... layers) {
+          (set_layer_gradient_accumulation_(layers, accumulate), ...);
+        },
+        layers_);
+  }
+
+  void zero_grad() {
+    std::apply([](auto&... layers) { (zero_layer_grad_(layers), ...); },
+               layers_);
+  }
+
+  // Updates every layer with the mean of the gradients accumulated over the
+  // last `accumulation_steps` backward passes, then zeroes them. SGD layers
+  // take the mean through the learning rate, learning_rate /
+  // accumulation_steps; layers whose optimizer keeps state (those with
+  // scale_grad, e.g. Embedding's lazy Adam) have their gradients scaled
+  // instead. More than one step needs accumulate mode.
+  void step(float learning_rate, int accumulation_steps = 1) {
+    if (accumulation_steps > 1 && !accumulate_grads_) {
+      throw std::logic_error(
+          "step over several backward passes needs gradient accumulation");
+    }
+    float factor = 1.0f / accumulation_steps;
+    std::apply(
+        [learning_rate, factor](auto&... layers) {
+          (update_layer_(layers, learning_rate, factor), ...);
+        },
+        layers_);
+    zero_grad();
+  }
+
+  // Folds every BatchNorm that directly follows a foldable layer into that
+  // layer's weights (see BatchNorm::fold_into). For inference only. The
+  // folded BatchNorm stays in the network as an identity that still copies
+  // its input to its output, one pass over the activations per fold; the
+  // normalisation arithmetic is what is saved.
+  void fold_batch_norms() {
+    if constexpr (kNumLayers > 1) {
+      fold_batch_norms_(std::make_index_sequence<kNumLayers - 1>());
+    }
   }
 
- private:
   constexpr static size_t kNumLayers = sizeof...(Layers);
+  constexpr static int kIn = In;
+  constexpr static int kOut = Out;
 
+  template <size_t LayerNum>
+  auto& get_layer() {
+    return std::get<LayerNum>(layers_);
+  }
+
+ private:
   Context& ctx_;
   LossLayer loss_layer_;
   std::tuple<Layers...> layers_;
   std::tuple<Tensor<Context, 1, Layers::kOut>...> layer_outputs_;
   std::tuple<Tensor<Context, 1, Layers::kOut>...> layer_gradients_;
+  bool accumulate_grads_ = false;
+
+  // Buffers are tagged with the index of the layer they belong to: the
+  // layer's own tensors, its output and the gradient w.r.t. that output.
+  // Temporaries a layer creates while running are tagged as its scratch.
+  template <size_t... LayerNums>
+  void set_memory_owners_(std::index_sequence<LayerNums...>) {
+    (set_layer_memory_owner_(std::get<LayerNums>(layers_), LayerNums), ...);
+    (std::get<LayerNums>(layer_outputs_)
+         .set_memory_tag({int(LayerNums), MemoryRole::kActivation}),
+     ...);
+    (std::get<LayerNums>(layer_gradients_)
+         .set_memory_tag({int(LayerNums), MemoryRole::kGrad}),
+     ...);
+  }
+
+  template <typename LayerT>
+  static void set_layer_memory_owner_(LayerT& layer, int owner) {
+    if constexpr (requires { layer.set_memory_owner(owner); }) {
+      layer.set_memory_owner(owner);
+    }
+  }
+
+  template <typename LayerT>
+  static void freeze_layer_(LayerT& layer) {
+    if constexpr (requires { layer.freeze(); }) {
+      layer.freeze();
+    }
+  }
+
+  template <typename LayerT>
+  static void set_layer_training_(LayerT& layer, bool training) {
+    if constexpr (requires { layer.set_training(training); }) {
+      layer.set_training(training);
+    }
+  }
+
+  template <typename LayerT>
+  static void set_layer_gradient_accumulation_(LayerT& layer,
+                                               bool accumulate) {
+    if constexpr (requires { layer.set_gradient_accumulation(accumulate); }) {
+      layer.set_gradient_accumulation(accumulate);
+    }
+  }
+
+  template <typename LayerT>
+  static void zero_layer_grad_(LayerT& layer) {
+    if constexpr (requires { layer.zero_grad(); }) {
+      layer.zero_grad();
+    }
+  }
+
+  template <typename LayerT>
+  static void update_layer_(LayerT& layer, float learning_rate,
+                            float factor) {
+    if constexpr (requires { layer.scale_grad(factor); }) {
+      if (factor != 1.0f) {
+        layer.scale_grad(factor);
+      }
+      layer.update_parameters(learning_rate);
+    } else {
+      layer.update_parameters(learning_rate * factor);
+    }
+  }
+
+  template <size_t... LayerNums>
+  void fold_batch_norms_(std::index_sequence<LayerNums...>) {
+    (fold_pair_(std::get<LayerNums>(layers_), std::get<LayerNums + 1>(layers_)),
+     ...);
+  }
+
+  template <typename LayerT, typename NextLayerT>
+  static void fold_pair_(LayerT& layer, NextLayerT& next) {
+    if constexpr (requires { next.fold_into(layer); }) {
+      next.fold_into(layer);
+    }
+  }
 
   // Recursive compile-time forward pass. We handle the first layer separately.
   template <size_t LayerNum = 1>
     requires(LayerNum < kNumLayers) && (LayerNum >= 1)
   void forward_recursive_() {
-    std::get<LayerNum>(layers_).forward(std::get<LayerNum - 1>(layer_outputs_),
-                                        std::get<LayerNum>(layer_outputs_));
+    {
+      MemoryTagScope scope(ctx_, {int(LayerNum), MemoryRole::kScratch});
+      std::get<LayerNum>(layers_).forward(
+          std::get<LayerNum - 1>(layer_outputs_),
+          std::get<LayerNum>(layer_outputs_));
+    }
 
     if constexpr (LayerNum + 1 < kNumLayers) {
       forward_recursive_<LayerNum + 1>();
@@ -76,13 +252,17 @@ class Network {
   template <size_t LayerNum = kNumLayers - 1>
     requires(LayerNum < kNumLayers) && (LayerNum > 0)
   void backward_recursive_() {
-    std::get<LayerNum>(layers_).backward(
-        std::get<LayerNum>(layer_gradients_),
-        std::get<LayerNum - 1>(layer_gradients_));
+    {
+      MemoryTagScope scope(ctx_, {int(LayerNum), MemoryRole::kScratch});
+      std::get<LayerNum>(layers_).backward(
+          std::get<LayerNum>(layer_gradients_),
+          std::get<LayerNum - 1>(layer_gradients_));
+    }
     if constexpr (LayerNum > 1) {
       backward_recursive_<LayerNum - 1>();
     } else {
       // First layer, we do not need to store the gradient w.r.t. input.
+      MemoryTagScope scope(ctx_, {0, MemoryRole::kScratch});
       Tensor<Context, 1, In> grad_x(ctx_);
       std::get<0>(layers_).backward(std::get<0>(layer_gradients_), grad_x);
     }
@@ -0,0 +1,332 @@
+#ifndef NORMALIZATION_HPP
+#define NORMALIZATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "../ops/operations.hpp"
+
+// Normalisation layers. The input row is read as a Rows x Features matrix:
+// Rows is the batch for a dense model, or the pixels of an NHWC image
+// (Features being its channels) after a Conv2D.
+
+// Normalises every feature over the Rows of the input. In training mode it
+// uses the statistics of the current input and updates running estimates; in
+// inference mode it uses the running estimates. With Rows == 1 the training
+// statistics are degenerate, so train dense models with Rows > 1.
+template <ValidContext Context, int Features, int Rows = 1>
+class BatchNorm {
+ public:
+  static constexpr int kFeatures = Features;
+  static constexpr int kIn = Rows * Features;
+  static constexpr int kOut = Rows * Features;
+  using kContext = Context;
+
+  explicit BatchNorm(Context& ctx, float momentum = 0.1f,
+                     float epsilon = 1e-5f)
+      : ctx_(ctx),
+        momentum_(momentum),
+        epsilon_(epsilon),
+        gamma_(ctx),
+        beta_(ctx),
+        running_mean_(ctx),
+        running_var_(ctx),
+        mean_(ctx),
+        var_(ctx),
+        inv_std_(ctx),
+        xhat_(ctx),
+        gamma_grad_(ctx),
+        beta_grad_(ctx) {
+    std::ranges::fill(gamma_.get(), 1.0f);
+    std::ranges::fill(beta_.get(), 0.0f);
+    std::ranges::fill(running_mean_.get(), 0.0f);
+    std::ranges::fill(running_var_.get(), 1.0f);
+  }
+
+  void set_training(bool training) {
+    if (training && folded_) {
+      throw std::logic_error("a folded BatchNorm is inference-only");
+    }
+    training_ = training;
+  }
+
+  bool training() const { return training_; }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    if (folded_) {
+      std::ranges::copy(input.get(), output.get().begin());
+      return;
+    }
+    std::span<float, Features> mean = mean_.get();
+    std::span<float, Features> var = var_.get();
+    std::span<float, Features> inv_std = inv_std_.get();
+    if (training_) {
+      welford_columns<Rows, Features>(ctx_, input.get(), mean, var);
+      update_running_stats_();
+    } else {
+      std::ranges::copy(running_mean_.get(), mean.begin());
+      std::ranges::copy(running_var_.get(), var.begin());
+    }
+    for (int j = 0; j < Features; ++j) {
+      inv_std[j] = 1.0f / std::sqrt(var[j] + epsilon_);
+    }
+    normalize_columns<Rows, Features>(ctx_, input.get(), mean, inv_std,
+                                      gamma_.get(), beta_.get(), xhat_.get(),
+                                      output.get());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    if (folded_) {
+      throw std::logic_error("a folded BatchNorm is inference-only");
+    }
+    if (training_) {
+      batch_norm_backward<Rows, Features>(
+          ctx_, xhat_.get(), inv_std_.get(), gamma_.get(), grad_a_in.get(),
+          grad_x_out.get(), gamma_grad_.get(), beta_grad_.get(),
+          accumulate_grads_);
+      return;
+    }
+    // Fixed statistics make the layer a per-feature affine map.
+    std::span<float, kOut> grad_y = grad_a_in.get();
+    std::span<float, kIn> grad_x = grad_x_out.get();
+    std::span<float, Features> inv_std = inv_std_.get();
+    std::span<float, Features> gamma = gamma_.get();
+    std::span<float, Features> gamma_grad = gamma_grad_.get();
+    std::span<float, Features> beta_grad = beta_grad_.get();
+    if (!accumulate_grads_) {
+      std::ranges::fill(gamma_grad, 0.0f);
+      std::ranges::fill(beta_grad, 0.0f);
+    }
+    std::span<float, kIn> xhat = xhat_.get();
+    for (int i = 0; i < Rows; ++i) {
+      for (int j = 0; j < Features; ++j) {
+        grad_x[i * Features + j] =
+            gamma[j] * inv_std[j] * grad_y[i * Features + j];
+        gamma_grad[j] += grad_y[i * Features + j] * xhat[i * Features + j];
+        beta_grad[j] += grad_y[i * Features + j];
+      }
+    }
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(gamma_.get(), gamma_grad_.get(), learning_rate);
+    sgd_update(beta_.get(), beta_grad_.get(), learning_rate);
+  }
+
+  // Folds the inference-mode normalisation into the weights and biases of
+  // the preceding layer, after which this layer just copies its input and
+  // is inference-only: backward and set_training(true) throw. Works for any
+  // layer with an identity activation whose weight columns each feed a
+  // single feature, i.e. whose column count is a multiple of Features
+  // (Layer, or Conv2D with Filters a multiple of Features). Called by
+  // Network::fold_batch_norms.
+  template <typename LayerT>
+    requires(LayerT::kOut == kIn && LayerT::kIdentityActivation) &&
+            requires(LayerT& layer) {
+              layer.get_weights();
+              layer.get_biases();
+            } &&
+            (decltype(std::declval<LayerT&>().get_biases())::extent %
+                 Features == 0)
+  void fold_into(LayerT& layer) {
+    bool refreeze = false;
+    if constexpr (requires { layer.frozen(); }) {
+      refreeze = layer.frozen();
+    }
+    std::span<float> weights = layer.get_weights();
+    std::span<float> biases = layer.get_biases();
+    std::span<float, Features> gamma = gamma_.get();
+    std::span<float, Features> beta = beta_.get();
+    std::span<float, Features> mean = running_mean_.get();
+    std::span<float, Features> var = running_var_.get();
+    size_t columns = biases.size();
+    for (size_t c = 0; c < columns; ++c) {
+      int j = c % Features;
+      float scale = gamma[j] / std::sqrt(var[j] + epsilon_);
+      for (size_t k = c; k < weights.size(); k += columns) {
+        weights[k] *= scale;
+      }
+      biases[c] = (biases[c] - mean[j]) * scale + beta[j];
+    }
+    if constexpr (requires { layer.freeze(); }) {
+      if (refreeze) {
+        layer.freeze();
+      }
+    }
+    folded_ = true;
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(gamma_grad_.get(), 0.0f);
+    std::ranges::fill(beta_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, gamma_, beta_,
+                   running_mean_, running_var_);
+    set_memory_tag({owner, MemoryRole::kActivation}, mean_, var_, inv_std_,
+                   xhat_);
+    set_memory_tag({owner, MemoryRole::kGrad}, gamma_grad_, beta_grad_);
+  }
+
+  bool folded() const { return folded_; }
+
+  std::span<float, Features> get_gamma() { return gamma_.get(); }
+
+  std::span<float, Features> get_beta() { return beta_.get(); }
+
+  std::span<float, Features> get_running_mean() {
+    return running_mean_.get();
+  }
+
+  std::span<float, Features> get_running_var() { return running_var_.get(); }
+
+ private:
+  Context& ctx_;
+  float momentum_;
+  float epsilon_;
+  bool training_ = true;
+  bool folded_ = false;
+  Tensor<Context, 1, Features> gamma_;
+  Tensor<Context, 1, Features> beta_;
+  Tensor<Context, 1, Features> running_mean_;
+  Tensor<Context, 1, Features> running_var_;
+  Tensor<Context, 1, Features> mean_;
+  Tensor<Context, 1, Features> var_;
+  Tensor<Context, 1, Features> inv_std_;
+  Tensor<Context, Rows, Features> xhat_;
+  Tensor<Context, 1, Features> gamma_grad_;
+  Tensor<Context, 1, Features> beta_grad_;
+  bool accumulate_grads_ = false;
+
+  void update_running_stats_() {
+    // The running variance is unbiased, as the one used at inference should
+    // estimate the population's.
+    float correction = Rows > 1 ? float(Rows) / (Rows - 1) : 1.0f;
+    std::span<float, Features> mean = mean_.get();
+    std::span<float, Features> var = var_.get();
+    std::span<float, Features> running_mean = running_mean_.get();
+    std::span<float, Features> running_var = running_var_.get();
+    for (int j = 0; j < Features; ++j) {
+      running_mean[j] += momentum_ * (mean[j] - running_mean[j]);
+      running_var[j] += momentum_ * (var[j] * correction - running_var[j]);
+    }
+  }
+};
+
+// Normalises every row of the input over its Features. The statistics always
+// come from the input, so training and inference behave the same.
+template <ValidContext Context, int Features, int Rows = 1>
+class LayerNorm {
+ public:
+  static constexpr int kIn = Rows * Features;
+  static constexpr int kOut = Rows * Features;
+  using kContext = Context;
+
+  explicit LayerNorm(Context& ctx, float epsilon = 1e-5f)
+      : ctx_(ctx),
+        epsilon_(epsilon),
+        gamma_(ctx),
+        beta_(ctx),
+        mean_(ctx),
+        inv_std_(ctx),
+        xhat_(ctx),
+        gamma_grad_(ctx),
+        beta_grad_(ctx) {
+    std::ranges::fill(gamma_.get(), 1.0f);
+    std::ranges::fill(beta_.get(), 0.0f);
+  }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    std::span<float, Rows> mean = mean_.get();
+    std::span<float, Rows> inv_std = inv_std_.get();
+    welford_rows<Rows, Features>(ctx_, input.get(), mean, inv_std);
+    for (int i = 0; i < Rows; ++i) {
+      inv_std[i] = 1.0f / std::sqrt(inv_std[i] + epsilon_);
+    }
+    normalize_rows<Rows, Features>(ctx_, input.get(), mean, inv_std,
+                                   gamma_.get(), beta_.get(), xhat_.get(),
+                                   output.get());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    layer_norm_backward<Rows, Features>(
+        ctx_, xhat_.get(), inv_std_.get(), gamma_.get(), grad_a_in.get(),
+        grad_x_out.get(), gamma_grad_.get(), beta_grad_.get(),
+        accumulate_grads_);
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(gamma_.get(), gamma_grad_.get(), learning_rate);
+    sgd_update(beta_.get(), beta_grad_.get(), learning_rate);
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(gamma_grad_.get(), 0.0f);
+    std::ranges::fill(beta_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, gamma_, beta_);
+    set_memory_tag({owner, MemoryRole::kActivation}, mean_, inv_std_, xhat_);
+    set_memory_tag({owner, MemoryRole::kGrad}, gamma_grad_, beta_grad_);
+  }
+
+  std::span<float, Features> get_gamma() { return gamma_.get(); }
+
+  std::span<float, Features> get_beta() { return beta_.get(); }
+
+ private:
+  Context& ctx_;
+  float epsilon_;
+  Tensor<Context, 1, Features> gamma_;
+  Tensor<Context, 1, Features> beta_;
+  Tensor<Context, 1, Rows> mean_;
+  // Holds the variance until forward turns it into 1 / std.
+  Tensor<Context, 1, Rows> inv_std_;
+  Tensor<Context, Rows, Features> xhat_;
+  Tensor<Context, 1, Features> gamma_grad_;
+  Tensor<Context, 1, Features> beta_grad_;
+  bool accumulate_grads_ = false;
+};
+
+#endif  // NORMALIZATION_HPP
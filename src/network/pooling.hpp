@@ -0,0 +1,84 @@
+#ifndef POOLING_HPP
+#define POOLING_HPP
+
+#include "../ops/operations.hpp"
+
+// Pooling layers over a single NHWC image flattened to a 1 x (H * W * C) row,
+// as for Conv2D. They have no parameters, so update_parameters is a no-op.
+
+template <ValidContext Context, int Height, int Width, int Channels, int Pool,
+          int Stride = Pool, int Padding = 0>
+class MaxPool2D {
+ public:
+  using Geometry = ConvGeometry<Height, Width, Channels, Pool, Stride, Padding>;
+
+  static constexpr int kIn = Height * Width * Channels;
+  static constexpr int kOut = Geometry::kPositions * Channels;
+  using kContext = Context;
+
+  explicit MaxPool2D(Context& ctx)
+      : ctx_(ctx), argmax_(ctx.storage_options()) {}
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    max_pool2d<Geometry>(ctx_, input.get(), output.get(), argmax_.get());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    max_pool2d_backward<Geometry>(ctx_, grad_a_in.get(), argmax_.get(),
+                                  grad_x_out.get());
+  }
+
+  void update_parameters(float) {}
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kActivation}, argmax_);
+  }
+
+ private:
+  Context& ctx_;
+  // Input index of each output's maximum, from the last forward.
+  Storage<int, kOut, Context::kDevice> argmax_;
+};
+
+template <ValidContext Context, int Height, int Width, int Channels, int Pool,
+          int Stride = Pool, int Padding = 0>
+class AvgPool2D {
+ public:
+  using Geometry = ConvGeometry<Height, Width, Channels, Pool, Stride, Padding>;
+
+  static constexpr int kIn = Height * Width * Channels;
+  static constexpr int kOut = Geometry::kPositions * Channels;
+  using kContext = Context;
+
+  explicit AvgPool2D(Context& ctx) : ctx_(ctx) {}
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    avg_pool2d<Geometry>(ctx_, input.get(), output.get());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    avg_pool2d_backward<Geometry>(ctx_, grad_a_in.get(), grad_x_out.get());
+  }
+
+  void update_parameters(float) {}
+
+ private:
+  Context& ctx_;
+};
+
+#endif  // POOLING_HPP
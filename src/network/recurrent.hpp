@@ -0,0 +1,458 @@
+#ifndef RECURRENT_HPP
+#define RECURRENT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include "../ops/operations.hpp"
+#include "uniform_distribution.hpp"
+
+// Recurrent layers over a sequence of T timesteps. The input is the T x In
+// sequence flattened to a 1 x (T * In) row and the output is the T x Hidden
+// sequence of hidden states, so they chain through Network like any other
+// layer. The initial hidden (and cell) state is zero.
+//
+// Each step is one matmul of h_{t-1} against the concatenated recurrent
+// weights of every gate, followed by one fused element-wise cell kernel. The
+// input projections of all timesteps are a single T x In GEMM up front, and
+// backprop-through-time collects the per-step gate gradients so that the
+// weight and input gradients are again single GEMMs over the whole sequence.
+
+template <ValidContext Context, int T, int In, int Hidden>
+class LSTM {
+ public:
+  static constexpr int kIn = T * In;
+  static constexpr int kOut = T * Hidden;
+  static constexpr int kGates = 4 * Hidden;
+  using kContext = Context;
+
+  explicit LSTM(Context& ctx)
+      : ctx_(ctx),
+        input_weights_(ctx),
+        recurrent_weights_(ctx),
+        biases_(ctx),
+        input_weights_grad_(ctx),
+        recurrent_weights_grad_(ctx),
+        biases_grad_(ctx),
+        input_proj_(ctx),
+        gates_(ctx),
+        cells_(ctx),
+        states_(ctx),
+        grad_gates_(ctx),
+        grad_h_(ctx),
+        grad_c_(ctx),
+        grad_h_recurrent_(ctx),
+        input_T_(ctx),
+        states_T_(ctx),
+        input_weights_T_(ctx),
+        recurrent_weights_T_(ctx) {
+    initialise_parameters_();
+    // Row 0 holds the initial state and is never written again.
+    std::ranges::fill(cells_.get(), 0.0f);
+    std::ranges::fill(states_.get(), 0.0f);
+  }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  // The input is referenced rather than copied, so it must stay alive and
+  // unchanged until backward.
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    cached_input_ = input;
+    matmul(ctx_, ConstTensorView<Context, T, In>(input.data()),
+           input_weights_.view(), input_proj_.mutable_view());
+    add_bias_rows<T, kGates>(input_proj_.get(), biases_.get());
+
+    float* input_proj = input_proj_.get().data();
+    float* gates = gates_.get().data();
+    float* cells = cells_.get().data();
+    float* states = states_.get().data();
+    for (int t = 0; t < T; ++t) {
+      float* gates_t = gates + t * kGates;
+      matmul(ctx_, TensorView<Context, 1, Hidden>(states + t * Hidden),
+             recurrent_weights_.view(),
+             TensorView<Context, 1, kGates>(gates_t));
+      lstm_cell<Hidden>(ctx_, gates_span_(input_proj + t * kGates),
+                        gates_span_(gates_t), hidden_span_(cells + t * Hidden),
+                        hidden_span_(cells + (t + 1) * Hidden),
+                        hidden_span_(states + (t + 1) * Hidden));
+    }
+    std::copy_n(states + Hidden, kOut, output.get().data());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    mattranspose(ctx_, recurrent_weights_.view(),
+                 recurrent_weights_T_.mutable_view());
+
+    std::span<float, kOut> grad_a = grad_a_in.get();
+    std::span<float, Hidden> grad_h = grad_h_.get();
+    std::span<float, Hidden> grad_c = grad_c_.get();
+    std::span<float, Hidden> grad_h_recurrent = grad_h_recurrent_.get();
+    std::ranges::fill(grad_c, 0.0f);
+    std::ranges::fill(grad_h_recurrent, 0.0f);
+
+    float* gates = gates_.get().data();
+    float* cells = cells_.get().data();
+    float* grad_gates = grad_gates_.get().data();
+    for (int t = T - 1; t >= 0; --t) {
+      for (int j = 0; j < Hidden; ++j) {
+        grad_h[j] = grad_a[t * Hidden + j] + grad_h_recurrent[j];
+      }
+      lstm_cell_backward<Hidden>(
+          ctx_, gates_span_(gates + t * kGates),
+          hidden_span_(cells + t * Hidden),
+          hidden_span_(cells + (t + 1) * Hidden), grad_h, grad_c,
+          gates_span_(grad_gates + t * kGates));
+      matmul(ctx_, TensorView<Context, 1, kGates>(grad_gates + t * kGates),
+             recurrent_weights_T_.view(), grad_h_recurrent_.mutable_view());
+    }
+
+    // Loss w.r.t weights, over the whole sequence at once
+    ConstTensorView<Context, T, In> input(cached_input_.data());
+    mattranspose(ctx_, input, input_T_.mutable_view());
+    matmul(ctx_, input_T_.view(), grad_gates_.view(),
+           input_weights_grad_.mutable_view(), accumulate_grads_);
+    mattranspose(ctx_, states_.template rows<0, T>(),
+                 states_T_.mutable_view());
+    matmul(ctx_, states_T_.view(), grad_gates_.view(),
+           recurrent_weights_grad_.mutable_view(), accumulate_grads_);
+
+    // Loss w.r.t biases
+    sum_rows<T, kGates>(grad_gates_.get(), biases_grad_.get(),
+                        accumulate_grads_);
+
+    // Loss w.r.t inputs
+    mattranspose(ctx_, input_weights_.view(), input_weights_T_.mutable_view());
+    matmul(ctx_, grad_gates_.view(), input_weights_T_.view(),
+           TensorView<Context, T, In>(grad_x_out.get().data()));
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(input_weights_.get(), input_weights_grad_.get(), learning_rate);
+    sgd_update(recurrent_weights_.get(), recurrent_weights_grad_.get(),
+               learning_rate);
+    sgd_update(biases_.get(), biases_grad_.get(), learning_rate);
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(input_weights_grad_.get(), 0.0f);
+    std::ranges::fill(recurrent_weights_grad_.get(), 0.0f);
+    std::ranges::fill(biases_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, input_weights_,
+                   recurrent_weights_, biases_);
+    set_memory_tag({owner, MemoryRole::kActivation}, input_proj_, gates_,
+                   cells_, states_);
+    set_memory_tag({owner, MemoryRole::kGrad}, input_weights_grad_,
+                   recurrent_weights_grad_, biases_grad_, grad_gates_, grad_h_,
+                   grad_c_, grad_h_recurrent_);
+    set_memory_tag({owner, MemoryRole::kScratch}, input_T_, states_T_,
+                   input_weights_T_, recurrent_weights_T_);
+  }
+
+  // Gates are concatenated as [i | f | g | o], each Hidden columns wide.
+  std::span<float, In * kGates> get_input_weights() {
+    return input_weights_.get();
+  }
+
+  std::span<float, Hidden * kGates> get_recurrent_weights() {
+    return recurrent_weights_.get();
+  }
+
+  std::span<float, kGates> get_biases() { return biases_.get(); }
+
+ private:
+  Context& ctx_;
+  Tensor<Context, In, kGates> input_weights_;
+  Tensor<Context, Hidden, kGates> recurrent_weights_;
+  Tensor<Context, 1, kGates> biases_;
+  Tensor<Context, In, kGates> input_weights_grad_;
+  Tensor<Context, Hidden, kGates> recurrent_weights_grad_;
+  Tensor<Context, 1, kGates> biases_grad_;
+
+  // Per-step buffers, allocated once and reused by every forward/backward.
+  Tensor<Context, T, kGates> input_proj_;
+  Tensor<Context, T, kGates> gates_;
+  Tensor<Context, T + 1, Hidden> cells_;
+  Tensor<Context, T + 1, Hidden> states_;
+  Tensor<Context, T, kGates> grad_gates_;
+  Tensor<Context, 1, Hidden> grad_h_;
+  Tensor<Context, 1, Hidden> grad_c_;
+  Tensor<Context, 1, Hidden> grad_h_recurrent_;
+  Tensor<Context, In, T> input_T_;
+  Tensor<Context, Hidden, T> states_T_;
+  Tensor<Context, kGates, In> input_weights_T_;
+  Tensor<Context, kGates, Hidden> recurrent_weights_T_;
+  ConstTensorView<Context, 1, kIn> cached_input_;
+  bool accumulate_grads_ = false;
+
+  static std::span<float, kGates> gates_span_(float* data) {
+    return std::span<float, kGates>(data, kGates);
+  }
+
+  static std::span<float, Hidden> hidden_span_(float* data) {
+    return std::span<float, Hidden>(data, Hidden);
+  }
+
+  void initialise_parameters_() {
+    // U(-1/sqrt(H), 1/sqrt(H)), with the forget gate biased open.
+    float limit = 1.0f / std::sqrt(static_cast<float>(Hidden));
+    PhiloxDistribution input_dist(ctx_, -limit, limit, ctx_.seed(),
+                                  ctx_.next_rng_stream());
+    input_dist.fill(input_weights_.get());
+    PhiloxDistribution recurrent_dist(ctx_, -limit, limit, ctx_.seed(),
+                                      ctx_.next_rng_stream());
+    recurrent_dist.fill(recurrent_weights_.get());
+    std::span<float, kGates> biases = biases_.get();
+    std::ranges::fill(biases, 0.0f);
+    std::fill_n(biases.begin() + Hidden, Hidden, 1.0f);
+  }
+};
+
+template <ValidContext Context, int T, int In, int Hidden>
+class GRU {
+ public:
+  static constexpr int kIn = T * In;
+  static constexpr int kOut = T * Hidden;
+  static constexpr int kGates = 3 * Hidden;
+  using kContext = Context;
+
+  explicit GRU(Context& ctx)
+      : ctx_(ctx),
+        input_weights_(ctx),
+        recurrent_weights_(ctx),
+        biases_(ctx),
+        hidden_biases_(ctx),
+        input_weights_grad_(ctx),
+        recurrent_weights_grad_(ctx),
+        biases_grad_(ctx),
+        hidden_biases_grad_(ctx),
+        input_proj_(ctx),
+        recurrent_(ctx),
+        gates_(ctx),
+        states_(ctx),
+        grad_input_gates_(ctx),
+        grad_recurrent_gates_(ctx),
+        grad_h_(ctx),
+        grad_h_direct_(ctx),
+        grad_h_recurrent_(ctx),
+        input_T_(ctx),
+        states_T_(ctx),
+        input_weights_T_(ctx),
+        recurrent_weights_T_(ctx) {
+    initialise_parameters_();
+    // Row 0 holds the initial state and is never written again.
+    std::ranges::fill(states_.get(), 0.0f);
+  }
+
+  void forward(Tensor<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    forward(input.view(), output);
+  }
+
+  // The input is referenced rather than copied, so it must stay alive and
+  // unchanged until backward.
+  void forward(const ConstTensorView<Context, 1, kIn>& input,
+               Tensor<Context, 1, kOut>& output) {
+    cached_input_ = input;
+    matmul(ctx_, ConstTensorView<Context, T, In>(input.data()),
+           input_weights_.view(), input_proj_.mutable_view());
+    add_bias_rows<T, kGates>(input_proj_.get(), biases_.get());
+
+    float* input_proj = input_proj_.get().data();
+    float* recurrent = recurrent_.get().data();
+    float* gates = gates_.get().data();
+    float* states = states_.get().data();
+    for (int t = 0; t < T; ++t) {
+      float* recurrent_t = recurrent + t * kGates;
+      matmul(ctx_, TensorView<Context, 1, Hidden>(states + t * Hidden),
+             recurrent_weights_.view(),
+             TensorView<Context, 1, kGates>(recurrent_t));
+      gru_cell<Hidden>(ctx_, gates_span_(input_proj + t * kGates),
+                       gates_span_(recurrent_t), hidden_biases_.get(),
+                       hidden_span_(states + t * Hidden),
+                       gates_span_(gates + t * kGates),
+                       hidden_span_(states + (t + 1) * Hidden));
+    }
+    std::copy_n(states + Hidden, kOut, output.get().data());
+  }
+
+  void backward(Tensor<Context, 1, kOut>& grad_a_in,
+                Tensor<Context, 1, kIn>& grad_x_out) {
+    mattranspose(ctx_, recurrent_weights_.view(),
+                 recurrent_weights_T_.mutable_view());
+
+    std::span<float, kOut> grad_a = grad_a_in.get();
+    std::span<float, Hidden> grad_h = grad_h_.get();
+    std::span<float, Hidden> grad_h_direct = grad_h_direct_.get();
+    std::span<float, Hidden> grad_h_recurrent = grad_h_recurrent_.get();
+    std::ranges::fill(grad_h_direct, 0.0f);
+    std::ranges::fill(grad_h_recurrent, 0.0f);
+
+    float* recurrent = recurrent_.get().data();
+    float* gates = gates_.get().data();
+    float* states = states_.get().data();
+    float* grad_input_gates = grad_input_gates_.get().data();
+    float* grad_recurrent_gates = grad_recurrent_gates_.get().data();
+    for (int t = T - 1; t >= 0; --t) {
+      for (int j = 0; j < Hidden; ++j) {
+        grad_h[j] =
+            grad_a[t * Hidden + j] + grad_h_direct[j] + grad_h_recurrent[j];
+      }
+      gru_cell_backward<Hidden>(
+          ctx_, gates_span_(gates + t * kGates),
+          gates_span_(recurrent + t * kGates),
+          hidden_span_(states + t * Hidden), grad_h,
+          gates_span_(grad_input_gates + t * kGates),
+          gates_span_(grad_recurrent_gates + t * kGates), grad_h_direct);
+      matmul(ctx_,
+             TensorView<Context, 1, kGates>(grad_recurrent_gates + t * kGates),
+             recurrent_weights_T_.view(), grad_h_recurrent_.mutable_view());
+    }
+
+    // Loss w.r.t weights, over the whole sequence at once
+    ConstTensorView<Context, T, In> input(cached_input_.data());
+    mattranspose(ctx_, input, input_T_.mutable_view());
+    matmul(ctx_, input_T_.view(), grad_input_gates_.view(),
+           input_weights_grad_.mutable_view(), accumulate_grads_);
+    mattranspose(ctx_, states_.template rows<0, T>(),
+                 states_T_.mutable_view());
+    matmul(ctx_, states_T_.view(), grad_recurrent_gates_.view(),
+           recurrent_weights_grad_.mutable_view(), accumulate_grads_);
+
+    // Loss w.r.t biases
+    sum_rows<T, kGates>(grad_input_gates_.get(), biases_grad_.get(),
+                        accumulate_grads_);
+    sum_rows<T, kGates, 2 * Hidden, Hidden>(grad_recurrent_gates_.get(),
+                                            hidden_biases_grad_.get(),
+                                            accumulate_grads_);
+
+    // Loss w.r.t inputs
+    mattranspose(ctx_, input_weights_.view(), input_weights_T_.mutable_view());
+    matmul(ctx_, grad_input_gates_.view(), input_weights_T_.view(),
+           TensorView<Context, T, In>(grad_x_out.get().data()));
+  }
+
+  void update_parameters(float learning_rate) {
+    sgd_update(input_weights_.get(), input_weights_grad_.get(), learning_rate);
+    sgd_update(recurrent_weights_.get(), recurrent_weights_grad_.get(),
+               learning_rate);
+    sgd_update(biases_.get(), biases_grad_.get(), learning_rate);
+    sgd_update(hidden_biases_.get(), hidden_biases_grad_.get(),
+               learning_rate);
+  }
+
+  // See Layer::set_gradient_accumulation.
+  void set_gradient_accumulation(bool accumulate) {
+    if (accumulate) {
+      zero_grad();
+    }
+    accumulate_grads_ = accumulate;
+  }
+
+  bool gradient_accumulation() const { return accumulate_grads_; }
+
+  void zero_grad() {
+    std::ranges::fill(input_weights_grad_.get(), 0.0f);
+    std::ranges::fill(recurrent_weights_grad_.get(), 0.0f);
+    std::ranges::fill(biases_grad_.get(), 0.0f);
+    std::ranges::fill(hidden_biases_grad_.get(), 0.0f);
+  }
+
+  // See Layer::set_memory_owner.
+  void set_memory_owner(int owner) {
+    set_memory_tag({owner, MemoryRole::kWeights}, input_weights_,
+                   recurrent_weights_, biases_, hidden_biases_);
+    set_memory_tag({owner, MemoryRole::kActivation}, input_proj_, recurrent_,
+                   gates_, states_);
+    set_memory_tag({owner, MemoryRole::kGrad}, input_weights_grad_,
+                   recurrent_weights_grad_, biases_grad_, hidden_biases_grad_,
+                   grad_input_gates_, grad_recurrent_gates_, grad_h_,
+                   grad_h_direct_, grad_h_recurrent_);
+    set_memory_tag({owner, MemoryRole::kScratch}, input_T_, states_T_,
+                   input_weights_T_, recurrent_weights_T_);
+  }
+
+  // Gates are concatenated as [r | z | n], each Hidden columns wide.
+  std::span<float, In * kGates> get_input_weights() {
+    return input_weights_.get();
+  }
+
+  std::span<float, Hidden * kGates> get_recurrent_weights() {
+    return recurrent_weights_.get();
+  }
+
+  std::span<float, kGates> get_biases() { return biases_.get(); }
+
+  // Bias of h_{t-1} * W_hn, which is gated by r.
+  std::span<float, Hidden> get_hidden_biases() { return hidden_biases_.get(); }
+
+ private:
+  Context& ctx_;
+  Tensor<Context, In, kGates> input_weights_;
+  Tensor<Context, Hidden, kGates> recurrent_weights_;
+  Tensor<Context, 1, kGates> biases_;
+  Tensor<Context, 1, Hidden> hidden_biases_;
+  Tensor<Context, In, kGates> input_weights_grad_;
+  Tensor<Context, Hidden, kGates> recurrent_weights_grad_;
+  Tensor<Context, 1, kGates> biases_grad_;
+  Tensor<Context, 1, Hidden> hidden_biases_grad_;
+
+  // Per-step buffers, allocated once and reused by every forward/backward.
+  Tensor<Context, T, kGates> input_proj_;
+  Tensor<Context, T, kGates> recurrent_;
+  Tensor<Context, T, kGates> gates_;
+  Tensor<Context, T + 1, Hidden> states_;
+  Tensor<Context, T, kGates> grad_input_gates_;
+  Tensor<Context, T, kGates> grad_recurrent_gates_;
+  Tensor<Context, 1, Hidden> grad_h_;
+  Tensor<Context, 1, Hidden> grad_h_direct_;
+  Tensor<Context, 1, Hidden> grad_h_recurrent_;
+  Tensor<Context, In, T> input_T_;
+  Tensor<Context, Hidden, T> states_T_;
+  Tensor<Context, kGates, In> input_weights_T_;
+  Tensor<Context, kGates, Hidden> recurrent_weights_T_;
+  ConstTensorView<Context, 1, kIn> cached_input_;
+  bool accumulate_grads_ = false;
+
+  static std::span<float, kGates> gates_span_(float* data) {
+    return std::span<float, kGates>(data, kGates);
+  }
+
+  static std::span<float, Hidden> hidden_span_(float* data) {
+    return std::span<float, Hidden>(data, Hidden);
+  }
+
+  void initialise_parameters_() {
+    // U(-1/sqrt(H), 1/sqrt(H))
+    float limit = 1.0f / std::sqrt(static_cast<float>(Hidden));
+    PhiloxDistribution input_dist(ctx_, -limit, limit, ctx_.seed(),
+                                  ctx_.next_rng_stream());
+    input_dist.fill(input_weights_.get());
+    PhiloxDistribution recurrent_dist(ctx_, -limit, limit, ctx_.seed(),
+                                      ctx_.next_rng_stream());
+    recurrent_dist.fill(recurrent_weights_.get());
+    std::ranges::fill(biases_.get(), 0.0f);
+    std::ranges::fill(hidden_biases_.get(), 0.0f);
+  }
+};
+
+#endif  // RECURRENT_HPP
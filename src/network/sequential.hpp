@@ -0,0 +1,321 @@
+#ifndef SEQUENTIAL_HPP
+#define SEQUENTIAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../context/contexts.hpp"
+#include "../ops/dynamic.hpp"
+#include "../ops/element_wise.hpp"
+#include "../tensor/dynamic_tensor.hpp"
+#include "activation.hpp"
+#include "uniform_distribution.hpp"
+
+// Runtime counterpart of Network: the architecture comes from a text spec
+// instead of template arguments, so a new model only needs a new spec.
+//
+// Spec format, one layer per line, '#' starts a comment:
+//   dense <in> <out> <identity|relu|sigmoid|tanh>
+//
+// Sigmoid and tanh run in the context's math mode.
+
+struct LayerSpec {
+  std::string type;
+  size_t in;
+  size_t out;
+  ActivationKind activation;
+};
+
+inline ActivationKind parse_activation(const std::string& name) {
+  if (name == "identity") {
+    return ActivationKind::kIdentity;
+  }
+  if (name == "relu") {
+    return ActivationKind::kReLU;
+  }
+  if (name == "sigmoid") {
+    return ActivationKind::kSigmoid;
+  }
+  if (name == "tanh") {
+    return ActivationKind::kTanh;
+  }
+  throw std::invalid_argument("Unknown activation: " + name);
+}
+
+inline std::vector<LayerSpec> parse_layer_specs(const std::string& text) {
+  std::vector<LayerSpec> specs;
+  std::stringstream lines(text);
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(lines, line)) {
+    ++line_number;
+    line = line.substr(0, line.find('#'));
+    std::stringstream fields(line);
+    std::string type;
+    if (!(fields >> type)) {
+      continue;
+    }
+    if (type != "dense") {
+      throw std::invalid_argument("Unknown layer type '" + type +
+                                  "' on line " + std::to_string(line_number));
+    }
+    LayerSpec spec{type, 0, 0, ActivationKind::kIdentity};
+    std::string activation;
+    if (!(fields >> spec.in >> spec.out >> activation) || spec.in == 0 ||
+        spec.out == 0) {
+      throw std::invalid_argument("Malformed dense layer on line " +
+                                  std::to_string(line_number));
+    }
+    spec.activation = parse_activation(activation);
+    specs.push_back(spec);
+  }
+  return specs;
+}
+
+// Type-erased layer. Buffers are handed in by Sequential's memory plan, so a
+// layer only owns its parameters.
+class DynamicLayer {
+ public:
+  virtual ~DynamicLayer() = default;
+
+  virtual size_t in() const = 0;
+  virtual size_t out() const = 0;
+
+  // Floats of activation memory the layer needs, in addition to its output.
+  virtual size_t scratch_size() const = 0;
+  virtual void bind(std::span<float> output, std::span<float> scratch) = 0;
+
+  virtual void forward(std::span<const float> input) = 0;
+  virtual void backward(std::span<const float> grad_a_in,
+                        std::span<float> grad_x_out) = 0;
+  virtual void update_parameters(float learning_rate) = 0;
+
+  virtual std::span<float> output() const = 0;
+  virtual std::span<float> weights() = 0;
+  virtual std::span<float> biases() = 0;
+};
+
+class DenseDynamicLayer : public DynamicLayer {
+ public:
+  DenseDynamicLayer(CPUContext& ctx, const LayerSpec& spec)
+      : ctx_(ctx),
+        in_(spec.in),
+        out_(spec.out),
+        activation_(spec.activation),
+        weights_(ctx, spec.in, spec.out),
+        biases_(ctx, 1, spec.out),
+        weights_grad_(ctx, spec.in, spec.out),
+        biases_grad_(ctx, 1, spec.out),
+        forward_matmul_(1, spec.in, spec.out),
+        weights_grad_matmul_(spec.in, 1, spec.out),
+        input_grad_matmul_(spec.in, spec.out, 1) {
+    // Xavier Glorot initialization, as for the compile-time Layer.
+    float limit = std::sqrt(6.0f / (in_ + out_));
+    PhiloxDistribution dist(ctx_, -limit, limit, ctx_.seed(),
+                            ctx_.next_rng_stream());
+    dist.fill(weights_.get());
+    std::ranges::fill(biases_.get(), 0.0f);
+  }
+
+  size_t in() const override { return in_; }
+  size_t out() const override { return out_; }
+
+  // Linear output and grad w.r.t. it.
+  size_t scratch_size() const override { return 2 * out_; }
+
+  void bind(std::span<float> output, std::span<float> scratch) override {
+    output_ = output;
+    linear_output_ = scratch.first(out_);
+    grad_z_ = scratch.subspan(out_, out_);
+  }
+
+  void forward(std::span<const float> input) override {
+    input_ = input;
+    std::span<float> linear =
+        activation_ == ActivationKind::kIdentity ? output_ : linear_output_;
+    forward_matmul_(ctx_, input.data(), weights_.data(), linear.data());
+    dynamic_add(linear, biases_.get(), linear);
+    switch (activation_) {
+      case ActivationKind::kIdentity:
+        break;
+      case ActivationKind::kReLU:
+        ReLU(ctx_, linear, output_);
+        break;
+      case ActivationKind::kSigmoid:
+        sigmoid(ctx_, linear, output_, ctx_.math_mode());
+        break;
+      case ActivationKind::kTanh:
+        tanh(ctx_, linear, output_, ctx_.math_mode());
+        break;
+    }
+  }
+
+  void backward(std::span<const float> grad_a_in,
+                std::span<float> grad_x_out) override {
+    std::span<const float> grad_z = grad_z_;
+    switch (activation_) {
+      case ActivationKind::kIdentity:
+        grad_z = grad_a_in;
+        break;
+      case ActivationKind::kReLU:
+        ReLUPrime(ctx_, linear_output_, grad_a_in, grad_z_);
+        break;
+      case ActivationKind::kSigmoid:
+        sigmoidPrime(ctx_, output_, grad_a_in, grad_z_,
+                     ctx_.math_mode());
+        break;
+      case ActivationKind::kTanh:
+        tanhPrime(ctx_, output_, grad_a_in, grad_z_, ctx_.math_mode());
+        break;
+    }
+
+    // Loss w.r.t weights: input^T (In x 1) * grad_z (1 x Out)
+    weights_grad_matmul_(ctx_, input_.data(), grad_z.data(),
+                         weights_grad_.data());
+
+    // Loss w.r.t biases
+    std::ranges::copy(grad_z, biases_grad_.get().begin());
+
+    // Loss w.r.t inputs: W (In x Out) * grad_z^T (Out x 1)
+    if (!grad_x_out.empty()) {
+      input_grad_matmul_(ctx_, weights_.data(), grad_z.data(),
+                         grad_x_out.data());
+    }
+  }
+
+  void update_parameters(float learning_rate) override {
+    std::span<float> weights = weights_.get();
+    std::span<float> weights_grad = weights_grad_.get();
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights[i] -= learning_rate * weights_grad[i];
+    }
+    std::span<float> biases = biases_.get();
+    std::span<float> biases_grad = biases_grad_.get();
+    for (size_t i = 0; i < biases.size(); ++i) {
+      biases[i] -= learning_rate * biases_grad[i];
+    }
+  }
+
+  std::span<float> output() const override { return output_; }
+  std::span<float> weights() override { return weights_.get(); }
+  std::span<float> biases() override { return biases_.get(); }
+
+ private:
+  CPUContext& ctx_;
+  size_t in_;
+  size_t out_;
+  ActivationKind activation_;
+  DynamicTensor<CPUContext> weights_;
+  DynamicTensor<CPUContext> biases_;
+  DynamicTensor<CPUContext> weights_grad_;
+  DynamicTensor<CPUContext> biases_grad_;
+  // Resolved once here rather than looked up on every call.
+  DynamicMatmul forward_matmul_;
+  DynamicMatmul weights_grad_matmul_;
+  DynamicMatmul input_grad_matmul_;
+  std::span<const float> input_;
+  std::span<float> output_;
+  std::span<float> linear_output_;
+  std::span<float> grad_z_;
+};
+
+class Sequential {
+ public:
+  Sequential(CPUContext& ctx, const std::vector<LayerSpec>& specs)
+      : ctx_(ctx) {
+    if (specs.empty()) {
+      throw std::invalid_argument("A Sequential model needs at least 1 layer");
+    }
+    for (size_t i = 0; i < specs.size(); ++i) {
+      if (i > 0 && specs[i].in != specs[i - 1].out) {
+        throw std::invalid_argument(
+            "Layer " + std::to_string(i) + " expects " +
+            std::to_string(specs[i].in) + " inputs but layer " +
+            std::to_string(i - 1) + " has " +
+            std::to_string(specs[i - 1].out) + " outputs");
+      }
+      layers_.push_back(std::make_unique<DenseDynamicLayer>(ctx, specs[i]));
+    }
+    plan_memory_();
+  }
+
+  static Sequential from_spec(CPUContext& ctx, const std::string& text) {
+    return Sequential(ctx, parse_layer_specs(text));
+  }
+
+  size_t in() const { return layers_.front()->in(); }
+
+  size_t out() const { return layers_.back()->out(); }
+
+  size_t num_layers() const { return layers_.size(); }
+
+  DynamicLayer& layer(size_t i) { return *layers_[i]; }
+
+  // Floats in the activation arena, allocated once at construction.
+  size_t planned_size() const { return arena_.size(); }
+
+  // The input must stay alive until backward.
+  std::span<const float> forward(std::span<const float> input) {
+    if (input.size() != in()) {
+      throw std::invalid_argument("Expected " + std::to_string(in()) +
+                                  " inputs, got " +
+                                  std::to_string(input.size()));
+    }
+    for (std::unique_ptr<DynamicLayer>& layer : layers_) {
+      layer->forward(input);
+      input = layer->output();
+    }
+    return input;
+  }
+
+  // Takes the gradient of the loss w.r.t. the model output.
+  void backward(std::span<const float> grad_output) {
+    for (size_t i = layers_.size(); i-- > 0;) {
+      std::span<float> grad_x =
+          i > 0 ? layer_gradients_[i - 1] : std::span<float>();
+      layers_[i]->backward(grad_output, grad_x);
+      grad_output = grad_x;
+    }
+  }
+
+  void update_parameters(float learning_rate) {
+    for (std::unique_ptr<DynamicLayer>& layer : layers_) {
+      layer->update_parameters(learning_rate);
+    }
+  }
+
+ private:
+  CPUContext& ctx_;
+  std::vector<std::unique_ptr<DynamicLayer>> layers_;
+  DynamicTensor<CPUContext> arena_;
+  std::vector<std::span<float>> layer_gradients_;
+
+  // Lays out every layer's output, scratch and output gradient in a single
+  // allocation so that forward and backward never allocate.
+  void plan_memory_() {
+    size_t total = 0;
+    for (const std::unique_ptr<DynamicLayer>& layer : layers_) {
+      total += 2 * layer->out() + layer->scratch_size();
+    }
+    arena_ = DynamicTensor<CPUContext>(ctx_, 1, total);
+
+    float* next = arena_.data();
+    for (std::unique_ptr<DynamicLayer>& layer : layers_) {
+      std::span<float> output(next, layer->out());
+      next += layer->out();
+      std::span<float> scratch(next, layer->scratch_size());
+      next += layer->scratch_size();
+      layer_gradients_.emplace_back(next, layer->out());
+      next += layer->out();
+      layer->bind(output, scratch);
+    }
+  }
+};
+
+#endif  // SEQUENTIAL_HPP
@@ -0,0 +1,35 @@
+#ifndef TUNING_HPP
+#define TUNING_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../context/contexts.hpp"
+#include "../ops/autotune.hpp"
+#include "../tensor/tensor.hpp"
+
+// Offline tuning step: runs one forward and backward pass of `network` with
+// `tuner` attached and `threads` as the context's thread budget, so that
+// every matmul/mattranspose shape the network uses is tuned for that budget.
+// `ctx` must be the context the network was built with. Its tuner and thread
+// count are restored afterwards; the layers' gradients are overwritten.
+template <typename NetworkT>
+void tune_network(CPUContext& ctx, NetworkT& network, Autotuner& tuner,
+                  size_t threads) {
+  Autotuner* previous_tuner = ctx.autotuner();
+  size_t previous_threads = ctx.num_threads();
+  ctx.set_autotuner(&tuner);
+  ctx.set_num_threads(threads);
+
+  Tensor<CPUContext, 1, NetworkT::kIn> input(ctx);
+  Tensor<CPUContext, 1, NetworkT::kOut> targets(ctx);
+  std::ranges::fill(input.get(), 0.0f);
+  std::ranges::fill(targets.get(), 0.0f);
+  network.forward(input);
+  network.backward(targets);
+
+  ctx.set_autotuner(previous_tuner);
+  ctx.set_num_threads(previous_threads);
+}
+
+#endif  // TUNING_HPP
@@ -1,14 +1,27 @@
 #ifndef UNIFORM_DISTRIBUTION_HPP
 #define UNIFORM_DISTRIBUTION_HPP
 
+#include <cstdint>
 #include <random>
+#include <span>
 #include <type_traits>
 
+#include "../context/contexts.hpp"
+#include "../ops/random.hpp"
+
 template <typename T>
   requires std::is_arithmetic_v<T>
 class UniformDistribution {
  public:
   virtual T operator()() = 0;
+
+  // Fills `out` with consecutive samples. Distributions that can generate in
+  // bulk override this.
+  virtual void fill(std::span<T> out) {
+    for (T& value : out) {
+      value = (*this)();
+    }
+  }
 };
 
 class StdFloatDistribution : public UniformDistribution<float> {
@@ -23,4 +36,39 @@ class StdFloatDistribution : public UniformDistribution<float> {
   std::uniform_real_distribution<float> dist_;
 };
 
-#endif
\ No newline at end of file
+// Counter-based distribution: sample i of (seed, stream) is the same whether
+// drawn one at a time or through fill(), and fill() is parallel over the
+// context's threads without changing the result.
+class PhiloxDistribution : public UniformDistribution<float> {
+ public:
+  PhiloxDistribution(const CPUContext& ctx, float lb, float ub, uint64_t seed,
+                     uint64_t stream = 0)
+      : ctx_(ctx), lb_(lb), ub_(ub), seed_(seed), stream_(stream) {}
+
+  float operator()() override {
+    if (position_ % 4 == 0) {
+      block_ = Philox4x32::generate(seed_, stream_, position_ / 4);
+    }
+    float unit = uint32_to_unit_float(block_[position_++ % 4]);
+    return lb_ + (ub_ - lb_) * unit;
+  }
+
+  void fill(std::span<float> out) override {
+    uniform_fill(ctx_, out, lb_, ub_, seed_, stream_, position_);
+    position_ += out.size();
+    if (position_ % 4 != 0) {
+      block_ = Philox4x32::generate(seed_, stream_, position_ / 4);
+    }
+  }
+
+ private:
+  const CPUContext& ctx_;
+  float lb_;
+  float ub_;
+  uint64_t seed_;
+  uint64_t stream_;
+  uint64_t position_ = 0;
+  Philox4x32::Block block_{};
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef ATTENTION_HPP
+#define ATTENTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <utility>
+
+#include "../context/contexts.hpp"
+#include "../context/parallel.hpp"
+
+// Flash-style scaled dot-product attention over the fused Q | K | V
+// projections of a T-token sequence (a T x 3D row-major matrix, each of Q, K
+// and V split into Heads column blocks of D / Heads). Keys are visited a tile
+// at a time with an online softmax, so the T x T score matrix is never
+// materialised: memory is linear in T.
+
+// Queries and keys per tile. A tile of keys and values plus the scores of a
+// tile of queries against them stay in L1/L2 while they are reused.
+inline constexpr int kAttentionTile = 64;
+
+// CPU implementation. Writes the concatenated per-head outputs (T x D) and,
+// for the backward pass, the logsumexp of every query's scores (Heads x T).
+// (head, query tile) pairs are split across the context's threads. Each task
+// accumulates straight into its own rows of `out`, with the running maxima in
+// `lse` and the running sums in `row_sum`, a Heads x T scratch buffer owned
+// by the caller.
+template <int T, int D, int Heads, bool Causal>
+void flash_attention(CPUContext& ctx,
+                     const std::span<const float, T * 3 * D> qkv,
+                     std::span<float, T * D> out,
+                     std::span<float, Heads * T> lse,
+                     std::span<float, Heads * T> row_sum) {
+  static_assert(D % Heads == 0, "The model width must split evenly by head");
+  constexpr int Dh = D / Heads;
+  constexpr int B = std::min(kAttentionTile, T);
+  constexpr int kQueryTiles = (T + B - 1) / B;
+  constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+  const float scale = 1.0f / std::sqrt(static_cast<float>(Dh));
+
+  parallel_for(ctx, Heads * kQueryTiles, [&](size_t begin, size_t end) {
+    float scores[B];
+    for (size_t task = begin; task < end; ++task) {
+      int h = task / kQueryTiles;
+      int q0 = task % kQueryTiles * B;
+      int qn = std::min(B, T - q0);
+      int key_end = Causal ? q0 + qn : T;
+      float* row_max = lse.data() + h * T + q0;
+      float* sum = row_sum.data() + h * T + q0;
+      std::fill_n(row_max, qn, kNegInf);
+      std::fill_n(sum, qn, 0.0f);
+      for (int i = 0; i < qn; ++i) {
+        std::fill_n(out.data() + (q0 + i) * D + h * Dh, Dh, 0.0f);
+      }
+
+      for (int k0 = 0; k0 < key_end; k0 += B) {
+        int kn = std::min(B, key_end - k0);
+        for (int i = 0; i < qn; ++i) {
+          const float* q = qkv.data() + (q0 + i) * 3 * D + h * Dh;
+          float tile_max = kNegInf;
+          for (int j = 0; j < kn; ++j) {
+            if (Causal && k0 + j > q0 + i) {
+              scores[j] = kNegInf;
+              continue;
+            }
+            const float* k = qkv.data() + (k0 + j) * 3 * D + D + h * Dh;
+            float dot = 0.0f;
+            for (int d = 0; d < Dh; ++d) {
+              dot += q[d] * k[d];
+            }
+            scores[j] = dot * scale;
+            tile_max = std::max(tile_max, scores[j]);
+          }
+          if (tile_max == kNegInf) {
+            continue;
+          }
+
+          // Rescale what has been accumulated so far to the new maximum.
+          float new_max = std::max(row_max[i], tile_max);
+          float correction = std::exp(row_max[i] - new_max);
+          row_max[i] = new_max;
+          sum[i] *= correction;
+          float* a = out.data() + (q0 + i) * D + h * Dh;
+          for (int d = 0; d < Dh; ++d) {
+            a[d] *= correction;
+          }
+          for (int j = 0; j < kn; ++j) {
+            float p = std::exp(scores[j] - new_max);
+            sum[i] += p;
+            const float* v = qkv.data() + (k0 + j) * 3 * D + 2 * D + h * Dh;
+            for (int d = 0; d < Dh; ++d) {
+              a[d] += p * v[d];
+            }
+          }
+        }
+      }
+
+      for (int i = 0; i < qn; ++i) {
+        float* o = out.data() + (q0 + i) * D + h * Dh;
+        float inv_sum = 1.0f / sum[i];
+        for (int d = 0; d < Dh; ++d) {
+          o[d] *= inv_sum;
+        }
+        row_max[i] += std::log(sum[i]);
+      }
+    }
+  });
+}
+
+// CPU implementation of the backward pass. The attention probabilities are
+// recomputed a tile at a time from Q, K and the saved logsumexp instead of
+// being stored. The work is split into tasks that each own a disjoint part of
+// `grad_qkv`, so no thread ever adds into another's rows:
+//   1. (head, key tile): the dK and dV rows of the tile's keys, from every
+//      query that sees them.
+//   2. (head, query tile): the dQ rows of the tile's queries, from every key
+//      they see.
+// The second pass recomputes the probabilities of the first rather than
+// sharing dQ partials between threads. `delta` is a Heads x T scratch buffer
+// owned by the caller.
+template <int T, int D, int Heads, bool Causal>
+void flash_attention_backward(CPUContext& ctx,
+                              const std::span<const float, T * 3 * D> qkv,
+                              const std::span<const float, T * D> out,
+                              const std::span<const float, Heads * T> lse,
+                              const std::span<const float, T * D> grad_out,
+                              std::span<float, T * 3 * D> grad_qkv,
+                              std::span<float, Heads * T> delta) {
+  constexpr int Dh = D / Heads;
+  constexpr int B = std::min(kAttentionTile, T);
+  constexpr int kTiles = (T + B - 1) / B;
+  const float scale = 1.0f / std::sqrt(static_cast<float>(Dh));
+
+  // delta_i = dO_i . O_i, the softmax Jacobian's correction term.
+  constexpr size_t kDeltaGrain = parallel_grain(Dh);
+  parallel_for(ctx, Heads * T, kDeltaGrain, [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) {
+      int h = row / T;
+      int i = row % T;
+      const float* o = out.data() + i * D + h * Dh;
+      const float* go = grad_out.data() + i * D + h * Dh;
+      float sum = 0.0f;
+      for (int d = 0; d < Dh; ++d) {
+        sum += o[d] * go[d];
+      }
+      delta[row] = sum;
+    }
+  });
+
+  // Probability and score gradient of query i against key `key` of head h.
+  auto probability = [&](int h, int i, int key) {
+    const float* q = qkv.data() + i * 3 * D + h * Dh;
+    const float* k = qkv.data() + key * 3 * D + D + h * Dh;
+    const float* v = qkv.data() + key * 3 * D + 2 * D + h * Dh;
+    const float* go = grad_out.data() + i * D + h * Dh;
+    float dot = 0.0f;
+    float grad_p = 0.0f;
+    for (int d = 0; d < Dh; ++d) {
+      dot += q[d] * k[d];
+      grad_p += go[d] * v[d];
+    }
+    float p = std::exp(dot * scale - lse[h * T + i]);
+    return std::pair(p, p * (grad_p - delta[h * T + i]) * scale);
+  };
+
+  parallel_for(ctx, Heads * kTiles, [&](size_t begin, size_t end) {
+    for (size_t task = begin; task < end; ++task) {
+      int h = task / kTiles;
+      int k0 = task % kTiles * B;
+      int kn = std::min(B, T - k0);
+      for (int j = 0; j < kn; ++j) {
+        float* gk = grad_qkv.data() + (k0 + j) * 3 * D + D + h * Dh;
+        std::fill_n(gk, Dh, 0.0f);
+        std::fill_n(gk + D, Dh, 0.0f);
+      }
+      // With a causal mask, queries before the tile's first key see none of
+      // its keys.
+      for (int i = Causal ? k0 : 0; i < T; ++i) {
+        const float* q = qkv.data() + i * 3 * D + h * Dh;
+        const float* go = grad_out.data() + i * D + h * Dh;
+        int j_end = Causal ? std::min(kn, i - k0 + 1) : kn;
+        for (int j = 0; j < j_end; ++j) {
+          auto [p, grad_s] = probability(h, i, k0 + j);
+          float* gk = grad_qkv.data() + (k0 + j) * 3 * D + D + h * Dh;
+          float* gv = gk + D;
+          for (int d = 0; d < Dh; ++d) {
+            gv[d] += p * go[d];
+            gk[d] += grad_s * q[d];
+          }
+        }
+      }
+    }
+  });
+
+  parallel_for(ctx, Heads * kTiles, [&](size_t begin, size_t end) {
+    for (size_t task = begin; task < end; ++task) {
+      int h = task / kTiles;
+      int q0 = task % kTiles * B;
+      int qn = std::min(B, T - q0);
+      for (int i = q0; i < q0 + qn; ++i) {
+        float* gq = grad_qkv.data() + i * 3 * D + h * Dh;
+        std::fill_n(gq, Dh, 0.0f);
+        int key_end = Causal ? i + 1 : T;
+        for (int key = 0; key < key_end; ++key) {
+          float grad_s = probability(h, i, key).second;
+          const float* k = qkv.data() + key * 3 * D + D + h * Dh;
+          for (int d = 0; d < Dh; ++d) {
+            gq[d] += grad_s * k[d];
+          }
+        }
+      }
+    }
+  });
+}
+
+#endif  // ATTENTION_HPP
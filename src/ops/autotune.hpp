@@ -0,0 +1,277 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gemm.hpp"
+
+enum class Kernel {
+  kFastor,
+  kBlocked,
+};
+
+struct KernelConfig {
+  Kernel kernel = Kernel::kFastor;
+  size_t threads = 1;
+  GemmTiles tiles;
+};
+
+using KernelRunner = std::function<void(const KernelConfig&)>;
+
+// Picks the fastest kernel per (operation, shape) by benchmarking candidates
+// the first time a shape is seen. Results are kept per CPU model in an on-disk
+// cache so that identical machines only tune once.
+//
+// Cache file format, one entry per line:
+//   <cpu model>\t<op key>\t<kernel> <threads> <tile m> <tile k> <tile n>
+class Autotuner {
+ public:
+  Autotuner() : cpu_model_(detect_cpu_model()), stamp_(next_stamp_()) {}
+
+  // Loads any entries for this CPU model from `cache_path`, and saves newly
+  // tuned entries back to it.
+  explicit Autotuner(std::string cache_path)
+      : cpu_model_(detect_cpu_model()),
+        cache_path_(std::move(cache_path)),
+        stamp_(next_stamp_()) {
+    load(cache_path_);
+  }
+
+  static std::string detect_cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+      if (line.rfind("model name", 0) == 0) {
+        size_t colon = line.find(':');
+        return colon == std::string::npos ? line : line.substr(colon + 2);
+      }
+    }
+    return "unknown";
+  }
+
+  const std::string& cpu_model() const { return cpu_model_; }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return configs_.size();
+  }
+
+  // Changes whenever the entries do, and is never the same for two tuners, so
+  // a caller may keep a looked-up config for as long as the stamp holds (see
+  // TunedKernelCache). Never zero.
+  uint64_t stamp() const { return stamp_.load(std::memory_order_acquire); }
+
+  std::optional<KernelConfig> lookup(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = configs_.find(key);
+    if (it == configs_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  void record(const std::string& key, const KernelConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    configs_[key] = config;
+    stamp_.store(next_stamp_(), std::memory_order_release);
+  }
+
+  // Benchmarks every candidate through `run` and records the fastest for
+  // `key`, persisting it if the tuner has a cache file.
+  KernelConfig tune(const std::string& key,
+                    const std::vector<KernelConfig>& candidates,
+                    const KernelRunner& run) {
+    KernelConfig best = candidates.front();
+    double best_time = std::numeric_limits<double>::max();
+    for (const KernelConfig& candidate : candidates) {
+      double time = benchmark_(candidate, run);
+      if (time < best_time) {
+        best_time = time;
+        best = candidate;
+      }
+    }
+
+    record(key, best);
+    if (!cache_path_.empty()) {
+      save(cache_path_);
+    }
+    return best;
+  }
+
+  bool load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string line;
+    while (std::getline(file, line)) {
+      std::stringstream ss(line);
+      std::string model, key, values;
+      if (!std::getline(ss, model, '\t') || !std::getline(ss, key, '\t') ||
+          !std::getline(ss, values) || model != cpu_model_) {
+        continue;
+      }
+      std::stringstream vs(values);
+      int kernel;
+      KernelConfig config;
+      if (vs >> kernel >> config.threads >> config.tiles.m >> config.tiles.k >>
+          config.tiles.n) {
+        config.kernel = static_cast<Kernel>(kernel);
+        configs_[key] = config;
+      }
+    }
+    stamp_.store(next_stamp_(), std::memory_order_release);
+    return true;
+  }
+
+  // Writes our entries to `path`, keeping entries for other CPU models that
+  // are already there. The file is written under a temporary name and renamed
+  // over `path`, so a reader never sees it half-written.
+  bool save(const std::string& path) const {
+    std::vector<std::string> other_models;
+    std::ifstream existing(path);
+    std::string line;
+    while (std::getline(existing, line)) {
+      if (line.rfind(cpu_model_ + '\t', 0) != 0) {
+        other_models.push_back(line);
+      }
+    }
+    existing.close();
+
+    std::string temp_path = path + ".tmp";
+    std::ofstream file(temp_path, std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    for (const std::string& other : other_models) {
+      file << other << '\n';
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [key, config] : configs_) {
+      file << cpu_model_ << '\t' << key << '\t'
+           << static_cast<int>(config.kernel) << ' ' << config.threads << ' '
+           << config.tiles.m << ' ' << config.tiles.k << ' ' << config.tiles.n
+           << '\n';
+    }
+    file.close();
+    if (!file || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+      std::remove(temp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::string cpu_model_;
+  std::string cache_path_;
+  std::map<std::string, KernelConfig> configs_;
+  mutable std::mutex mutex_;
+  std::atomic<uint64_t> stamp_;
+
+  static uint64_t next_stamp_() {
+    static std::atomic<uint64_t> counter = 0;
+    return ++counter;
+  }
+
+  // Best-of-N wall time in seconds. One untimed warm-up run, then repeat until
+  // we have a few samples and have spent at least a millisecond.
+  static double benchmark_(const KernelConfig& config,
+                           const KernelRunner& run) {
+    using Clock = std::chrono::steady_clock;
+    run(config);
+    double best = std::numeric_limits<double>::max();
+    double total = 0.0;
+    for (int i = 0; i < 5 || (total < 1e-3 && i < 1000); ++i) {
+      auto start = Clock::now();
+      run(config);
+      double time = std::chrono::duration<double>(Clock::now() - start).count();
+      best = std::min(best, time);
+      total += time;
+    }
+    return best;
+  }
+};
+
+// The tuned config of one call site (e.g. one matmul shape) as last seen by
+// the calling thread, valid while the tuner's stamp and the context's thread
+// count match.
+struct TunedKernelCache {
+  uint64_t stamp = 0;
+  size_t threads = 0;
+  KernelConfig config;
+};
+
+// Returns the tuner's config for the key made by make_key(), or tune(key) if
+// it has none. A hit in `cache` takes neither the tuner's lock nor a key
+// string, which keeps tuned kernels cheap to dispatch on the hot path.
+template <typename MakeKey, typename Tune>
+const KernelConfig& cached_kernel_config(TunedKernelCache& cache,
+                                         Autotuner& tuner, size_t threads,
+                                         MakeKey&& make_key, Tune&& tune) {
+  uint64_t stamp = tuner.stamp();
+  if (cache.stamp != stamp || cache.threads != threads) {
+    std::string key = make_key();
+    std::optional<KernelConfig> config = tuner.lookup(key);
+    cache = {stamp, threads, config ? *config : tune(key)};
+  }
+  return cache.config;
+}
+
+// Candidate configs for an M x K x N product. Thread counts go up in powers of
+// two to the context's thread count. A single row on several threads is split
+// by columns without tiling (see blocked_gemm), so it gets one candidate per
+// thread count.
+inline std::vector<KernelConfig> gemm_candidates(const CPUContext& ctx,
+                                                 int M) {
+  std::vector<KernelConfig> candidates = {KernelConfig{}};
+  const GemmTiles kTiles[] = {{32, 128, 64}, {64, 256, 128}, {16, 512, 256}};
+  for (size_t threads = 1; threads <= ctx.num_threads(); threads *= 2) {
+    for (const GemmTiles& tiles : kTiles) {
+      candidates.push_back({Kernel::kBlocked, threads, tiles});
+      if (M == 1 && threads > 1) {
+        break;
+      }
+    }
+  }
+  return candidates;
+}
+
+inline std::vector<KernelConfig> transpose_candidates(const CPUContext& ctx) {
+  std::vector<KernelConfig> candidates = {KernelConfig{}};
+  for (size_t threads = 1; threads <= ctx.num_threads(); threads *= 2) {
+    for (size_t tile : {16, 32, 64}) {
+      candidates.push_back({Kernel::kBlocked, threads, {tile, tile, tile}});
+    }
+  }
+  return candidates;
+}
+
+// E.g. "matmul 3x4x5 t8". The best kernel depends on how many threads it may
+// use, so the context's thread budget is part of the key.
+inline std::string shape_key(const char* op, std::initializer_list<int> dims,
+                             size_t threads) {
+  std::string key = op;
+  char separator = ' ';
+  for (int dim : dims) {
+    key += separator + std::to_string(dim);
+    separator = 'x';
+  }
+  return key + " t" + std::to_string(threads);
+}
+
+#endif  // AUTOTUNE_HPP
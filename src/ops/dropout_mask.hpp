@@ -0,0 +1,92 @@
+#ifndef DROPOUT_MASK_HPP
+#define DROPOUT_MASK_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "../context/parallel.hpp"
+#include "random.hpp"
+
+// Dropout kernels. The keep/drop decision for element i is one Philox word,
+// element i of the given stream (as for uniform_fill), compared against an
+// integer threshold. Decisions are stored one bit per element, 32 to a mask
+// word, so a saved mask is 32 times smaller than the activations it covers.
+
+constexpr int kDropoutMaskBits = 32;
+
+constexpr int dropout_mask_words(int n) {
+  return (n + kDropoutMaskBits - 1) / kDropoutMaskBits;
+}
+
+// parallel_for grain: each mask word draws eight Philox blocks and scales 32
+// elements, roughly 16 operations per element.
+constexpr size_t kDropoutMaskGrain = parallel_grain(16 * kDropoutMaskBits);
+
+// Words below the threshold are dropped, so each element is dropped with
+// probability `rate` (to within 2^-32). Requires 0 <= rate < 1.
+inline uint32_t dropout_threshold(float rate) {
+  return static_cast<uint32_t>(std::ldexp(static_cast<double>(rate), 32));
+}
+
+// CPU implementation. Draws the mask for elements offset .. offset + N - 1 of
+// the stream and writes output = input * 1 / (1 - rate) for kept elements and
+// 0 for dropped ones in the same pass. Bit b of mask word w is element
+// 32 * w + b; offset must be a multiple of 32.
+template <int N>
+void dropout(CPUContext& ctx, const std::span<const float, N> input,
+             std::span<float, N> output, std::span<uint32_t> mask, float rate,
+             uint64_t seed, uint64_t stream, uint64_t offset = 0) {
+  constexpr int kBlocks = kDropoutMaskBits / 4;
+  uint32_t threshold = dropout_threshold(rate);
+  float scale = 1.0f / (1.0f - rate);
+  uint64_t first_block = offset / 4;
+  int words = dropout_mask_words(N);
+  parallel_for(ctx, words, kDropoutMaskGrain, [&](size_t begin, size_t end) {
+    for (size_t w = begin; w < end; ++w) {
+      std::array<uint32_t, kDropoutMaskBits> words =
+          Philox4x32::generate_blocks<kBlocks>(seed, stream,
+                                               first_block + w * kBlocks);
+      uint32_t bits = 0;
+      for (int b = 0; b < kDropoutMaskBits; ++b) {
+        bits |= static_cast<uint32_t>(words[b] >= threshold) << b;
+      }
+      mask[w] = bits;
+
+      int first = w * kDropoutMaskBits;
+      int count = std::min(kDropoutMaskBits, N - first);
+      const float* in = input.data() + first;
+      float* out = output.data() + first;
+      for (int b = 0; b < count; ++b) {
+        out[b] = (bits >> b) & 1u ? in[b] * scale : 0.0f;
+      }
+    }
+  });
+}
+
+// CPU implementation of the backward pass: the gradient flows through kept
+// elements with the same scale and is zero for dropped ones.
+template <int N>
+void dropout_backward(CPUContext& ctx, const std::span<const uint32_t> mask,
+                      float rate, const std::span<const float, N> grad_in,
+                      std::span<float, N> grad_out) {
+  float scale = 1.0f / (1.0f - rate);
+  int words = dropout_mask_words(N);
+  parallel_for(ctx, words, kDropoutMaskGrain, [&](size_t begin, size_t end) {
+    for (size_t w = begin; w < end; ++w) {
+      uint32_t bits = mask[w];
+      int first = w * kDropoutMaskBits;
+      int count = std::min(kDropoutMaskBits, N - first);
+      const float* in = grad_in.data() + first;
+      float* out = grad_out.data() + first;
+      for (int b = 0; b < count; ++b) {
+        out[b] = (bits >> b) & 1u ? in[b] * scale : 0.0f;
+      }
+    }
+  });
+}
+
+#endif  // DROPOUT_MASK_HPP
@@ -0,0 +1,104 @@
+#ifndef DYNAMIC_HPP
+#define DYNAMIC_HPP
+
+#include <map>
+#include <mutex>
+#include <span>
+#include <tuple>
+
+#include "../context/contexts.hpp"
+#include "gemm.hpp"
+#include "matmul.hpp"
+
+// Runtime-shaped counterparts of the ops in this directory, used by models
+// whose shapes are only known once a spec has been loaded.
+
+using DynamicMatmulKernel = void (*)(CPUContext&, const float*, const float*,
+                                     float*);
+
+// Shapes with a compiled matmul<M, K, N> instantiation. DynamicMatmul uses
+// these when the runtime shape matches and falls back to the blocked kernel
+// otherwise.
+class DynamicKernels {
+ public:
+  static DynamicKernels& get() {
+    static DynamicKernels kernels;
+    return kernels;
+  }
+
+  template <int M, int K, int N>
+  void register_matmul() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    matmuls_[{M, K, N}] = [](CPUContext& ctx, const float* A, const float* B,
+                             float* C) {
+      matmul<M, K, N>(ctx, std::span<const float, M * K>(A, M * K),
+                      std::span<const float, K * N>(B, K * N),
+                      std::span<float, M * N>(C, M * N));
+    };
+  }
+
+  DynamicMatmulKernel find_matmul(size_t M, size_t K, size_t N) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = matmuls_.find({M, K, N});
+    return it == matmuls_.end() ? nullptr : it->second;
+  }
+
+ private:
+  std::map<std::tuple<size_t, size_t, size_t>, DynamicMatmulKernel> matmuls_;
+  mutable std::mutex mutex_;
+};
+
+// Registers a shape-specialised matmul for DynamicMatmul to dispatch to.
+// Shapes are resolved when a model is built, so register them before that.
+template <int M, int K, int N>
+void register_matmul_shape() {
+  DynamicKernels::get().register_matmul<M, K, N>();
+}
+
+// C (M x N) = A (M x K) * B (K x N), all row-major, for one runtime shape.
+// The kernel is looked up once, on construction, so calls take neither the
+// registry's lock nor a map lookup.
+class DynamicMatmul {
+ public:
+  DynamicMatmul() : kernel_(nullptr), M_(0), K_(0), N_(0) {}
+
+  DynamicMatmul(size_t M, size_t K, size_t N)
+      : kernel_(DynamicKernels::get().find_matmul(M, K, N)),
+        M_(M),
+        K_(K),
+        N_(N) {}
+
+  // Whether a registered kernel was found for the shape.
+  bool specialised() const { return kernel_ != nullptr; }
+
+  void operator()(CPUContext& ctx, const float* A, const float* B,
+                  float* C) const {
+    if (kernel_ != nullptr) {
+      kernel_(ctx, A, B, C);
+      return;
+    }
+    blocked_gemm(ctx, A, B, C, M_, K_, N_, GemmTiles{});
+  }
+
+ private:
+  DynamicMatmulKernel kernel_;
+  size_t M_;
+  size_t K_;
+  size_t N_;
+};
+
+// One-off C (M x N) = A (M x K) * B (K x N). Layers that multiply the same
+// shape repeatedly should keep a DynamicMatmul instead.
+inline void dynamic_matmul(CPUContext& ctx, const float* A, const float* B,
+                           float* C, size_t M, size_t K, size_t N) {
+  DynamicMatmul(M, K, N)(ctx, A, B, C);
+}
+
+inline void dynamic_add(std::span<const float> A, std::span<const float> B,
+                        std::span<float> C) {
+  for (size_t i = 0; i < C.size(); ++i) {
+    C[i] = A[i] + B[i];
+  }
+}
+
+#endif  // DYNAMIC_HPP
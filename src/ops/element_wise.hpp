@@ -3,8 +3,118 @@
 
 #include <Fastor/Fastor.h>
 
+#include <algorithm>
+#include <cmath>
+#include <span>
+
 #include "../context/contexts.hpp"
 #include "../tensor/tensor.hpp"
+#include "fast_math.hpp"
+
+// Runtime-length CPU implementations, for layers whose shape is only known
+// at runtime and for the modes Fastor has no expression for. The math mode
+// is switched on once per call, leaving a branch-free loop per mode.
+
+// Derivatives of sigmoid and tanh in terms of their output y, for every
+// math mode. The fast approximations share the exact derivatives.
+inline float sigmoid_slope(float y, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    return y > 0.0f && y < 1.0f ? 1.0f / 6.0f : 0.0f;
+  }
+  return y * (1.0f - y);
+}
+
+inline float tanh_slope(float y, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    return y > -1.0f && y < 1.0f ? 1.0f : 0.0f;
+  }
+  return 1.0f - y * y;
+}
+
+inline void ReLU(CPUContext& ctx, std::span<const float> input,
+                 std::span<float> output) {
+  for (size_t i = 0; i < output.size(); ++i) {
+    output[i] = std::max(input[i], 0.0f);
+  }
+}
+
+inline void ReLUPrime(CPUContext& ctx, std::span<const float> input,
+                      std::span<const float> grad_a_in,
+                      std::span<float> grad_z_out) {
+  for (size_t i = 0; i < grad_z_out.size(); ++i) {
+    grad_z_out[i] = input[i] > 0.0f ? grad_a_in[i] : 0.0f;
+  }
+}
+
+inline void sigmoid(CPUContext& ctx, std::span<const float> input,
+                    std::span<float> output, MathMode mode) {
+  switch (mode) {
+    case MathMode::kPrecise:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = 1.0f / (1.0f + std::exp(-input[i]));
+      }
+      return;
+    case MathMode::kFast:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = fast_sigmoid(input[i]);
+      }
+      return;
+    case MathMode::kHard:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = hard_sigmoid(input[i]);
+      }
+      return;
+  }
+}
+
+inline void sigmoidPrime(CPUContext& ctx, std::span<const float> output,
+                         std::span<const float> grad_a_in,
+                         std::span<float> grad_z_out, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    for (size_t i = 0; i < grad_z_out.size(); ++i) {
+      grad_z_out[i] = grad_a_in[i] * sigmoid_slope(output[i], MathMode::kHard);
+    }
+    return;
+  }
+  for (size_t i = 0; i < grad_z_out.size(); ++i) {
+    grad_z_out[i] = grad_a_in[i] * sigmoid_slope(output[i], MathMode::kPrecise);
+  }
+}
+
+inline void tanh(CPUContext& ctx, std::span<const float> input,
+                 std::span<float> output, MathMode mode) {
+  switch (mode) {
+    case MathMode::kPrecise:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = std::tanh(input[i]);
+      }
+      return;
+    case MathMode::kFast:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = fast_tanh(input[i]);
+      }
+      return;
+    case MathMode::kHard:
+      for (size_t i = 0; i < output.size(); ++i) {
+        output[i] = hard_tanh(input[i]);
+      }
+      return;
+  }
+}
+
+inline void tanhPrime(CPUContext& ctx, std::span<const float> output,
+                      std::span<const float> grad_a_in,
+                      std::span<float> grad_z_out, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    for (size_t i = 0; i < grad_z_out.size(); ++i) {
+      grad_z_out[i] = grad_a_in[i] * tanh_slope(output[i], MathMode::kHard);
+    }
+    return;
+  }
+  for (size_t i = 0; i < grad_z_out.size(); ++i) {
+    grad_z_out[i] = grad_a_in[i] * tanh_slope(output[i], MathMode::kPrecise);
+  }
+}
 
 template <ValidContext Context, int M, int N>
 void ReLU(Context& ctx, const Tensor<Context, M, N>& input,
@@ -12,11 +122,24 @@ void ReLU(Context& ctx, const Tensor<Context, M, N>& input,
   ReLU<M, N>(ctx, input.get(), output.get());
 }
 
+template <ValidContext Context, int M, int N>
+void ReLU(Context& ctx, const ConstTensorView<Context, M, N>& input,
+          const TensorView<Context, M, N>& output) {
+  if (input.is_contiguous() && output.is_contiguous()) {
+    ReLU<M, N>(ctx, input.get(), output.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    ReLU<1, N>(ctx, input.row(i), output.row(i));
+  }
+}
+
 // Fastor CPU implementation
 template <int M, int N>
-void ReLU(CPUContext& ctx, const std::span<float, M * N> input,
+void ReLU(CPUContext& ctx, const std::span<const float, M * N> input,
           std::span<float, M * N> output) {
-  Fastor::TensorMap<float, M, N> fInput(input.data());
+  // Fastor maps take a mutable pointer; inputs are only read.
+  Fastor::TensorMap<float, M, N> fInput(const_cast<float*>(input.data()));
   Fastor::TensorMap<float, M, N> fOutput(output.data());
   fOutput = Fastor::max(fInput, 0.0f);
 }
@@ -28,14 +151,28 @@ void ReLUPrime(Context& ctx, const Tensor<Context, M, N>& input,
   ReLUPrime<M, N>(ctx, input.get(), grad_a_in.get(), grad_z_out.get());
 }
 
+template <ValidContext Context, int M, int N>
+void ReLUPrime(Context& ctx, const ConstTensorView<Context, M, N>& input,
+               const ConstTensorView<Context, M, N>& grad_a_in,
+               const TensorView<Context, M, N>& grad_z_out) {
+  if (input.is_contiguous() && grad_a_in.is_contiguous() &&
+      grad_z_out.is_contiguous()) {
+    ReLUPrime<M, N>(ctx, input.get(), grad_a_in.get(), grad_z_out.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    ReLUPrime<1, N>(ctx, input.row(i), grad_a_in.row(i), grad_z_out.row(i));
+  }
+}
+
 // CPU implementation
 template <int M, int N>
-void ReLUPrime(CPUContext& ctx, const std::span<float, M * N> input,
-               const std::span<float, M * N> grad_a_in,
+void ReLUPrime(CPUContext& ctx, const std::span<const float, M * N> input,
+               const std::span<const float, M * N> grad_a_in,
                std::span<float, M * N> grad_z_out) {
-  for (size_t i = 0; i < M * N; ++i) {
-    grad_z_out[i] = input[i] > 0.0f ? grad_a_in[i] : 0.0f;
-  }  // Could not find working Fastor Implementation?
+  // Could not find working Fastor Implementation?
+  ReLUPrime(ctx, std::span<const float>(input),
+            std::span<const float>(grad_a_in), std::span<float>(grad_z_out));
 }
 
 template <ValidContext Context, int M, int N>
@@ -44,13 +181,42 @@ void sigmoid(Context& ctx, const Tensor<Context, M, N>& input,
   sigmoid<M, N>(ctx, input.get(), output.get());
 }
 
-// Fastor CPU implementation
+template <ValidContext Context, int M, int N>
+void sigmoid(Context& ctx, const ConstTensorView<Context, M, N>& input,
+             const TensorView<Context, M, N>& output) {
+  if (input.is_contiguous() && output.is_contiguous()) {
+    sigmoid<M, N>(ctx, input.get(), output.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    sigmoid<1, N>(ctx, input.row(i), output.row(i));
+  }
+}
+
+// CPU implementation, in the context's math mode
 template <int M, int N>
-void sigmoid(CPUContext& ctx, const std::span<float, M * N> input,
+void sigmoid(CPUContext& ctx, const std::span<const float, M * N> input,
              std::span<float, M * N> output) {
-  Fastor::TensorMap<float, M, N> fInput(input.data());
-  Fastor::TensorMap<float, M, N> fOutput(output.data());
-  fOutput = 1.0f / (1.0f + Fastor::exp(-fInput));
+  sigmoid<M, N>(ctx, input, output, ctx.math_mode());
+}
+
+// CPU implementation. Fastor in precise mode.
+template <int M, int N>
+void sigmoid(CPUContext& ctx, const std::span<const float, M * N> input,
+             std::span<float, M * N> output, MathMode mode) {
+  switch (mode) {
+    case MathMode::kPrecise: {
+      Fastor::TensorMap<float, M, N> fInput(const_cast<float*>(input.data()));
+      Fastor::TensorMap<float, M, N> fOutput(output.data());
+      fOutput = 1.0f / (1.0f + Fastor::exp(-fInput));
+      return;
+    }
+    case MathMode::kFast:
+    case MathMode::kHard:
+      sigmoid(ctx, std::span<const float>(input), std::span<float>(output),
+              mode);
+      return;
+  }
 }
 
 template <ValidContext Context, int M, int N>
@@ -60,15 +226,135 @@ void sigmoidPrime(Context& ctx, const Tensor<Context, M, N>& output,
   sigmoidPrime<M, N>(ctx, output.get(), grad_a_in.get(), grad_z_out.get());
 }
 
-// Fastor CPU implementation
+template <ValidContext Context, int M, int N>
+void sigmoidPrime(Context& ctx, const ConstTensorView<Context, M, N>& output,
+                  const ConstTensorView<Context, M, N>& grad_a_in,
+                  const TensorView<Context, M, N>& grad_z_out) {
+  if (output.is_contiguous() && grad_a_in.is_contiguous() &&
+      grad_z_out.is_contiguous()) {
+    sigmoidPrime<M, N>(ctx, output.get(), grad_a_in.get(), grad_z_out.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    sigmoidPrime<1, N>(ctx, output.row(i), grad_a_in.row(i),
+                       grad_z_out.row(i));
+  }
+}
+
+// CPU implementation, in the context's math mode
 template <int M, int N>
-void sigmoidPrime(CPUContext& ctx, const std::span<float, M * N> output,
-                  const std::span<float, M * N> grad_a_in,
+void sigmoidPrime(CPUContext& ctx, const std::span<const float, M * N> output,
+                  const std::span<const float, M * N> grad_a_in,
                   std::span<float, M * N> grad_z_out) {
-  Fastor::TensorMap<float, M, N> fOutput(output.data());
-  Fastor::TensorMap<float, M, N> fGradAIn(grad_a_in.data());
+  sigmoidPrime<M, N>(ctx, output, grad_a_in, grad_z_out, ctx.math_mode());
+}
+
+// Fastor CPU implementation. The fast approximation shares the exact
+// derivative; hard sigmoid has slope 1/6 strictly inside (0, 1).
+template <int M, int N>
+void sigmoidPrime(CPUContext& ctx, const std::span<const float, M * N> output,
+                  const std::span<const float, M * N> grad_a_in,
+                  std::span<float, M * N> grad_z_out, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    sigmoidPrime(ctx, std::span<const float>(output),
+                 std::span<const float>(grad_a_in),
+                 std::span<float>(grad_z_out), mode);
+    return;
+  }
+  Fastor::TensorMap<float, M, N> fOutput(const_cast<float*>(output.data()));
+  Fastor::TensorMap<float, M, N> fGradAIn(const_cast<float*>(grad_a_in.data()));
   Fastor::TensorMap<float, M, N> fGradZOut(grad_z_out.data());
   fGradZOut = fGradAIn * fOutput * (1.0f - fOutput);
 }
 
+template <ValidContext Context, int M, int N>
+void tanh(Context& ctx, const Tensor<Context, M, N>& input,
+          Tensor<Context, M, N>& output) {
+  tanh<M, N>(ctx, input.get(), output.get());
+}
+
+template <ValidContext Context, int M, int N>
+void tanh(Context& ctx, const ConstTensorView<Context, M, N>& input,
+          const TensorView<Context, M, N>& output) {
+  if (input.is_contiguous() && output.is_contiguous()) {
+    tanh<M, N>(ctx, input.get(), output.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    tanh<1, N>(ctx, input.row(i), output.row(i));
+  }
+}
+
+// CPU implementation, in the context's math mode
+template <int M, int N>
+void tanh(CPUContext& ctx, const std::span<const float, M * N> input,
+          std::span<float, M * N> output) {
+  tanh<M, N>(ctx, input, output, ctx.math_mode());
+}
+
+// CPU implementation. Fastor in precise mode.
+template <int M, int N>
+void tanh(CPUContext& ctx, const std::span<const float, M * N> input,
+          std::span<float, M * N> output, MathMode mode) {
+  switch (mode) {
+    case MathMode::kPrecise: {
+      Fastor::TensorMap<float, M, N> fInput(const_cast<float*>(input.data()));
+      Fastor::TensorMap<float, M, N> fOutput(output.data());
+      fOutput = Fastor::tanh(fInput);
+      return;
+    }
+    case MathMode::kFast:
+    case MathMode::kHard:
+      tanh(ctx, std::span<const float>(input), std::span<float>(output), mode);
+      return;
+  }
+}
+
+template <ValidContext Context, int M, int N>
+void tanhPrime(Context& ctx, const Tensor<Context, M, N>& output,
+               const Tensor<Context, M, N>& grad_a_in,
+               Tensor<Context, M, N>& grad_z_out) {
+  tanhPrime<M, N>(ctx, output.get(), grad_a_in.get(), grad_z_out.get());
+}
+
+template <ValidContext Context, int M, int N>
+void tanhPrime(Context& ctx, const ConstTensorView<Context, M, N>& output,
+               const ConstTensorView<Context, M, N>& grad_a_in,
+               const TensorView<Context, M, N>& grad_z_out) {
+  if (output.is_contiguous() && grad_a_in.is_contiguous() &&
+      grad_z_out.is_contiguous()) {
+    tanhPrime<M, N>(ctx, output.get(), grad_a_in.get(), grad_z_out.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    tanhPrime<1, N>(ctx, output.row(i), grad_a_in.row(i), grad_z_out.row(i));
+  }
+}
+
+// CPU implementation, in the context's math mode
+template <int M, int N>
+void tanhPrime(CPUContext& ctx, const std::span<const float, M * N> output,
+               const std::span<const float, M * N> grad_a_in,
+               std::span<float, M * N> grad_z_out) {
+  tanhPrime<M, N>(ctx, output, grad_a_in, grad_z_out, ctx.math_mode());
+}
+
+// Fastor CPU implementation. As for sigmoidPrime, only hard tanh has its own
+// derivative: slope 1 strictly inside (-1, 1).
+template <int M, int N>
+void tanhPrime(CPUContext& ctx, const std::span<const float, M * N> output,
+               const std::span<const float, M * N> grad_a_in,
+               std::span<float, M * N> grad_z_out, MathMode mode) {
+  if (mode == MathMode::kHard) {
+    tanhPrime(ctx, std::span<const float>(output),
+              std::span<const float>(grad_a_in), std::span<float>(grad_z_out),
+              mode);
+    return;
+  }
+  Fastor::TensorMap<float, M, N> fOutput(const_cast<float*>(output.data()));
+  Fastor::TensorMap<float, M, N> fGradAIn(const_cast<float*>(grad_a_in.data()));
+  Fastor::TensorMap<float, M, N> fGradZOut(grad_z_out.data());
+  fGradZOut = fGradAIn * (1.0f - fOutput * fOutput);
+}
+
 #endif  // ELEMENT_WISE_HPP
\ No newline at end of file
@@ -0,0 +1,128 @@
+#ifndef EMBEDDING_BAG_HPP
+#define EMBEDDING_BAG_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <span>
+#include <vector>
+
+#include "../context/contexts.hpp"
+
+// Index-based lookups into a row-major Rows x Dim embedding table. Negative
+// indices are padding: they read as zero rows and receive no gradient, which
+// lets fixed-size bags hold a variable number of ids.
+
+enum class EmbeddingPooling {
+  kNone,  // One output row per index.
+  kSum,
+  kMean,  // Averages over the non-padding indices.
+};
+
+// Gradient w.r.t. the rows of a table that a step actually touched. `rows`
+// holds each touched row once, in ascending order, and `values` holds their
+// gradients, rows.size() x Dim.
+struct SparseRowGrad {
+  std::vector<int> rows;
+  std::vector<float> values;
+};
+
+// CPU implementation. `output` holds indices.size() x Dim floats for kNone
+// and Dim floats otherwise.
+template <int Dim>
+void embedding_bag(CPUContext& ctx, const std::span<const float> table,
+                   const std::span<const int> indices,
+                   EmbeddingPooling pooling, std::span<float> output) {
+  if (pooling == EmbeddingPooling::kNone) {
+    for (size_t b = 0; b < indices.size(); ++b) {
+      float* out = output.data() + b * Dim;
+      if (indices[b] < 0) {
+        std::fill_n(out, Dim, 0.0f);
+      } else {
+        std::copy_n(table.data() + size_t(indices[b]) * Dim, Dim, out);
+      }
+    }
+    return;
+  }
+
+  std::ranges::fill(output, 0.0f);
+  int count = 0;
+  for (int index : indices) {
+    if (index < 0) {
+      continue;
+    }
+    const float* row = table.data() + size_t(index) * Dim;
+    for (int d = 0; d < Dim; ++d) {
+      output[d] += row[d];
+    }
+    ++count;
+  }
+  if (pooling == EmbeddingPooling::kMean && count > 1) {
+    float scale = 1.0f / count;
+    for (float& value : output) {
+      value *= scale;
+    }
+  }
+}
+
+// CPU implementation of the backward pass. Only the rows named in `indices`
+// appear in `grad`; repeated indices have their gradients summed. With
+// `accumulate` the rows are merged into those already in `grad` and their
+// gradients added.
+template <int Dim>
+void embedding_bag_backward(CPUContext& ctx,
+                            const std::span<const int> indices,
+                            EmbeddingPooling pooling,
+                            const std::span<const float> grad_out,
+                            SparseRowGrad& grad, bool accumulate = false) {
+  std::vector<int> previous_rows;
+  if (accumulate) {
+    previous_rows.swap(grad.rows);
+  }
+  grad.rows.clear();
+  for (int index : indices) {
+    if (index >= 0) {
+      grad.rows.push_back(index);
+    }
+  }
+  std::ranges::sort(grad.rows);
+  grad.rows.erase(std::unique(grad.rows.begin(), grad.rows.end()),
+                  grad.rows.end());
+  if (accumulate) {
+    std::vector<int> touched = std::move(grad.rows);
+    grad.rows.clear();
+    std::ranges::set_union(previous_rows, touched,
+                           std::back_inserter(grad.rows));
+    std::vector<float> previous_values = std::move(grad.values);
+    grad.values.assign(grad.rows.size() * Dim, 0.0f);
+    for (size_t r = 0; r < previous_rows.size(); ++r) {
+      size_t slot = std::ranges::lower_bound(grad.rows, previous_rows[r]) -
+                    grad.rows.begin();
+      std::copy_n(previous_values.data() + r * Dim, Dim,
+                  grad.values.data() + slot * Dim);
+    }
+  } else {
+    grad.values.assign(grad.rows.size() * Dim, 0.0f);
+  }
+
+  int count = 0;
+  for (int index : indices) {
+    count += index >= 0;
+  }
+  float scale =
+      pooling == EmbeddingPooling::kMean && count > 1 ? 1.0f / count : 1.0f;
+  for (size_t b = 0; b < indices.size(); ++b) {
+    if (indices[b] < 0) {
+      continue;
+    }
+    size_t slot = std::ranges::lower_bound(grad.rows, indices[b]) -
+                  grad.rows.begin();
+    const float* g = grad_out.data() +
+                     (pooling == EmbeddingPooling::kNone ? b * Dim : 0);
+    float* value = grad.values.data() + slot * Dim;
+    for (int d = 0; d < Dim; ++d) {
+      value[d] += scale * g[d];
+    }
+  }
+}
+
+#endif  // EMBEDDING_BAG_HPP
@@ -0,0 +1,81 @@
+#ifndef FAST_MATH_HPP
+#define FAST_MATH_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+// Approximations for MathMode::kFast. They only use arithmetic, clamps and
+// integer bit manipulation, so loops over them auto-vectorise when built for
+// a target with vector blends (e.g. -march=native on AVX2).
+
+// e^x as 2^n * e^r, where n = round(x / ln 2) and |r| <= ln 2 / 2. e^r comes
+// from its degree 5 Taylor polynomial and 2^n is built directly in the
+// exponent bits; the relative error is below 4e-6. x is clamped to
+// [-87, 87], so the result is always a normal float.
+inline float fast_exp(float x) {
+  constexpr float kLog2e = 1.44269504f;
+  // ln 2 split in two so that n * kLn2Hi is exact.
+  constexpr float kLn2Hi = 0.693359375f;
+  constexpr float kLn2Lo = -2.12194440e-4f;
+  // Adding and subtracting 1.5 * 2^23 rounds to the nearest integer.
+  constexpr float kRound = 12582912.0f;
+
+  x = std::clamp(x, -87.0f, 87.0f);
+  float n = (x * kLog2e + kRound) - kRound;
+  float r = x - n * kLn2Hi - n * kLn2Lo;
+  float p = 1.0f / 120.0f;
+  p = p * r + 1.0f / 24.0f;
+  p = p * r + 1.0f / 6.0f;
+  p = p * r + 0.5f;
+  p = p * r + 1.0f;
+  p = p * r + 1.0f;
+  int32_t exponent = (static_cast<int32_t>(n) + 127) << 23;
+  return p * std::bit_cast<float>(exponent);
+}
+
+// 1 / (1 + e^-x) with fast_exp.
+inline float fast_sigmoid(float x) { return 1.0f / (1.0f + fast_exp(-x)); }
+
+// tanh(x) as a 13/6 odd/even rational function, the approximation Eigen
+// uses for float. Accurate to a few ulp on [-7.9, 7.9], beyond which tanh
+// rounds to +-1.
+inline float fast_tanh(float x) {
+  constexpr float kClamp = 7.90531110763549805f;
+  constexpr float kAlpha1 = 4.89352455891786e-03f;
+  constexpr float kAlpha3 = 6.37261928875436e-04f;
+  constexpr float kAlpha5 = 1.48572235717979e-05f;
+  constexpr float kAlpha7 = 5.12229709037114e-08f;
+  constexpr float kAlpha9 = -8.60467152213735e-11f;
+  constexpr float kAlpha11 = 2.00018790482477e-13f;
+  constexpr float kAlpha13 = -2.76076847742355e-16f;
+  constexpr float kBeta0 = 4.89352518554385e-03f;
+  constexpr float kBeta2 = 2.26843463243900e-03f;
+  constexpr float kBeta4 = 1.18534705686654e-04f;
+  constexpr float kBeta6 = 1.19825839466702e-06f;
+
+  x = std::clamp(x, -kClamp, kClamp);
+  float x2 = x * x;
+  float p = kAlpha13;
+  p = p * x2 + kAlpha11;
+  p = p * x2 + kAlpha9;
+  p = p * x2 + kAlpha7;
+  p = p * x2 + kAlpha5;
+  p = p * x2 + kAlpha3;
+  p = p * x2 + kAlpha1;
+  p = p * x;
+  float q = kBeta6;
+  q = q * x2 + kBeta4;
+  q = q * x2 + kBeta2;
+  q = q * x2 + kBeta0;
+  return p / q;
+}
+
+// clamp(x / 6 + 1 / 2, 0, 1), as in PyTorch.
+inline float hard_sigmoid(float x) {
+  return std::clamp(x * (1.0f / 6.0f) + 0.5f, 0.0f, 1.0f);
+}
+
+inline float hard_tanh(float x) { return std::clamp(x, -1.0f, 1.0f); }
+
+#endif  // FAST_MATH_HPP
@@ -0,0 +1,93 @@
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../context/contexts.hpp"
+#include "../context/parallel.hpp"
+
+// Tile sizes for the blocked kernels, in elements.
+struct GemmTiles {
+  size_t m = 64;
+  size_t k = 256;
+  size_t n = 128;
+};
+
+// C[row_begin:row_end] = A[row_begin:row_end] * B, all row-major. The K and N
+// loops are blocked so that a panel of B stays in cache while it is reused by
+// every row of the M tile; the innermost loop runs over contiguous columns so
+// the compiler can vectorise it. With `accumulate` the product is added to C
+// instead, at no extra cost since the kernel always accumulates into C.
+inline void blocked_gemm_rows(const float* A, const float* B, float* C,
+                              size_t K, size_t N, const GemmTiles& tiles,
+                              size_t row_begin, size_t row_end,
+                              bool accumulate = false) {
+  if (!accumulate) {
+    std::fill(C + row_begin * N, C + row_end * N, 0.0f);
+  }
+  for (size_t i0 = row_begin; i0 < row_end; i0 += tiles.m) {
+    size_t i1 = std::min(i0 + tiles.m, row_end);
+    for (size_t k0 = 0; k0 < K; k0 += tiles.k) {
+      size_t k1 = std::min(k0 + tiles.k, K);
+      for (size_t j0 = 0; j0 < N; j0 += tiles.n) {
+        size_t j1 = std::min(j0 + tiles.n, N);
+        for (size_t i = i0; i < i1; ++i) {
+          float* c_row = C + i * N;
+          for (size_t k = k0; k < k1; ++k) {
+            float a = A[i * K + k];
+            const float* b_row = B + k * N;
+            for (size_t j = j0; j < j1; ++j) {
+              c_row[j] += a * b_row[j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Row-parallel blocked GEMM. With a single row (the common 1 x In layer case)
+// we split the columns instead so that extra threads still have work.
+inline void blocked_gemm(const CPUContext& ctx, const float* A, const float* B,
+                         float* C, size_t M, size_t K, size_t N,
+                         const GemmTiles& tiles, bool accumulate = false) {
+  if (M > 1 || ctx.num_threads() == 1) {
+    parallel_for(ctx, M, parallel_grain(K * N), [&](size_t begin, size_t end) {
+      blocked_gemm_rows(A, B, C, K, N, tiles, begin, end, accumulate);
+    });
+    return;
+  }
+  parallel_for(ctx, N, parallel_grain(K), [&](size_t begin, size_t end) {
+    if (!accumulate) {
+      std::fill(C + begin, C + end, 0.0f);
+    }
+    for (size_t k = 0; k < K; ++k) {
+      float a = A[k];
+      const float* b_row = B + k * N;
+      for (size_t j = begin; j < end; ++j) {
+        C[j] += a * b_row[j];
+      }
+    }
+  });
+}
+
+// At = A^T for a row-major M x N matrix, in square tiles.
+inline void blocked_transpose(const CPUContext& ctx, const float* A, float* At,
+                              size_t M, size_t N, size_t tile) {
+  parallel_for(ctx, M, parallel_grain(N), [&](size_t begin, size_t end) {
+    for (size_t i0 = begin; i0 < end; i0 += tile) {
+      size_t i1 = std::min(i0 + tile, end);
+      for (size_t j0 = 0; j0 < N; j0 += tile) {
+        size_t j1 = std::min(j0 + tile, N);
+        for (size_t i = i0; i < i1; ++i) {
+          for (size_t j = j0; j < j1; ++j) {
+            At[j * M + i] = A[i * N + j];
+          }
+        }
+      }
+    }
+  });
+}
+
+#endif  // GEMM_HPP
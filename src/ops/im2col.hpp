@@ -0,0 +1,136 @@
+#ifndef IM2COL_HPP
+#define IM2COL_HPP
+
+#include <algorithm>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "../tensor/tensor.hpp"
+
+// Geometry of a 2D convolution or pooling window over a single NHWC image
+// (batch of 1), i.e. a row vector of Height * Width * Channels floats with the
+// channel index fastest.
+template <int Height, int Width, int Channels, int Kernel, int Stride = 1,
+          int Padding = 0, int Dilation = 1>
+struct ConvGeometry {
+  static_assert(Kernel > 0 && Stride > 0 && Dilation > 0 && Padding >= 0);
+
+  static constexpr int kHeight = Height;
+  static constexpr int kWidth = Width;
+  static constexpr int kChannels = Channels;
+  static constexpr int kKernel = Kernel;
+  static constexpr int kStride = Stride;
+  static constexpr int kPadding = Padding;
+  static constexpr int kDilation = Dilation;
+
+  static constexpr int kSpan = Dilation * (Kernel - 1) + 1;
+  static constexpr int kOutHeight = (Height + 2 * Padding - kSpan) / Stride + 1;
+  static constexpr int kOutWidth = (Width + 2 * Padding - kSpan) / Stride + 1;
+  static_assert(kOutHeight > 0 && kOutWidth > 0,
+                "The kernel does not fit in the padded input");
+
+  // Output pixels, i.e. rows of the im2col matrix.
+  static constexpr int kPositions = kOutHeight * kOutWidth;
+  // Inputs seen by one output pixel, i.e. columns of the im2col matrix.
+  static constexpr int kPatch = Kernel * Kernel * Channels;
+
+  // A 1x1 convolution with unit stride and no padding reads each pixel once,
+  // so its im2col matrix is the input itself.
+  static constexpr bool kPointwise = Kernel == 1 && Stride == 1 && Padding == 0;
+};
+
+// im2col rows per tile, chosen so that a tile fits in L2 while the GEMM that
+// consumes it runs.
+template <typename Geometry>
+constexpr int im2col_tile_rows() {
+  constexpr int kTileBytes = 1 << 17;
+  constexpr int kRows = kTileBytes / (Geometry::kPatch * sizeof(float));
+  return std::clamp(kRows, 1, Geometry::kPositions);
+}
+
+template <typename Geometry, ValidContext Context>
+void im2col(
+    Context& ctx,
+    const ConstTensorView<Context, 1, Geometry::kHeight * Geometry::kWidth *
+                                          Geometry::kChannels>& input,
+    const TensorView<Context, Geometry::kPositions, Geometry::kPatch>& cols) {
+  im2col<Geometry>(ctx, input.get(), 0, Geometry::kPositions, cols.get());
+}
+
+// CPU implementation. Writes im2col rows [first, first + count), one per
+// output pixel, each holding its (ky, kx, c) patch with zeros for padding.
+template <typename Geometry>
+void im2col(CPUContext& ctx, const std::span<const float> input, int first,
+            int count, std::span<float> cols) {
+  constexpr int C = Geometry::kChannels;
+  float* row = cols.data();
+  for (int p = first; p < first + count; ++p) {
+    int oy = p / Geometry::kOutWidth;
+    int ox = p % Geometry::kOutWidth;
+    for (int ky = 0; ky < Geometry::kKernel; ++ky) {
+      int y = oy * Geometry::kStride - Geometry::kPadding +
+              ky * Geometry::kDilation;
+      for (int kx = 0; kx < Geometry::kKernel; ++kx) {
+        int x = ox * Geometry::kStride - Geometry::kPadding +
+                kx * Geometry::kDilation;
+        if (y < 0 || y >= Geometry::kHeight || x < 0 ||
+            x >= Geometry::kWidth) {
+          std::fill_n(row, C, 0.0f);
+        } else {
+          std::copy_n(input.data() + (y * Geometry::kWidth + x) * C, C, row);
+        }
+        row += C;
+      }
+    }
+  }
+}
+
+template <typename Geometry, ValidContext Context>
+void col2im(Context& ctx,
+            const ConstTensorView<Context, Geometry::kPositions,
+                                  Geometry::kPatch>& cols,
+            const TensorView<Context, 1, Geometry::kHeight * Geometry::kWidth *
+                                             Geometry::kChannels>& output) {
+  col2im<Geometry>(ctx, cols.get(), output.get());
+}
+
+// CPU implementation of the adjoint of im2col: im2col rows [first, first +
+// count) are added back onto the pixels they were read from, and padding
+// entries are dropped. `output` is not cleared first, so a matrix can be
+// folded back a tile at a time.
+template <typename Geometry>
+void col2im(CPUContext& ctx, const std::span<const float> cols, int first,
+            int count, std::span<float> output) {
+  constexpr int C = Geometry::kChannels;
+  const float* row = cols.data();
+  for (int p = first; p < first + count; ++p) {
+    int oy = p / Geometry::kOutWidth;
+    int ox = p % Geometry::kOutWidth;
+    for (int ky = 0; ky < Geometry::kKernel; ++ky) {
+      int y = oy * Geometry::kStride - Geometry::kPadding +
+              ky * Geometry::kDilation;
+      for (int kx = 0; kx < Geometry::kKernel; ++kx) {
+        int x = ox * Geometry::kStride - Geometry::kPadding +
+                kx * Geometry::kDilation;
+        if (y >= 0 && y < Geometry::kHeight && x >= 0 &&
+            x < Geometry::kWidth) {
+          float* pixel = output.data() + (y * Geometry::kWidth + x) * C;
+          for (int c = 0; c < C; ++c) {
+            pixel[c] += row[c];
+          }
+        }
+        row += C;
+      }
+    }
+  }
+}
+
+// CPU implementation. Folds the whole im2col matrix back onto a cleared image.
+template <typename Geometry>
+void col2im(CPUContext& ctx, const std::span<const float> cols,
+            std::span<float> output) {
+  std::ranges::fill(output, 0.0f);
+  col2im<Geometry>(ctx, cols, 0, Geometry::kPositions, output);
+}
+
+#endif  // IM2COL_HPP
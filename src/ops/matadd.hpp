@@ -13,13 +13,28 @@ void matadd(Context& ctx, const Tensor<Context, M, N>& A,
   matadd<M, N>(ctx, A.get(), B.get(), C.get(), subtracting_b);
 }
 
+// View overload. Strided views are added a row at a time.
+template <ValidContext Context, int M, int N>
+void matadd(Context& ctx, const ConstTensorView<Context, M, N>& A,
+            const ConstTensorView<Context, M, N>& B,
+            const TensorView<Context, M, N>& C, bool subtracting_b = false) {
+  if (A.is_contiguous() && B.is_contiguous() && C.is_contiguous()) {
+    matadd<M, N>(ctx, A.get(), B.get(), C.get(), subtracting_b);
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    matadd<1, N>(ctx, A.row(i), B.row(i), C.row(i), subtracting_b);
+  }
+}
+
 // Fastor CPU implementation
 template <int M, int N>
-void matadd(CPUContext& ctx, const std::span<float, M * N> A,
-            const std::span<float, M * N> B, std::span<float, M * N> C,
+void matadd(CPUContext& ctx, const std::span<const float, M * N> A,
+            const std::span<const float, M * N> B, std::span<float, M * N> C,
             bool subtracting_b = false) {
-  Fastor::TensorMap<float, M, N> fA(A.data());
-  Fastor::TensorMap<float, M, N> fB(B.data());
+  // Fastor maps take a mutable pointer; inputs are only read.
+  Fastor::TensorMap<float, M, N> fA(const_cast<float*>(A.data()));
+  Fastor::TensorMap<float, M, N> fB(const_cast<float*>(B.data()));
   Fastor::TensorMap<float, M, N> fC(C.data());
   if (subtracting_b) {
     fC = fA - fB;
@@ -3,13 +3,21 @@
 
 #include <Fastor/Fastor.h>
 
+#include <span>
+#include <vector>
+
 #include "../context/contexts.hpp"
 #include "../tensor/tensor.hpp"
+#include "autotune.hpp"
+#include "gemm.hpp"
 
+// With `accumulate`, C += A * B: the product is added to C in the GEMM
+// itself rather than through a temporary and a matadd.
 template <ValidContext Context, int M, int K, int N>
 void matmul(Context& ctx, const Tensor<Context, M, K>& A,
-            const Tensor<Context, K, N>& B, Tensor<Context, M, N>& C) {
-  matmul<M, K, N>(ctx, A.get(), B.get(), C.get());
+            const Tensor<Context, K, N>& B, Tensor<Context, M, N>& C,
+            bool accumulate = false) {
+  matmul<M, K, N>(ctx, A.get(), B.get(), C.get(), accumulate);
 }
 
 template <ValidContext Context, int M, int N>
@@ -18,23 +26,115 @@ void matmul(Context& ctx, float scalar, const Tensor<Context, M, N>& B,
   matmul<M, N>(ctx, scalar, B.get(), C.get());
 }
 
+// View overloads. Contiguous views go straight to the span kernels; strided
+// views (column slices) are processed a row at a time.
+template <ValidContext Context, int M, int K, int N>
+void matmul(Context& ctx, const ConstTensorView<Context, M, K>& A,
+            const ConstTensorView<Context, K, N>& B,
+            const TensorView<Context, M, N>& C, bool accumulate = false) {
+  if (A.is_contiguous() && B.is_contiguous() && C.is_contiguous()) {
+    matmul<M, K, N>(ctx, A.get(), B.get(), C.get(), accumulate);
+    return;
+  }
+  if (B.is_contiguous()) {
+    for (size_t i = 0; i < M; ++i) {
+      matmul<1, K, N>(ctx, A.row(i), B.get(), C.row(i), accumulate);
+    }
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      float sum = accumulate ? C(i, j) : 0.0f;
+      for (size_t k = 0; k < K; ++k) {
+        sum += A(i, k) * B(k, j);
+      }
+      C(i, j) = sum;
+    }
+  }
+}
+
+template <ValidContext Context, int M, int N>
+void matmul(Context& ctx, float scalar, const ConstTensorView<Context, M, N>& B,
+            const TensorView<Context, M, N>& C) {
+  if (B.is_contiguous() && C.is_contiguous()) {
+    matmul<M, N>(ctx, scalar, B.get(), C.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    matmul<1, N>(ctx, scalar, B.row(i), C.row(i));
+  }
+}
+
 // Fastor CPU implementation of Matrix X Matrix
 template <int M, int K, int N>
-void matmul(CPUContext& ctx, const std::span<float, M * K> A,
-            const std::span<float, K * N> B, std::span<float, M * N> C) {
-  Fastor::TensorMap<float, M, K> fA(A.data());
-  Fastor::TensorMap<float, K, N> fB(B.data());
+void fastor_matmul(const std::span<const float, M * K> A,
+                   const std::span<const float, K * N> B,
+                   std::span<float, M * N> C) {
+  // Fastor maps take a mutable pointer; inputs are only read.
+  Fastor::TensorMap<float, M, K> fA(const_cast<float*>(A.data()));
+  Fastor::TensorMap<float, K, N> fB(const_cast<float*>(B.data()));
   Fastor::TensorMap<float, M, N> fC(C.data());
   fC = Fastor::matmul(fA, fB);
 }
 
+// Fastor has no accumulating product, so accumulation always runs on the
+// blocked kernel (with the tuned tiles and threads, if any).
+template <int M, int K, int N>
+void run_matmul(const CPUContext& ctx, const KernelConfig& config,
+                const std::span<const float, M * K> A,
+                const std::span<const float, K * N> B,
+                std::span<float, M * N> C, bool accumulate = false) {
+  if (config.kernel == Kernel::kFastor && !accumulate) {
+    fastor_matmul<M, K, N>(A, B, C);
+    return;
+  }
+  CPUContext kernel_ctx = ctx;
+  kernel_ctx.set_num_threads(config.threads);
+  blocked_gemm(kernel_ctx, A.data(), B.data(), C.data(), M, K, N,
+               config.tiles, accumulate);
+}
+
+// CPU implementation of Matrix X Matrix. Uses Fastor unless the context has an
+// autotuner, in which case the tuned kernel for this shape is used, tuning it
+// on first use.
+template <int M, int K, int N>
+void matmul(CPUContext& ctx, const std::span<const float, M * K> A,
+            const std::span<const float, K * N> B, std::span<float, M * N> C,
+            bool accumulate = false) {
+  Autotuner* tuner = ctx.autotuner();
+  if (tuner == nullptr) {
+    if (accumulate) {
+      blocked_gemm(ctx, A.data(), B.data(), C.data(), M, K, N, GemmTiles{},
+                   true);
+    } else {
+      fastor_matmul<M, K, N>(A, B, C);
+    }
+    return;
+  }
+  thread_local TunedKernelCache cache;
+  const KernelConfig& config = cached_kernel_config(
+      cache, *tuner, ctx.num_threads(),
+      [&]() { return shape_key("matmul", {M, K, N}, ctx.num_threads()); },
+      [&](const std::string& key) {
+        // Candidates run into scratch so that C is never clobbered, whether
+        // it is being accumulated into or aliases an input.
+        std::vector<float> scratch(M * N);
+        std::span<float, M * N> out(scratch);
+        return tuner->tune(key, gemm_candidates(ctx, M),
+                           [&](const KernelConfig& candidate) {
+                             run_matmul<M, K, N>(ctx, candidate, A, B, out);
+                           });
+      });
+  run_matmul<M, K, N>(ctx, config, A, B, C, accumulate);
+}
+
 // Fastor CPU implementation of Scalar X Matrix
 template <int M, int N>
-void matmul(CPUContext& ctx, float scalar, const std::span<float, M * N> B,
-            std::span<float, M * N> C) {
-  Fastor::TensorMap<float, M, N> fB(B.data());
+void matmul(CPUContext& ctx, float scalar,
+            const std::span<const float, M * N> B, std::span<float, M * N> C) {
+  Fastor::TensorMap<float, M, N> fB(const_cast<float*>(B.data()));
   Fastor::TensorMap<float, M, N> fC(C.data());
   fC = scalar * fB;
 }
 
-#endif  // MATMUL_HPP
\ No newline at end of file
+#endif  // MATMUL_HPP
@@ -3,8 +3,14 @@
 
 #include <Fastor/Fastor.h>
 
+#include <span>
+#include <string>
+#include <vector>
+
 #include "../context/contexts.hpp"
 #include "../tensor/tensor.hpp"
+#include "autotune.hpp"
+#include "gemm.hpp"
 
 template <ValidContext Context, int M, int N>
 void mattranspose(Context& ctx, const Tensor<Context, M, N>& A,
@@ -12,13 +18,67 @@ void mattranspose(Context& ctx, const Tensor<Context, M, N>& A,
   mattranspose<M, N>(ctx, A.get(), At.get());
 }
 
+template <ValidContext Context, int M, int N>
+void mattranspose(Context& ctx, const ConstTensorView<Context, M, N>& A,
+                  const TensorView<Context, N, M>& At) {
+  if (A.is_contiguous() && At.is_contiguous()) {
+    mattranspose<M, N>(ctx, A.get(), At.get());
+    return;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      At(j, i) = A(i, j);
+    }
+  }
+}
+
 // Fastor CPU implementation
 template <int M, int N>
-void mattranspose(CPUContext& ctx, const std::span<float, M * N> A,
-                  std::span<float, N * M> At) {
-  Fastor::TensorMap<float, M, N> fA(A.data());
+void fastor_mattranspose(const std::span<const float, M * N> A,
+                         std::span<float, N * M> At) {
+  // Fastor maps take a mutable pointer; inputs are only read.
+  Fastor::TensorMap<float, M, N> fA(const_cast<float*>(A.data()));
   Fastor::TensorMap<float, N, M> fAt(At.data());
   fAt = Fastor::transpose(fA);
 }
 
-#endif  // MATTRANSPOSE_HPP
\ No newline at end of file
+template <int M, int N>
+void run_mattranspose(const CPUContext& ctx, const KernelConfig& config,
+                      const std::span<const float, M * N> A,
+                      std::span<float, N * M> At) {
+  if (config.kernel == Kernel::kFastor) {
+    fastor_mattranspose<M, N>(A, At);
+    return;
+  }
+  CPUContext kernel_ctx = ctx;
+  kernel_ctx.set_num_threads(config.threads);
+  blocked_transpose(kernel_ctx, A.data(), At.data(), M, N, config.tiles.m);
+}
+
+// CPU implementation. As with matmul, an autotuner on the context picks the
+// kernel per shape.
+template <int M, int N>
+void mattranspose(CPUContext& ctx, const std::span<const float, M * N> A,
+                  std::span<float, N * M> At) {
+  Autotuner* tuner = ctx.autotuner();
+  if (tuner == nullptr) {
+    fastor_mattranspose<M, N>(A, At);
+    return;
+  }
+  thread_local TunedKernelCache cache;
+  const KernelConfig& config = cached_kernel_config(
+      cache, *tuner, ctx.num_threads(),
+      [&]() { return shape_key("mattranspose", {M, N}, ctx.num_threads()); },
+      [&](const std::string& key) {
+        // As in matmul, candidates run into scratch rather than At.
+        std::vector<float> scratch(N * M);
+        std::span<float, N * M> out(scratch);
+        return tuner->tune(key, transpose_candidates(ctx),
+                           [&](const KernelConfig& candidate) {
+                             run_mattranspose<M, N>(ctx, candidate, A, out);
+                           });
+      });
+  run_mattranspose<M, N>(ctx, config, A, At);
+}
+
+#endif  // MATTRANSPOSE_HPP
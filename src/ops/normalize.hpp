@@ -0,0 +1,217 @@
+#ifndef NORMALIZE_HPP
+#define NORMALIZE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include "../context/contexts.hpp"
+
+// Kernels for normalisation layers over a row-major M x N matrix. Statistics
+// use Welford's single-pass update, which is as cheap as the naive
+// sum / sum-of-squares pass but does not lose precision when the mean is large
+// relative to the spread.
+
+// CPU implementation. Mean and (biased) variance of every column. Rows are
+// the outer loop so that the per-column updates vectorise across columns.
+template <int M, int N>
+void welford_columns(CPUContext& ctx, const std::span<const float, M * N> x,
+                     std::span<float, N> mean, std::span<float, N> var) {
+  for (int j = 0; j < N; ++j) {
+    mean[j] = 0.0f;
+    var[j] = 0.0f;
+  }
+  for (int i = 0; i < M; ++i) {
+    const float* row = x.data() + i * N;
+    float inv_count = 1.0f / (i + 1);
+    for (int j = 0; j < N; ++j) {
+      float delta = row[j] - mean[j];
+      mean[j] += delta * inv_count;
+      var[j] += delta * (row[j] - mean[j]);
+    }
+  }
+  for (int j = 0; j < N; ++j) {
+    var[j] /= M;
+  }
+}
+
+// Independent Welford accumulators per row in welford_rows.
+inline constexpr int kWelfordLanes = 8;
+
+// CPU implementation. Mean and (biased) variance of every row. Each row is
+// read in chunks of kWelfordLanes elements, lane l of every chunk feeding its
+// own (mean, M2) so that the updates vectorise across lanes and share one
+// reciprocal per chunk. The lanes are then merged with Chan et al.'s
+// pairwise formula, and the last N % kWelfordLanes elements added one by one.
+template <int M, int N>
+void welford_rows(CPUContext& ctx, const std::span<const float, M * N> x,
+                  std::span<float, M> mean, std::span<float, M> var) {
+  constexpr int kLanes = kWelfordLanes;
+  constexpr int kChunks = N / kLanes;
+  for (int i = 0; i < M; ++i) {
+    const float* row = x.data() + i * N;
+    float lane_mean[kLanes] = {};
+    float lane_m2[kLanes] = {};
+    for (int c = 0; c < kChunks; ++c) {
+      const float* chunk = row + c * kLanes;
+      float inv_count = 1.0f / (c + 1);
+      for (int l = 0; l < kLanes; ++l) {
+        float delta = chunk[l] - lane_mean[l];
+        lane_mean[l] += delta * inv_count;
+        lane_m2[l] += delta * (chunk[l] - lane_mean[l]);
+      }
+    }
+
+    // Every lane holds kChunks elements.
+    float count = kChunks;
+    float row_mean = lane_mean[0];
+    float m2 = lane_m2[0];
+    if constexpr (kChunks > 0) {
+      for (int l = 1; l < kLanes; ++l) {
+        float total = count + kChunks;
+        float delta = lane_mean[l] - row_mean;
+        row_mean += delta * (kChunks / total);
+        m2 += lane_m2[l] + delta * delta * (count * kChunks / total);
+        count = total;
+      }
+    }
+    for (int j = kChunks * kLanes; j < N; ++j) {
+      count += 1.0f;
+      float delta = row[j] - row_mean;
+      row_mean += delta / count;
+      m2 += delta * (row[j] - row_mean);
+    }
+    mean[i] = row_mean;
+    var[i] = m2 / N;
+  }
+}
+
+// CPU implementation. xhat = (x - mean) * inv_std and y = gamma * xhat + beta
+// in one pass, with per-column statistics (batch norm).
+template <int M, int N>
+void normalize_columns(CPUContext& ctx, const std::span<const float, M * N> x,
+                       const std::span<const float, N> mean,
+                       const std::span<const float, N> inv_std,
+                       const std::span<const float, N> gamma,
+                       const std::span<const float, N> beta,
+                       std::span<float, M * N> xhat,
+                       std::span<float, M * N> y) {
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      float normalized = (x[i * N + j] - mean[j]) * inv_std[j];
+      xhat[i * N + j] = normalized;
+      y[i * N + j] = gamma[j] * normalized + beta[j];
+    }
+  }
+}
+
+// CPU implementation. As normalize_columns, with per-row statistics (layer
+// norm).
+template <int M, int N>
+void normalize_rows(CPUContext& ctx, const std::span<const float, M * N> x,
+                    const std::span<const float, M> mean,
+                    const std::span<const float, M> inv_std,
+                    const std::span<const float, N> gamma,
+                    const std::span<const float, N> beta,
+                    std::span<float, M * N> xhat, std::span<float, M * N> y) {
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      float normalized = (x[i * N + j] - mean[i]) * inv_std[i];
+      xhat[i * N + j] = normalized;
+      y[i * N + j] = gamma[j] * normalized + beta[j];
+    }
+  }
+}
+
+// CPU implementation of the batch norm backward pass in training mode, where
+// the statistics depend on the input:
+//   dx = gamma * inv_std / M * (M * dy - sum(dy) - xhat * sum(dy * xhat))
+// with sums over each column. Also writes the gamma and beta gradients, or
+// adds to them with `accumulate`.
+template <int M, int N>
+void batch_norm_backward(CPUContext& ctx,
+                         const std::span<const float, M * N> xhat,
+                         const std::span<const float, N> inv_std,
+                         const std::span<const float, N> gamma,
+                         const std::span<const float, M * N> grad_y,
+                         std::span<float, M * N> grad_x,
+                         std::span<float, N> grad_gamma,
+                         std::span<float, N> grad_beta,
+                         bool accumulate = false) {
+  if (accumulate) {
+    // dx needs this step's sums alone, so finish one column at a time and
+    // only then add its sums to the gradients.
+    for (int j = 0; j < N; ++j) {
+      float sum = 0.0f;
+      float dot = 0.0f;
+      for (int i = 0; i < M; ++i) {
+        sum += grad_y[i * N + j];
+        dot += grad_y[i * N + j] * xhat[i * N + j];
+      }
+      for (int i = 0; i < M; ++i) {
+        grad_x[i * N + j] =
+            gamma[j] * inv_std[j] / M *
+            (M * grad_y[i * N + j] - sum - xhat[i * N + j] * dot);
+      }
+      grad_gamma[j] += dot;
+      grad_beta[j] += sum;
+    }
+    return;
+  }
+  for (int j = 0; j < N; ++j) {
+    grad_gamma[j] = 0.0f;
+    grad_beta[j] = 0.0f;
+  }
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      grad_gamma[j] += grad_y[i * N + j] * xhat[i * N + j];
+      grad_beta[j] += grad_y[i * N + j];
+    }
+  }
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      grad_x[i * N + j] = gamma[j] * inv_std[j] / M *
+                          (M * grad_y[i * N + j] - grad_beta[j] -
+                           xhat[i * N + j] * grad_gamma[j]);
+    }
+  }
+}
+
+// CPU implementation of the layer norm backward pass:
+//   dx = inv_std / N * (N * g - sum(g) - xhat * sum(g * xhat)), g = gamma * dy
+// with sums over each row. Also writes the gamma and beta gradients, or adds
+// to them with `accumulate`.
+template <int M, int N>
+void layer_norm_backward(CPUContext& ctx,
+                         const std::span<const float, M * N> xhat,
+                         const std::span<const float, M> inv_std,
+                         const std::span<const float, N> gamma,
+                         const std::span<const float, M * N> grad_y,
+                         std::span<float, M * N> grad_x,
+                         std::span<float, N> grad_gamma,
+                         std::span<float, N> grad_beta,
+                         bool accumulate = false) {
+  if (!accumulate) {
+    std::ranges::fill(grad_gamma, 0.0f);
+    std::ranges::fill(grad_beta, 0.0f);
+  }
+  for (int i = 0; i < M; ++i) {
+    const float* dy = grad_y.data() + i * N;
+    const float* xh = xhat.data() + i * N;
+    float sum = 0.0f;
+    float dot = 0.0f;
+    for (int j = 0; j < N; ++j) {
+      float g = gamma[j] * dy[j];
+      sum += g;
+      dot += g * xh[j];
+      grad_gamma[j] += dy[j] * xh[j];
+      grad_beta[j] += dy[j];
+    }
+    float* dx = grad_x.data() + i * N;
+    for (int j = 0; j < N; ++j) {
+      dx[j] = inv_std[i] / N * (N * gamma[j] * dy[j] - sum - xh[j] * dot);
+    }
+  }
+}
+
+#endif  // NORMALIZE_HPP
@@ -1,9 +1,19 @@
 #ifndef OPERATIONS_HPP
 #define OPERATIONS_HPP
 
+#include "attention.hpp"
+#include "dropout_mask.hpp"
 #include "element_wise.hpp"
+#include "embedding_bag.hpp"
+#include "im2col.hpp"
 #include "matadd.hpp"
 #include "matmul.hpp"
 #include "mattranspose.hpp"
+#include "normalize.hpp"
+#include "optimizer.hpp"
+#include "packed_matmul.hpp"
+#include "pool2d.hpp"
+#include "rnn_cell.hpp"
+#include "rowwise.hpp"
 
 #endif  // OPERATIONS_HPP
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Parameter updates applied by layers in update_parameters.
+
+// Plain SGD: params -= learning_rate * grads.
+template <size_t N>
+void sgd_update(std::span<float, N> params, const std::span<float, N> grads,
+                float learning_rate) {
+  for (size_t i = 0; i < N; ++i) {
+    params[i] -= learning_rate * grads[i];
+  }
+}
+
+// Sparse SGD on the rows of a row-major table with Dim columns: only `rows`
+// are read or written, so the cost is independent of the table's size.
+template <int Dim>
+void sparse_sgd_update(std::span<float> table, const std::vector<int>& rows,
+                       const std::vector<float>& grads, float learning_rate) {
+  for (size_t r = 0; r < rows.size(); ++r) {
+    float* row = table.data() + size_t(rows[r]) * Dim;
+    const float* grad = grads.data() + r * Dim;
+    for (int d = 0; d < Dim; ++d) {
+      row[d] -= learning_rate * grad[d];
+    }
+  }
+}
+
+struct AdamOptions {
+  float beta1 = 0.9f;
+  float beta2 = 0.999f;
+  float epsilon = 1e-8f;
+};
+
+// Lazy Adam: the moments of a row are only decayed and updated on the steps
+// that touch it, so rows that are rarely seen keep their moments between
+// visits. Bias correction uses the global step count (1 on the first step).
+template <int Dim>
+void lazy_adam_update(std::span<float> table, std::span<float> first_moments,
+                      std::span<float> second_moments,
+                      const std::vector<int>& rows,
+                      const std::vector<float>& grads, float learning_rate,
+                      const AdamOptions& options, long step) {
+  float correction1 = 1.0f - std::pow(options.beta1, step);
+  float correction2 = 1.0f - std::pow(options.beta2, step);
+  for (size_t r = 0; r < rows.size(); ++r) {
+    size_t offset = size_t(rows[r]) * Dim;
+    float* row = table.data() + offset;
+    float* m = first_moments.data() + offset;
+    float* v = second_moments.data() + offset;
+    const float* grad = grads.data() + r * Dim;
+    for (int d = 0; d < Dim; ++d) {
+      m[d] = options.beta1 * m[d] + (1.0f - options.beta1) * grad[d];
+      v[d] = options.beta2 * v[d] + (1.0f - options.beta2) * grad[d] * grad[d];
+      row[d] -= learning_rate * (m[d] / correction1) /
+                (std::sqrt(v[d] / correction2) + options.epsilon);
+    }
+  }
+}
+
+#endif  // OPTIMIZER_HPP
@@ -0,0 +1,112 @@
+#ifndef PACKED_MATMUL_HPP
+#define PACKED_MATMUL_HPP
+
+#include <algorithm>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "../context/parallel.hpp"
+#include "../tensor/tensor.hpp"
+
+// Pre-packed weights for inference. A K x N weight matrix and its N biases
+// are stored as ceil(N / kPanelWidth) panels of kPanelWidth columns. Each
+// panel holds its biases followed by its K rows, so the kernel streams one
+// contiguous block per panel and keeps the panel's accumulators in registers.
+// Columns past N in the last panel are zero padding.
+const int kPanelWidth = 16;
+
+template <int K, int N>
+constexpr int packed_size() {
+  return (N + kPanelWidth - 1) / kPanelWidth * (K + 1) * kPanelWidth;
+}
+
+template <ValidContext Context, int K, int N>
+void pack_weights(Context& ctx, const Tensor<Context, K, N>& weights,
+                  const Tensor<Context, 1, N>& biases,
+                  Tensor<Context, 1, packed_size<K, N>()>& packed) {
+  pack_weights<K, N>(ctx, weights.get(), biases.get(), packed.get());
+}
+
+// CPU implementation
+template <int K, int N>
+void pack_weights(CPUContext& ctx, const std::span<const float, K * N> weights,
+                  const std::span<const float, N> biases,
+                  std::span<float, packed_size<K, N>()> packed) {
+  std::ranges::fill(packed, 0.0f);
+  for (int p = 0; p * kPanelWidth < N; ++p) {
+    float* panel = packed.data() + p * (K + 1) * kPanelWidth;
+    int first = p * kPanelWidth;
+    int width = std::min(kPanelWidth, N - first);
+    std::copy_n(biases.data() + first, width, panel);
+    for (int k = 0; k < K; ++k) {
+      std::copy_n(weights.data() + k * N + first, width,
+                  panel + (k + 1) * kPanelWidth);
+    }
+  }
+}
+
+// Inverse of pack_weights: recovers the weights and biases from the panels.
+template <ValidContext Context, int K, int N>
+void unpack_weights(Context& ctx,
+                    const Tensor<Context, 1, packed_size<K, N>()>& packed,
+                    Tensor<Context, K, N>& weights,
+                    Tensor<Context, 1, N>& biases) {
+  unpack_weights<K, N>(ctx, packed.get(), weights.get(), biases.get());
+}
+
+// CPU implementation
+template <int K, int N>
+void unpack_weights(CPUContext& ctx,
+                    const std::span<const float, packed_size<K, N>()> packed,
+                    std::span<float, K * N> weights,
+                    std::span<float, N> biases) {
+  for (int p = 0; p * kPanelWidth < N; ++p) {
+    const float* panel = packed.data() + p * (K + 1) * kPanelWidth;
+    int first = p * kPanelWidth;
+    int width = std::min(kPanelWidth, N - first);
+    std::copy_n(panel, width, biases.data() + first);
+    for (int k = 0; k < K; ++k) {
+      std::copy_n(panel + (k + 1) * kPanelWidth, width,
+                  weights.data() + k * N + first);
+    }
+  }
+}
+
+template <ValidContext Context, int M, int K, int N>
+void packed_matmul_bias(Context& ctx, const ConstTensorView<Context, M, K>& A,
+                        const Tensor<Context, 1, packed_size<K, N>()>& packed,
+                        const TensorView<Context, M, N>& C) {
+  packed_matmul_bias<M, K, N>(ctx, A.get(), packed.get(), C.get());
+}
+
+// CPU implementation of C = A * W + b on packed (W, b). Panels are split
+// across the context's threads.
+template <int M, int K, int N>
+void packed_matmul_bias(
+    CPUContext& ctx, const std::span<const float, M * K> A,
+    const std::span<const float, packed_size<K, N>()> packed,
+    std::span<float, M * N> C) {
+  constexpr int kNumPanels = (N + kPanelWidth - 1) / kPanelWidth;
+  constexpr size_t kGrain = parallel_grain(M * K * kPanelWidth);
+  parallel_for(ctx, kNumPanels, kGrain, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; ++p) {
+      const float* panel = packed.data() + p * (K + 1) * kPanelWidth;
+      int first = p * kPanelWidth;
+      int width = std::min(kPanelWidth, N - first);
+      for (int i = 0; i < M; ++i) {
+        const float* a = A.data() + i * K;
+        float acc[kPanelWidth];
+        std::copy_n(panel, kPanelWidth, acc);
+        for (int k = 0; k < K; ++k) {
+          const float* row = panel + (k + 1) * kPanelWidth;
+          for (int j = 0; j < kPanelWidth; ++j) {
+            acc[j] += a[k] * row[j];
+          }
+        }
+        std::copy_n(acc, width, C.data() + i * N + first);
+      }
+    }
+  });
+}
+
+#endif  // PACKED_MATMUL_HPP
@@ -0,0 +1,128 @@
+#ifndef POOL2D_HPP
+#define POOL2D_HPP
+
+#include <algorithm>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "im2col.hpp"
+
+// Pooling over NHWC images, with windows described by a ConvGeometry. Every
+// channel is pooled independently, so the innermost loops run over channels
+// and read contiguous memory.
+
+// CPU implementation. `argmax` receives, for every output, the input index it
+// was taken from, for use by max_pool2d_backward. Padded positions are never
+// selected; a window that only covers padding outputs 0 with argmax -1, so it
+// passes no gradient back.
+template <typename Geometry>
+void max_pool2d(CPUContext& ctx, const std::span<const float> input,
+                std::span<float> output, std::span<int> argmax) {
+  constexpr int C = Geometry::kChannels;
+  for (int p = 0; p < Geometry::kPositions; ++p) {
+    float* out = output.data() + p * C;
+    int* arg = argmax.data() + p * C;
+    std::fill_n(out, C, 0.0f);
+    std::fill_n(arg, C, -1);
+    int oy = p / Geometry::kOutWidth;
+    int ox = p % Geometry::kOutWidth;
+    for (int ky = 0; ky < Geometry::kKernel; ++ky) {
+      int y = oy * Geometry::kStride - Geometry::kPadding +
+              ky * Geometry::kDilation;
+      for (int kx = 0; kx < Geometry::kKernel; ++kx) {
+        int x = ox * Geometry::kStride - Geometry::kPadding +
+                kx * Geometry::kDilation;
+        if (y < 0 || y >= Geometry::kHeight || x < 0 ||
+            x >= Geometry::kWidth) {
+          continue;
+        }
+        int base = (y * Geometry::kWidth + x) * C;
+        for (int c = 0; c < C; ++c) {
+          if (arg[c] < 0 || input[base + c] > out[c]) {
+            out[c] = input[base + c];
+            arg[c] = base + c;
+          }
+        }
+      }
+    }
+  }
+}
+
+// CPU implementation. Routes each output gradient to the input it came from.
+template <typename Geometry>
+void max_pool2d_backward(CPUContext& ctx, const std::span<const float> grad_out,
+                         const std::span<const int> argmax,
+                         std::span<float> grad_in) {
+  std::ranges::fill(grad_in, 0.0f);
+  for (size_t i = 0; i < grad_out.size(); ++i) {
+    if (argmax[i] >= 0) {
+      grad_in[argmax[i]] += grad_out[i];
+    }
+  }
+}
+
+// CPU implementation. Padded positions count as zeros, so every window is
+// divided by Kernel * Kernel.
+template <typename Geometry>
+void avg_pool2d(CPUContext& ctx, const std::span<const float> input,
+                std::span<float> output) {
+  constexpr int C = Geometry::kChannels;
+  constexpr float kScale = 1.0f / (Geometry::kKernel * Geometry::kKernel);
+  for (int p = 0; p < Geometry::kPositions; ++p) {
+    float* out = output.data() + p * C;
+    std::fill_n(out, C, 0.0f);
+    int oy = p / Geometry::kOutWidth;
+    int ox = p % Geometry::kOutWidth;
+    for (int ky = 0; ky < Geometry::kKernel; ++ky) {
+      int y = oy * Geometry::kStride - Geometry::kPadding +
+              ky * Geometry::kDilation;
+      for (int kx = 0; kx < Geometry::kKernel; ++kx) {
+        int x = ox * Geometry::kStride - Geometry::kPadding +
+                kx * Geometry::kDilation;
+        if (y < 0 || y >= Geometry::kHeight || x < 0 ||
+            x >= Geometry::kWidth) {
+          continue;
+        }
+        const float* pixel = input.data() + (y * Geometry::kWidth + x) * C;
+        for (int c = 0; c < C; ++c) {
+          out[c] += pixel[c];
+        }
+      }
+    }
+    for (int c = 0; c < C; ++c) {
+      out[c] *= kScale;
+    }
+  }
+}
+
+// CPU implementation. Spreads each output gradient evenly over its window.
+template <typename Geometry>
+void avg_pool2d_backward(CPUContext& ctx, const std::span<const float> grad_out,
+                         std::span<float> grad_in) {
+  constexpr int C = Geometry::kChannels;
+  constexpr float kScale = 1.0f / (Geometry::kKernel * Geometry::kKernel);
+  std::ranges::fill(grad_in, 0.0f);
+  for (int p = 0; p < Geometry::kPositions; ++p) {
+    const float* grad = grad_out.data() + p * C;
+    int oy = p / Geometry::kOutWidth;
+    int ox = p % Geometry::kOutWidth;
+    for (int ky = 0; ky < Geometry::kKernel; ++ky) {
+      int y = oy * Geometry::kStride - Geometry::kPadding +
+              ky * Geometry::kDilation;
+      for (int kx = 0; kx < Geometry::kKernel; ++kx) {
+        int x = ox * Geometry::kStride - Geometry::kPadding +
+                kx * Geometry::kDilation;
+        if (y < 0 || y >= Geometry::kHeight || x < 0 ||
+            x >= Geometry::kWidth) {
+          continue;
+        }
+        float* pixel = grad_in.data() + (y * Geometry::kWidth + x) * C;
+        for (int c = 0; c < C; ++c) {
+          pixel[c] += kScale * grad[c];
+        }
+      }
+    }
+  }
+}
+
+#endif  // POOL2D_HPP
@@ -0,0 +1,143 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "../context/parallel.hpp"
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). Each 128-bit counter maps to four
+// independent 32-bit outputs with no state carried between calls, so element
+// i of a stream can be generated by any thread in any order.
+struct Philox4x32 {
+  using Block = std::array<uint32_t, 4>;
+
+  static constexpr uint32_t kMul0 = 0xD2511F53;
+  static constexpr uint32_t kMul1 = 0xCD9E8D57;
+  static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+  static constexpr int kRounds = 10;
+
+  static Block generate(Block counter, std::array<uint32_t, 2> key) {
+    for (int round = 0; round < kRounds; ++round) {
+      uint64_t product0 = static_cast<uint64_t>(kMul0) * counter[0];
+      uint64_t product1 = static_cast<uint64_t>(kMul1) * counter[2];
+      counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                 static_cast<uint32_t>(product1),
+                 static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                 static_cast<uint32_t>(product0)};
+      key[0] += kWeyl0;
+      key[1] += kWeyl1;
+    }
+    return counter;
+  }
+
+  // Block `index` of stream `stream` under `seed`.
+  static Block generate(uint64_t seed, uint64_t stream, uint64_t index) {
+    return generate({static_cast<uint32_t>(index),
+                     static_cast<uint32_t>(index >> 32),
+                     static_cast<uint32_t>(stream),
+                     static_cast<uint32_t>(stream >> 32)},
+                    {static_cast<uint32_t>(seed),
+                     static_cast<uint32_t>(seed >> 32)});
+  }
+
+  // Blocks first .. first + Blocks - 1 of a stream, as the same Blocks * 4
+  // words that calling generate once per block would give. The rounds run
+  // over all blocks at once in structure-of-arrays form, so they vectorise.
+  template <int Blocks>
+  static std::array<uint32_t, 4 * Blocks> generate_blocks(uint64_t seed,
+                                                          uint64_t stream,
+                                                          uint64_t first) {
+    std::array<uint32_t, Blocks> c0, c1, c2, c3;
+    for (int b = 0; b < Blocks; ++b) {
+      c0[b] = static_cast<uint32_t>(first + b);
+      c1[b] = static_cast<uint32_t>((first + b) >> 32);
+      c2[b] = static_cast<uint32_t>(stream);
+      c3[b] = static_cast<uint32_t>(stream >> 32);
+    }
+    uint32_t key0 = static_cast<uint32_t>(seed);
+    uint32_t key1 = static_cast<uint32_t>(seed >> 32);
+    for (int round = 0; round < kRounds; ++round) {
+      for (int b = 0; b < Blocks; ++b) {
+        uint64_t product0 = static_cast<uint64_t>(kMul0) * c0[b];
+        uint64_t product1 = static_cast<uint64_t>(kMul1) * c2[b];
+        uint32_t next0 = static_cast<uint32_t>(product1 >> 32) ^ c1[b] ^ key0;
+        uint32_t next2 = static_cast<uint32_t>(product0 >> 32) ^ c3[b] ^ key1;
+        c1[b] = static_cast<uint32_t>(product1);
+        c3[b] = static_cast<uint32_t>(product0);
+        c0[b] = next0;
+        c2[b] = next2;
+      }
+      key0 += kWeyl0;
+      key1 += kWeyl1;
+    }
+    std::array<uint32_t, 4 * Blocks> words;
+    for (int b = 0; b < Blocks; ++b) {
+      words[4 * b] = c0[b];
+      words[4 * b + 1] = c1[b];
+      words[4 * b + 2] = c2[b];
+      words[4 * b + 3] = c3[b];
+    }
+    return words;
+  }
+};
+
+// Maps the top 24 bits of x to a float in [0, 1).
+inline float uint32_to_unit_float(uint32_t x) {
+  return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// out[i] = uniform sample in [lb, ub) for element (offset + i) of the given
+// stream. The result only depends on (seed, stream, offset), never on how many
+// threads the context uses. Each thread draws its blocks kUniformFillBlocks at
+// a time with generate_blocks, so the Philox rounds and the conversion to
+// float both vectorise.
+constexpr int kUniformFillBlocks = 16;
+
+// parallel_for grain: a block is four elements at roughly 16 operations each.
+constexpr size_t kUniformFillGrain = parallel_grain(64);
+
+inline void uniform_fill(const CPUContext& ctx, std::span<float> out, float lb,
+                         float ub, uint64_t seed, uint64_t stream,
+                         uint64_t offset = 0) {
+  float scale = ub - lb;
+  uint64_t end_element = offset + out.size();
+  uint64_t first_block = offset / 4;
+  uint64_t last_block = (end_element + 3) / 4;
+  // Converts the words of `count` blocks starting at `block`, skipping those
+  // outside the range at either end.
+  auto store = [&](uint64_t block, const uint32_t* words, uint64_t count) {
+    uint64_t element = block * 4;
+    uint64_t lo = std::max(element, offset);
+    uint64_t hi = std::min(element + 4 * count, end_element);
+    float* dst = out.data() + (lo - offset);
+    const uint32_t* src = words + (lo - element);
+    for (uint64_t i = 0; i < hi - lo; ++i) {
+      dst[i] = lb + scale * uint32_to_unit_float(src[i]);
+    }
+  };
+  size_t blocks = last_block - first_block;
+  parallel_for(ctx, blocks, kUniformFillGrain, [&](size_t begin, size_t end) {
+    uint64_t block = first_block + begin;
+    for (; block + kUniformFillBlocks <= first_block + end;
+         block += kUniformFillBlocks) {
+      std::array<uint32_t, 4 * kUniformFillBlocks> words =
+          Philox4x32::generate_blocks<kUniformFillBlocks>(seed, stream, block);
+      store(block, words.data(), kUniformFillBlocks);
+    }
+    // Fewer than kUniformFillBlocks blocks are left; bounding the loop by
+    // that as well keeps GCC from warning about pointer overflow at -O3.
+    for (int i = 0; i < kUniformFillBlocks && block < first_block + end;
+         ++i, ++block) {
+      Philox4x32::Block bits = Philox4x32::generate(seed, stream, block);
+      store(block, bits.data(), 1);
+    }
+  });
+}
+
+#endif  // RANDOM_HPP
@@ -0,0 +1,127 @@
+#ifndef RNN_CELL_HPP
+#define RNN_CELL_HPP
+
+#include <array>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "element_wise.hpp"
+
+// Element-wise halves of one LSTM or GRU timestep. The matrix products are
+// done by the layers with matmul; these kernels apply the gate
+// nonlinearities with the sigmoid and tanh kernels of element_wise.hpp, so
+// they follow the context's math mode, and the state update in a pass over
+// contiguous memory.
+
+// CPU implementation. Gates are laid out [i | f | g | o], each H wide. On
+// entry `gates` holds h_{t-1} * W_h; on exit it holds the activated gates.
+template <int H>
+void lstm_cell(CPUContext& ctx, const std::span<const float, 4 * H> input_proj,
+               std::span<float, 4 * H> gates,
+               const std::span<const float, H> c_prev, std::span<float, H> c,
+               std::span<float, H> h) {
+  for (int j = 0; j < 4 * H; ++j) {
+    gates[j] += input_proj[j];
+  }
+  std::span<float, 2 * H> i_f = gates.template subspan<0, 2 * H>();
+  std::span<float, H> g = gates.template subspan<2 * H, H>();
+  std::span<float, H> o = gates.template subspan<3 * H, H>();
+  sigmoid<1, 2 * H>(ctx, i_f, i_f);
+  tanh<1, H>(ctx, g, g);
+  sigmoid<1, H>(ctx, o, o);
+  for (int j = 0; j < H; ++j) {
+    c[j] = gates[H + j] * c_prev[j] + gates[j] * gates[2 * H + j];
+  }
+  tanh<1, H>(ctx, c, h);
+  for (int j = 0; j < H; ++j) {
+    h[j] *= o[j];
+  }
+}
+
+// CPU implementation. Takes the loss gradient w.r.t. h_t and, in `grad_c`,
+// w.r.t. c_t from step t + 1; leaves the gradient w.r.t. c_{t-1} in `grad_c`
+// and w.r.t. the pre-activation gates in `grad_gates`.
+template <int H>
+void lstm_cell_backward(CPUContext& ctx,
+                        const std::span<const float, 4 * H> gates,
+                        const std::span<const float, H> c_prev,
+                        const std::span<const float, H> c,
+                        const std::span<const float, H> grad_h,
+                        std::span<float, H> grad_c,
+                        std::span<float, 4 * H> grad_gates) {
+  MathMode mode = ctx.math_mode();
+  std::array<float, H> tanh_c;
+  tanh<1, H>(ctx, c, tanh_c, mode);
+  for (int j = 0; j < H; ++j) {
+    float i = gates[j];
+    float f = gates[H + j];
+    float g = gates[2 * H + j];
+    float o = gates[3 * H + j];
+    float dc = grad_c[j] + grad_h[j] * o * tanh_slope(tanh_c[j], mode);
+    grad_gates[j] = dc * g * sigmoid_slope(i, mode);
+    grad_gates[H + j] = dc * c_prev[j] * sigmoid_slope(f, mode);
+    grad_gates[2 * H + j] = dc * i * tanh_slope(g, mode);
+    grad_gates[3 * H + j] = grad_h[j] * tanh_c[j] * sigmoid_slope(o, mode);
+    grad_c[j] = dc * f;
+  }
+}
+
+// CPU implementation. Gates are laid out [r | z | n], each H wide. On entry
+// `recurrent` holds h_{t-1} * W_h; on exit its n part also includes the
+// hidden bias, as needed by the backward pass. The new state is
+// h = (1 - z) * n + z * h_{t-1}, with n = tanh(x_n + r * (h W_hn + b_hn)).
+template <int H>
+void gru_cell(CPUContext& ctx, const std::span<const float, 3 * H> input_proj,
+              std::span<float, 3 * H> recurrent,
+              const std::span<const float, H> hidden_biases,
+              const std::span<const float, H> h_prev,
+              std::span<float, 3 * H> gates, std::span<float, H> h) {
+  std::span<float, 2 * H> r_z = gates.template subspan<0, 2 * H>();
+  std::span<float, H> n = gates.template subspan<2 * H, H>();
+  for (int j = 0; j < 2 * H; ++j) {
+    r_z[j] = input_proj[j] + recurrent[j];
+  }
+  sigmoid<1, 2 * H>(ctx, r_z, r_z);
+  for (int j = 0; j < H; ++j) {
+    recurrent[2 * H + j] += hidden_biases[j];
+    n[j] = input_proj[2 * H + j] + gates[j] * recurrent[2 * H + j];
+  }
+  tanh<1, H>(ctx, n, n);
+  for (int j = 0; j < H; ++j) {
+    float z = gates[H + j];
+    h[j] = (1.0f - z) * n[j] + z * h_prev[j];
+  }
+}
+
+// CPU implementation. Takes the loss gradient w.r.t. h_t and writes the
+// gradients w.r.t. the input-side and recurrent-side pre-activations, which
+// differ only in the n gate, and the direct part of the gradient w.r.t.
+// h_{t-1} (the part through W_h is left to the caller).
+template <int H>
+void gru_cell_backward(CPUContext& ctx,
+                       const std::span<const float, 3 * H> gates,
+                       const std::span<const float, 3 * H> recurrent,
+                       const std::span<const float, H> h_prev,
+                       const std::span<const float, H> grad_h,
+                       std::span<float, 3 * H> grad_input_gates,
+                       std::span<float, 3 * H> grad_recurrent_gates,
+                       std::span<float, H> grad_h_prev) {
+  MathMode mode = ctx.math_mode();
+  for (int j = 0; j < H; ++j) {
+    float r = gates[j];
+    float z = gates[H + j];
+    float n = gates[2 * H + j];
+    float dn = grad_h[j] * (1.0f - z) * tanh_slope(n, mode);
+    float dr = dn * recurrent[2 * H + j] * sigmoid_slope(r, mode);
+    float dz = grad_h[j] * (h_prev[j] - n) * sigmoid_slope(z, mode);
+    grad_input_gates[j] = dr;
+    grad_input_gates[H + j] = dz;
+    grad_input_gates[2 * H + j] = dn;
+    grad_recurrent_gates[j] = dr;
+    grad_recurrent_gates[H + j] = dz;
+    grad_recurrent_gates[2 * H + j] = dn * r;
+    grad_h_prev[j] = grad_h[j] * z;
+  }
+}
+
+#endif  // RNN_CELL_HPP
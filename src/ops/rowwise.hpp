@@ -0,0 +1,37 @@
+#ifndef ROWWISE_HPP
+#define ROWWISE_HPP
+
+#include <algorithm>
+#include <span>
+
+// Broadcasts and reductions across the rows of a row-major M x N matrix, as
+// used for per-feature biases of layers that process several rows (timesteps,
+// pixels) at once.
+
+// Adds a 1 x N bias to every row of an M x N matrix.
+template <int M, int N>
+void add_bias_rows(std::span<float, M * N> values,
+                   const std::span<const float, N> biases) {
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      values[i * N + j] += biases[j];
+    }
+  }
+}
+
+// Column sums of an M x N matrix starting at column First, written to `sums`
+// or, with `accumulate`, added to it.
+template <int M, int N, int First = 0, int Count = N>
+void sum_rows(const std::span<const float, M * N> values, std::span<float> sums,
+              bool accumulate = false) {
+  if (!accumulate) {
+    std::ranges::fill(sums, 0.0f);
+  }
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < Count; ++j) {
+      sums[j] += values[i * N + First + j];
+    }
+  }
+}
+
+#endif  // ROWWISE_HPP
@@ -0,0 +1,214 @@
+#ifndef CPU_ALLOCATOR_HPP
+#define CPU_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "../context/topology.hpp"
+#include "memory_tracker.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// For CPU devices we align the memory to kAlignment bytes.
+// This allows for better performance on SIMD operations.
+const size_t kAlignment = 64;
+
+// Buffers of at least kHugePageThreshold bytes are backed by 2 MB pages when
+// the system allows it, which cuts TLB misses when GEMM streams large
+// weight matrices. Below the threshold the alignment padding is not worth it.
+const size_t kHugePageSize = 2 * 1024 * 1024;
+const size_t kHugePageThreshold = 2 * kHugePageSize;
+
+struct StorageOptions {
+  int numa_node = kAnyNumaNode;
+  // Zero disables the huge page path.
+  size_t huge_page_threshold = kHugePageThreshold;
+  // When set, Storage reports its buffer to the tracker under `tag`. Each
+  // buffer shares ownership of its tracker, so the tracker lives at least
+  // as long as the buffers it counts.
+  std::shared_ptr<MemoryTracker> tracker;
+  MemoryTag tag;
+};
+
+enum class AllocationKind {
+  kAligned,  // std::aligned_alloc, released with std::free.
+  kMapped,   // Anonymous mmap, released with munmap.
+};
+
+enum class HugePages {
+  kNone,
+  // madvise(MADV_HUGEPAGE) on a 2 MB aligned mapping with transparent huge
+  // pages enabled. Only a request: khugepaged may back the range with huge
+  // pages later, or never, and the kernel does not say which.
+  kTransparentRequested,
+  kExplicit,  // MAP_HUGETLB, from the reserved hugetlbfs pool.
+};
+
+inline const char* to_string(HugePages huge_pages) {
+  switch (huge_pages) {
+    case HugePages::kTransparentRequested:
+      return "transparent (requested)";
+    case HugePages::kExplicit:
+      return "explicit";
+    default:
+      return "none";
+  }
+}
+
+struct CPUAllocation {
+  void* data = nullptr;
+  size_t bytes = 0;
+  AllocationKind kind = AllocationKind::kAligned;
+  int numa_node = kAnyNumaNode;
+  HugePages huge_pages = HugePages::kNone;
+};
+
+inline size_t round_up(size_t bytes, size_t multiple) {
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+// Whether madvise(MADV_HUGEPAGE) can have any effect, i.e. the transparent
+// huge page mode is "always" or "madvise" rather than "never". Read once.
+inline bool transparent_huge_pages_enabled() {
+  static const bool enabled = []() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string modes;
+    std::getline(file, modes);
+    return modes.find("[always]") != std::string::npos ||
+           modes.find("[madvise]") != std::string::npos;
+  }();
+  return enabled;
+}
+
+#ifdef __linux__
+// Asks the kernel to place [data, data + bytes) on `node`. We use the
+// preferred policy rather than a strict bind so that a full node falls back
+// to other nodes instead of failing the allocation.
+inline bool bind_to_numa_node(void* data, size_t bytes, int node) {
+  const int kMpolPreferred = 1;
+  const size_t kMaskBits = 8 * sizeof(unsigned long);
+  if (node < 0 || static_cast<size_t>(node) >= kMaskBits) {
+    return false;
+  }
+  unsigned long node_mask = 1UL << node;
+  return syscall(SYS_mbind, data, bytes, kMpolPreferred, &node_mask,
+                 kMaskBits + 1, 0) == 0;
+}
+
+// Maps `bytes` (rounded up to `alignment`) at an address aligned to
+// `alignment`, trimming the over-mapped head and tail.
+inline CPUAllocation map_aligned(size_t bytes, size_t alignment) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t mapped_bytes = round_up(bytes, alignment);
+  size_t slack = alignment > page ? alignment : 0;
+  void* raw = mmap(nullptr, mapped_bytes + slack, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return {};
+  }
+  char* begin = static_cast<char*>(raw);
+  char* aligned = reinterpret_cast<char*>(
+      round_up(reinterpret_cast<size_t>(begin), alignment));
+  if (aligned > begin) {
+    munmap(begin, aligned - begin);
+  }
+  char* end = begin + mapped_bytes + slack;
+  if (aligned + mapped_bytes < end) {
+    munmap(aligned + mapped_bytes, end - (aligned + mapped_bytes));
+  }
+  return {aligned, mapped_bytes, AllocationKind::kMapped};
+}
+
+inline CPUAllocation map_explicit_huge_pages(size_t bytes) {
+#ifdef MAP_HUGETLB
+  size_t mapped_bytes = round_up(bytes, kHugePageSize);
+  void* data = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (data != MAP_FAILED) {
+    return {data, mapped_bytes, AllocationKind::kMapped, kAnyNumaNode,
+            HugePages::kExplicit};
+  }
+#endif
+  return {};
+}
+
+// Page-granular allocation for the huge page and NUMA paths. Huge pages are
+// taken from the hugetlbfs pool if one is reserved, otherwise we fall back to
+// transparent huge pages, and finally to normal pages if neither is enabled.
+// NUMA-bound pages are first-touched from the calling thread so that they are
+// resident before any kernel streams them.
+inline CPUAllocation map_pages(size_t bytes, bool huge, int node) {
+  CPUAllocation allocation;
+  if (huge) {
+    allocation = map_explicit_huge_pages(bytes);
+  }
+  if (allocation.data == nullptr) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    allocation = map_aligned(bytes, huge ? kHugePageSize : page);
+  }
+  if (allocation.data == nullptr) {
+    return {};
+  }
+  if (huge && allocation.huge_pages == HugePages::kNone &&
+      transparent_huge_pages_enabled() &&
+      madvise(allocation.data, allocation.bytes, MADV_HUGEPAGE) == 0) {
+    allocation.huge_pages = HugePages::kTransparentRequested;
+  }
+  if (node != kAnyNumaNode) {
+    if (bind_to_numa_node(allocation.data, allocation.bytes, node)) {
+      allocation.numa_node = node;
+    }
+    std::memset(allocation.data, 0, allocation.bytes);
+  }
+  return allocation;
+}
+#endif
+
+inline CPUAllocation cpu_allocate(size_t bytes,
+                                  const StorageOptions& options = {}) {
+#ifdef __linux__
+  bool huge = options.huge_page_threshold > 0 &&
+              bytes >= options.huge_page_threshold;
+  if (huge || options.numa_node != kAnyNumaNode) {
+    CPUAllocation allocation = map_pages(bytes, huge, options.numa_node);
+    if (allocation.data != nullptr) {
+      return allocation;
+    }
+  }
+#endif
+  // std::aligned_alloc requires the size to be a multiple of the alignment.
+  size_t aligned_bytes = round_up(bytes > 0 ? bytes : 1, kAlignment);
+  void* data = std::aligned_alloc(kAlignment, aligned_bytes);
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  return {data, aligned_bytes, AllocationKind::kAligned, kAnyNumaNode};
+}
+
+inline void cpu_free(CPUAllocation& allocation) {
+  if (allocation.data == nullptr) {
+    return;
+  }
+  switch (allocation.kind) {
+    case AllocationKind::kAligned:
+      std::free(allocation.data);
+      break;
+    case AllocationKind::kMapped:
+#ifdef __linux__
+      munmap(allocation.data, allocation.bytes);
+#endif
+      break;
+  }
+  allocation = {};
+}
+
+#endif  // CPU_ALLOCATOR_HPP
@@ -0,0 +1,52 @@
+#ifndef DYNAMIC_TENSOR_HPP
+#define DYNAMIC_TENSOR_HPP
+
+#include <memory>
+#include <span>
+
+#include "../context/contexts.hpp"
+#include "cpu_allocator.hpp"
+
+// Row-major float matrix whose shape is only known at runtime. It owns its
+// buffer, which copies share.
+template <ValidContext Context>
+class DynamicTensor {
+ public:
+  DynamicTensor() : data_(nullptr), rows_(0), cols_(0) {}
+
+  DynamicTensor(Context& ctx, size_t rows, size_t cols)
+      : rows_(rows), cols_(cols) {
+    auto* allocation = new CPUAllocation(
+        cpu_allocate(rows * cols * sizeof(float), ctx.storage_options()));
+    owner_ = std::shared_ptr<CPUAllocation>(
+        allocation, [](CPUAllocation* allocation) {
+          cpu_free(*allocation);
+          delete allocation;
+        });
+    data_ = static_cast<float*>(allocation->data);
+  }
+
+  size_t rows() const { return rows_; }
+
+  size_t cols() const { return cols_; }
+
+  size_t size() const { return rows_ * cols_; }
+
+  float* data() { return data_; }
+
+  const float* data() const { return data_; }
+
+  std::span<float> get() { return std::span<float>(data_, size()); }
+
+  std::span<const float> get() const {
+    return std::span<const float>(data_, size());
+  }
+
+ private:
+  std::shared_ptr<CPUAllocation> owner_;
+  float* data_;
+  size_t rows_;
+  size_t cols_;
+};
+
+#endif  // DYNAMIC_TENSOR_HPP
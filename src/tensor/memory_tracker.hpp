@@ -0,0 +1,149 @@
+#ifndef MEMORY_TRACKER_HPP
+#define MEMORY_TRACKER_HPP
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+
+// What a tracked buffer holds.
+enum class MemoryRole {
+  kWeights,     // Trainable parameters, their packed copies and statistics.
+  kGrad,        // Gradients w.r.t. parameters and activations.
+  kActivation,  // Layer outputs and values cached for backward.
+  kOptimizer,   // Optimizer state, e.g. Adam moments.
+  kScratch,     // Transposes, im2col buffers and other temporaries.
+};
+
+inline const char* to_string(MemoryRole role) {
+  switch (role) {
+    case MemoryRole::kWeights:
+      return "weights";
+    case MemoryRole::kGrad:
+      return "grad";
+    case MemoryRole::kActivation:
+      return "activation";
+    case MemoryRole::kOptimizer:
+      return "optimizer";
+    case MemoryRole::kScratch:
+      return "scratch";
+  }
+  return "unknown";
+}
+
+// Owner of buffers that no Network has claimed.
+constexpr int kNoMemoryOwner = -1;
+
+// Owner and role of a buffer. Network sets the owner to the index of the layer
+// the buffer belongs to.
+struct MemoryTag {
+  int owner = kNoMemoryOwner;
+  MemoryRole role = MemoryRole::kScratch;
+
+  auto operator<=>(const MemoryTag&) const = default;
+};
+
+struct MemoryUsage {
+  size_t current_bytes = 0;
+  size_t peak_bytes = 0;
+};
+
+// Counts the bytes of live Storage buffers, in total and per tag, with the
+// peak of each. Attach one to a context with CPUContext::set_memory_tracker
+// before building a network; every buffer reports to the tracker that was
+// attached when it was allocated, so separate trackers (or contexts) keep
+// networks apart. Bytes are those actually allocated, including alignment
+// and page rounding.
+class MemoryTracker {
+ public:
+  void allocated(const MemoryTag& tag, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    add_(total_, bytes);
+    add_(by_tag_[tag], bytes);
+  }
+
+  void released(const MemoryTag& tag, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    total_.current_bytes -= bytes;
+    by_tag_[tag].current_bytes -= bytes;
+  }
+
+  // Moves a live buffer to a new tag. The total is unchanged.
+  void retagged(const MemoryTag& from, const MemoryTag& to, size_t bytes) {
+    if (from == to) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    by_tag_[from].current_bytes -= bytes;
+    add_(by_tag_[to], bytes);
+  }
+
+  size_t current_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_.current_bytes;
+  }
+
+  size_t peak_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_.peak_bytes;
+  }
+
+  MemoryUsage usage(const MemoryTag& tag) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_tag_.find(tag);
+    return it == by_tag_.end() ? MemoryUsage() : it->second;
+  }
+
+  // Usage of every tag seen so far, ordered by owner then role.
+  std::map<MemoryTag, MemoryUsage> breakdown() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_tag_;
+  }
+
+  // Restarts peak tracking from the current usage, e.g. after setup so that
+  // the next peak covers one training step.
+  void reset_peak() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    total_.peak_bytes = total_.current_bytes;
+    for (auto& [tag, usage] : by_tag_) {
+      usage.peak_bytes = usage.current_bytes;
+    }
+  }
+
+  // Writes one line per tag and a total, as a table of current and peak
+  // bytes.
+  void dump(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << std::left << std::setw(8) << "owner" << std::setw(12) << "role"
+        << std::right << std::setw(14) << "current" << std::setw(14) << "peak"
+        << "\n";
+    for (const auto& [tag, usage] : by_tag_) {
+      if (tag.owner == kNoMemoryOwner) {
+        out << std::left << std::setw(8) << "-";
+      } else {
+        out << std::left << std::setw(8) << tag.owner;
+      }
+      out << std::setw(12) << to_string(tag.role) << std::right
+          << std::setw(14) << usage.current_bytes << std::setw(14)
+          << usage.peak_bytes << "\n";
+    }
+    out << std::left << std::setw(20) << "total" << std::right
+        << std::setw(14) << total_.current_bytes << std::setw(14)
+        << total_.peak_bytes << "\n";
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  MemoryUsage total_;
+  std::map<MemoryTag, MemoryUsage> by_tag_;
+
+  static void add_(MemoryUsage& usage, size_t bytes) {
+    usage.current_bytes += bytes;
+    usage.peak_bytes = std::max(usage.peak_bytes, usage.current_bytes);
+  }
+};
+
+#endif  // MEMORY_TRACKER_HPP
@@ -1,44 +1,44 @@
 #ifndef STORAGE_HPP
 #define STORAGE_HPP
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdlib>
+#include <memory>
 #include <span>
 #include <stdexcept>
 
 #include "../context/devices.hpp"
-
-const size_t kAlignment = 64;
+#include "cpu_allocator.hpp"
 
 template <typename T, size_t Size, DeviceType Device>
 class Storage;
 
+// CPU storage is reference counted and copy-on-write: copies share the same
+// buffer, and the first write access through a shared Storage gives it a
+// private copy. Read access (the const overloads) never copies. The share
+// count is only checked, not claimed, on write, so Storages sharing a buffer
+// must not be written from different threads at the same time.
 template <typename T, size_t Size>
 class Storage<T, Size, DeviceType::CPU> {
  public:
-  Storage() {
-    // For CPU devices we align the memory to kAlignment bytes.
-    // This allows for better performance on SIMD operations.
-    data_ = (T*)std::aligned_alloc(kAlignment, Size * sizeof(T));
-  }
+  explicit Storage(const StorageOptions& options = {})
+      : buffer_(allocate_(options, options.tag)), options_(options) {}
 
-  explicit Storage(const Storage<T, Size, DeviceType::CPU>& other) {
-    data_ = (T*)std::aligned_alloc(kAlignment, Size * sizeof(T));
-    std::copy(other.data_, other.data_ + Size, data_);
-  }
+  explicit Storage(const Storage<T, Size, DeviceType::CPU>& other)
+      : buffer_(other.buffer_), options_(other.options_) {}
 
   explicit Storage(Storage<T, Size, DeviceType::CPU>&& other) noexcept
-      : data_(other.data_) {
-    other.data_ = nullptr;
-  }
+      : buffer_(std::move(other.buffer_)), options_(other.options_) {}
 
   Storage<T, Size, DeviceType::CPU>& operator=(
       const Storage<T, Size, DeviceType::CPU>& other) {
     if (this == &other) {
       return *this;
     }
-    std::copy(other.data_, other.data_ + Size, data_);
+    buffer_ = other.buffer_;
+    options_ = other.options_;
     return *this;
   }
 
@@ -47,28 +47,94 @@ class Storage<T, Size, DeviceType::CPU> {
     if (this == &other) {
       return *this;
     }
-    std::free(data_);
-    data_ = other.data_;
-    other.data_ = nullptr;
+    buffer_ = std::move(other.buffer_);
+    options_ = other.options_;
     return *this;
   }
 
   template <size_t Rows, size_t Cols>
     requires(Rows* Cols == Size)
   void set(std::array<std::array<T, Cols>, Rows>& values) {
+    T* data = get().data();
     for (size_t i = 0; i < Rows; ++i) {
       for (size_t j = 0; j < Cols; ++j) {
-        data_[i * Cols + j] = values[i][j];
+        data[i * Cols + j] = values[i][j];
       }
     }
   }
 
-  std::span<T, Size> get() const { return std::span<T, Size>(data_, Size); }
+  std::span<const T, Size> get() const {
+    return std::span<const T, Size>(pointer_(), Size);
+  }
+
+  // Write access: detaches from any other Storage sharing the buffer.
+  std::span<T, Size> get() {
+    if (buffer_.use_count() > 1) {
+      std::shared_ptr<Buffer> copy = allocate_(options_, buffer_->tag);
+      std::copy(pointer_(), pointer_() + Size, static_cast<T*>(copy->data));
+      buffer_ = std::move(copy);
+    }
+    return std::span<T, Size>(pointer_(), Size);
+  }
+
+  bool is_shared() const { return buffer_.use_count() > 1; }
+
+  bool shares_buffer_with(
+      const Storage<T, Size, DeviceType::CPU>& other) const {
+    return buffer_ == other.buffer_;
+  }
+
+  // The node the pages were actually bound to, or kAnyNumaNode.
+  int numa_node() const { return buffer_->numa_node; }
+
+  // Which kind of huge pages back this buffer, if any.
+  HugePages huge_pages() const { return buffer_->huge_pages; }
 
-  ~Storage() { std::free(data_); }
+  // The tag is a property of the buffer, so it is shared with every Storage
+  // sharing it and carried over to the private copy made on write.
+  MemoryTag memory_tag() const { return buffer_->tag; }
+
+  void set_memory_tag(const MemoryTag& tag) { buffer_->retag(tag); }
 
  private:
-  T* data_;
+  struct Buffer : CPUAllocation {
+    Buffer(const CPUAllocation& allocation,
+           const std::shared_ptr<MemoryTracker>& tracker, const MemoryTag& tag)
+        : CPUAllocation(allocation), tracker(tracker), tag(tag) {
+      if (tracker != nullptr) {
+        tracker->allocated(tag, bytes);
+      }
+    }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    ~Buffer() {
+      if (tracker != nullptr) {
+        tracker->released(tag, bytes);
+      }
+      cpu_free(*this);
+    }
+
+    void retag(const MemoryTag& new_tag) {
+      if (tracker != nullptr) {
+        tracker->retagged(tag, new_tag, bytes);
+      }
+      tag = new_tag;
+    }
+
+    std::shared_ptr<MemoryTracker> tracker;
+    MemoryTag tag;
+  };
+
+  std::shared_ptr<Buffer> buffer_;
+  StorageOptions options_;
+
+  static std::shared_ptr<Buffer> allocate_(const StorageOptions& options,
+                                           const MemoryTag& tag) {
+    return std::make_shared<Buffer>(cpu_allocate(Size * sizeof(T), options),
+                                    options.tracker, tag);
+  }
+
+  T* pointer_() const { return static_cast<T*>(buffer_->data); }
 };
 
 #endif  // STORAGE_HPP
@@ -3,17 +3,25 @@
 
 #include <array>
 #include <span>
+#include <utility>
 
 #include "../context/contexts.hpp"
 #include "storage.hpp"
+#include "tensor_view.hpp"
 
 template <ValidContext Context, int Rows, int Cols>
 class Tensor {
  public:
-  explicit Tensor(Context& ctx) : ctx_(ctx) {}
+  explicit Tensor(Context& ctx) : data_(ctx.storage_options()), ctx_(ctx) {}
+
+  // Copies share storage until one side is written (see Storage).
   explicit Tensor(const Tensor<Context, Rows, Cols>& other)
       : data_(other.data_), ctx_(other.ctx_) {}
 
+  // Takes the storage over, so that no other Tensor is left sharing it.
+  explicit Tensor(Tensor<Context, Rows, Cols>&& other) noexcept
+      : data_(std::move(other.data_)), ctx_(other.ctx_) {}
+
   Tensor<Context, Rows, Cols>& operator=(
       const Tensor<Context, Rows, Cols>& other) {
     if (this == &other) {
@@ -27,11 +35,69 @@ class Tensor {
     data_.set(values);
   }
 
-  std::span<float, Rows * Cols> get() const { return data_.get(); }
+  std::span<const float, Rows * Cols> get() const { return data_.get(); }
+
+  std::span<float, Rows * Cols> get() { return data_.get(); }
+
+  bool shares_storage_with(const Tensor<Context, Rows, Cols>& other) const {
+    return data_.shares_buffer_with(other.data_);
+  }
+
+  // See MemoryTracker. Tags follow the storage, not this Tensor object.
+  MemoryTag memory_tag() const { return data_.memory_tag(); }
+
+  void set_memory_tag(const MemoryTag& tag) { data_.set_memory_tag(tag); }
+
+  // Views for reading. These never copy, even if the storage is shared.
+  ConstTensorView<Context, Rows, Cols> view() const {
+    return ConstTensorView<Context, Rows, Cols>(get().data());
+  }
+
+  template <int Start, int Count>
+  ConstTensorView<Context, Count, Cols> rows() const {
+    return view().template rows<Start, Count>();
+  }
+
+  template <int Start, int Count>
+  ConstTensorView<Context, Rows, Count> cols() const {
+    return view().template cols<Start, Count>();
+  }
+
+  ConstTensorView<Context, 1, Cols> row(size_t i) const {
+    return view().row_view(i);
+  }
+
+  // Views for writing. These detach shared storage first so that the write
+  // is not seen by other tensors.
+  TensorView<Context, Rows, Cols> mutable_view() {
+    return TensorView<Context, Rows, Cols>(get().data());
+  }
+
+  template <int Start, int Count>
+  TensorView<Context, Count, Cols> mutable_rows() {
+    return mutable_view().template rows<Start, Count>();
+  }
+
+  template <int Start, int Count>
+  TensorView<Context, Rows, Count> mutable_cols() {
+    return mutable_view().template cols<Start, Count>();
+  }
+
+  TensorView<Context, 1, Cols> mutable_row(size_t i) {
+    return mutable_view().row_view(i);
+  }
+
+  HugePages huge_pages() const { return data_.huge_pages(); }
 
  private:
   Storage<float, Rows * Cols, Context::kDevice> data_;
   Context& ctx_;
 };
 
+// Gives every tensor in `tensors` the same memory tag.
+template <typename... Tensors>
+void set_memory_tag(const MemoryTag& tag, Tensors&... tensors) {
+  (tensors.set_memory_tag(tag), ...);
+}
+
 #endif  // TENSOR_HPP
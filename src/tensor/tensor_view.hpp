@@ -0,0 +1,120 @@
+#ifndef TENSOR_VIEW_HPP
+#define TENSOR_VIEW_HPP
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
+#include "../context/contexts.hpp"
+
+// Non-owning, read-only Rows x Cols window onto a row-major buffer.
+// Consecutive rows are `row_stride` floats apart, so a view can be a row slice
+// (contiguous) or a column slice (strided) of a larger tensor. Views do not
+// keep the buffer alive, and writing to a shared Tensor may move it to a new
+// buffer, so a view should not outlive the statement sequence it was created
+// for. Ops take their inputs as ConstTensorView and their outputs as
+// TensorView.
+template <ValidContext Context, int Rows, int Cols>
+class ConstTensorView {
+ public:
+  ConstTensorView() : data_(nullptr), row_stride_(Cols) {}
+
+  explicit ConstTensorView(const float* data, size_t row_stride = Cols)
+      : data_(data), row_stride_(row_stride) {}
+
+  const float* data() const { return data_; }
+
+  size_t row_stride() const { return row_stride_; }
+
+  bool is_contiguous() const { return Rows == 1 || row_stride_ == Cols; }
+
+  // Only contiguous views have a flat span; use row() or operator() on
+  // strided ones.
+  std::span<const float, Rows * Cols> get() const {
+    check_contiguous_();
+    return std::span<const float, Rows * Cols>(data_, Rows * Cols);
+  }
+
+  std::span<const float, Cols> row(size_t i) const {
+    return std::span<const float, Cols>(data_ + i * row_stride_, Cols);
+  }
+
+  const float& operator()(size_t i, size_t j) const {
+    return data_[i * row_stride_ + j];
+  }
+
+  template <int Start, int Count>
+    requires(Start >= 0 && Count > 0 && Start + Count <= Rows)
+  ConstTensorView<Context, Count, Cols> rows() const {
+    return ConstTensorView<Context, Count, Cols>(data_ + Start * row_stride_,
+                                                 row_stride_);
+  }
+
+  template <int Start, int Count>
+    requires(Start >= 0 && Count > 0 && Start + Count <= Cols)
+  ConstTensorView<Context, Rows, Count> cols() const {
+    return ConstTensorView<Context, Rows, Count>(data_ + Start, row_stride_);
+  }
+
+  ConstTensorView<Context, 1, Cols> row_view(size_t i) const {
+    return ConstTensorView<Context, 1, Cols>(data_ + i * row_stride_,
+                                             row_stride_);
+  }
+
+ protected:
+  const float* data_;
+  size_t row_stride_;
+
+  void check_contiguous_() const {
+    if (!is_contiguous()) {
+      throw std::logic_error("get() needs a contiguous view");
+    }
+  }
+};
+
+// Writable view. It converts to ConstTensorView, so it can be passed
+// wherever an op reads.
+template <ValidContext Context, int Rows, int Cols>
+class TensorView : public ConstTensorView<Context, Rows, Cols> {
+ public:
+  TensorView() = default;
+
+  explicit TensorView(float* data, size_t row_stride = Cols)
+      : ConstTensorView<Context, Rows, Cols>(data, row_stride) {}
+
+  // The pointer came in as float*, so casting the constness away is safe.
+  float* data() const { return const_cast<float*>(this->data_); }
+
+  std::span<float, Rows * Cols> get() const {
+    this->check_contiguous_();
+    return std::span<float, Rows * Cols>(data(), Rows * Cols);
+  }
+
+  std::span<float, Cols> row(size_t i) const {
+    return std::span<float, Cols>(data() + i * this->row_stride_, Cols);
+  }
+
+  float& operator()(size_t i, size_t j) const {
+    return data()[i * this->row_stride_ + j];
+  }
+
+  template <int Start, int Count>
+    requires(Start >= 0 && Count > 0 && Start + Count <= Rows)
+  TensorView<Context, Count, Cols> rows() const {
+    return TensorView<Context, Count, Cols>(data() + Start * this->row_stride_,
+                                            this->row_stride_);
+  }
+
+  template <int Start, int Count>
+    requires(Start >= 0 && Count > 0 && Start + Count <= Cols)
+  TensorView<Context, Rows, Count> cols() const {
+    return TensorView<Context, Rows, Count>(data() + Start, this->row_stride_);
+  }
+
+  TensorView<Context, 1, Cols> row_view(size_t i) const {
+    return TensorView<Context, 1, Cols>(data() + i * this->row_stride_,
+                                        this->row_stride_);
+  }
+};
+
+#endif  // TENSOR_VIEW_HPP
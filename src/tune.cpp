@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "context/contexts.hpp"
+#include "network/activation.hpp"
+#include "network/layer.hpp"
+#include "network/network.hpp"
+#include "network/tuning.hpp"
+#include "ops/autotune.hpp"
+
+// The demo network from demo.cpp. Add a function like this for every model
+// that should be tuned, and call it from main.
+void tune_demo_network(CPUContext& ctx, Autotuner& tuner, size_t threads) {
+  IdentityActivation<CPUContext, 4> act1(ctx);
+  IdentityLayer<CPUContext, 5, 4> layer1(ctx, act1);
+
+  IdentityActivation<CPUContext, 3> act2(ctx);
+  IdentityLayer<CPUContext, 4, 3> layer2(ctx, act2);
+
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>,
+          IdentityLayer<CPUContext, 5, 4>, IdentityLayer<CPUContext, 4, 3> >
+      network(ctx, loss_layer, layer1, layer2);
+
+  tune_network(ctx, network, tuner, threads);
+}
+
+// Usage: tune [cache file] [thread budget...]
+//
+// Tunes every shape of the listed models once per thread budget, and writes
+// the results to the cache file. The budgets should be the thread counts the
+// models will run with; they default to 1 and the number of hardware threads.
+int main(int argc, char** argv) {
+  const char* cache_path = argc > 1 ? argv[1] : "tuning_cache.txt";
+  std::vector<size_t> budgets;
+  for (int i = 2; i < argc; ++i) {
+    budgets.push_back(strtoul(argv[i], nullptr, 10));
+  }
+  if (budgets.empty()) {
+    budgets = {1, std::max(1u, std::thread::hardware_concurrency())};
+  }
+
+  Autotuner tuner(cache_path);
+  CPUContext ctx = CPUContext();
+  for (size_t threads : budgets) {
+    tune_demo_network(ctx, tuner, threads);
+  }
+
+  printf("Tuned %zu shapes for %s into %s\n", tuner.size(),
+         tuner.cpu_model().c_str(), cache_path);
+  return 0;
+}
@@ -3,8 +3,10 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <cmath>
 
 #include "../src/context/contexts.hpp"
+#include "../src/ops/fast_math.hpp"
 
 TEST(ActivationTest, IdentityActivationForward) {
   CPUContext ctx = CPUContext();
@@ -127,4 +129,111 @@ TEST(ActivationTest, SigmoidActivationForwardBackward) {
   for (size_t i = 0; i < 3; ++i) {
     EXPECT_NEAR(grad_z_out_span[i], expected_grad_z_out[i], 1e-5f);
   }
-}
\ No newline at end of file
+}
+
+TEST(ActivationTest, TanhActivationForwardBackward) {
+  CPUContext ctx = CPUContext();
+
+  TanhActivation<CPUContext, 3> tanh_act(ctx);
+
+  Tensor<CPUContext, 1, 3> input(ctx);
+  Tensor<CPUContext, 1, 3> output(ctx);
+
+  std::array<std::array<float, 3>, 1> input_values = {{-1.0f, 0.0f, 2.0f}};
+
+  input.set(input_values);
+
+  tanh_act.forward(input, output);
+
+  std::span<float, 3> output_span = output.get();
+  EXPECT_NEAR(output_span[0], -0.761594f, 1e-5f);
+  EXPECT_NEAR(output_span[1], 0.0f, 1e-5f);
+  EXPECT_NEAR(output_span[2], 0.964028f, 1e-5f);
+
+  Tensor<CPUContext, 1, 3> grad_a_in(ctx);
+  Tensor<CPUContext, 1, 3> grad_z_out(ctx);
+
+  std::array<std::array<float, 3>, 1> grad_a_in_values = {{1.0f, 0.5f, 0.2f}};
+
+  grad_a_in.set(grad_a_in_values);
+
+  tanh_act.backward(grad_a_in, grad_z_out);
+  std::span<float, 3> grad_z_out_span = grad_z_out.get();
+  std::array<float, 3> expected_grad_z_out = {0.419974f, 0.5f, 0.014130f};
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_NEAR(grad_z_out_span[i], expected_grad_z_out[i], 1e-5f);
+  }
+}
+
+// Maximum relative error of `approx` against `exact` on a fine grid over
+// [lb, ub].
+template <typename Approx, typename Exact>
+double max_relative_error(Approx approx, Exact exact, float lb, float ub) {
+  double max_error = 0.0;
+  for (float x = lb; x <= ub; x += 1.0f / 1024) {
+    double expected = exact(double(x));
+    double error = std::abs(approx(x) - expected);
+    if (expected != 0.0) {
+      error /= std::abs(expected);
+    }
+    max_error = std::max(max_error, error);
+  }
+  return max_error;
+}
+
+TEST(ActivationTest, FastMathErrorBounds) {
+  auto exp = [](double x) { return std::exp(x); };
+  auto sigmoid = [](double x) { return 1.0 / (1.0 + std::exp(-x)); };
+  auto tanh = [](double x) { return std::tanh(x); };
+
+  EXPECT_LT(max_relative_error(fast_exp, exp, -87.0f, 87.0f), 1e-5);
+  EXPECT_LT(max_relative_error(fast_sigmoid, sigmoid, -80.0f, 80.0f), 1e-5);
+  EXPECT_LT(max_relative_error(fast_tanh, tanh, -10.0f, 10.0f), 1e-5);
+  EXPECT_FLOAT_EQ(fast_tanh(1e-6f), 1e-6f);
+}
+
+TEST(ActivationTest, HardVariants) {
+  EXPECT_EQ(hard_sigmoid(-4.0f), 0.0f);
+  EXPECT_FLOAT_EQ(hard_sigmoid(1.5f), 0.75f);
+  EXPECT_EQ(hard_sigmoid(3.0f), 1.0f);
+  EXPECT_EQ(hard_tanh(-2.0f), -1.0f);
+  EXPECT_EQ(hard_tanh(0.25f), 0.25f);
+  EXPECT_EQ(hard_tanh(1.5f), 1.0f);
+}
+
+TEST(ActivationTest, MathModeFromContextOrActivation) {
+  CPUContext ctx = CPUContext();
+  ctx.set_math_mode(MathMode::kHard);
+
+  SigmoidActivation<CPUContext, 3> from_context(ctx);
+  SigmoidActivation<CPUContext, 3> precise(ctx, MathMode::kPrecise);
+  TanhActivation<CPUContext, 3> tanh_act(ctx);
+
+  Tensor<CPUContext, 1, 3> input(ctx);
+  std::array<std::array<float, 3>, 1> input_values = {{-4.0f, 1.5f, 2.0f}};
+  input.set(input_values);
+  Tensor<CPUContext, 1, 3> hard_output(ctx);
+  Tensor<CPUContext, 1, 3> precise_output(ctx);
+  Tensor<CPUContext, 1, 3> tanh_output(ctx);
+  from_context.forward(input, hard_output);
+  precise.forward(input, precise_output);
+  tanh_act.forward(input, tanh_output);
+
+  EXPECT_EQ(hard_output.get()[0], 0.0f);
+  EXPECT_FLOAT_EQ(hard_output.get()[1], 0.75f);
+  EXPECT_NEAR(precise_output.get()[0], 0.017986f, 1e-6f);
+  EXPECT_EQ(tanh_output.get()[0], -1.0f);
+  EXPECT_EQ(tanh_output.get()[2], 1.0f);
+
+  // Hard derivatives are constant on the linear part and zero when clamped.
+  Tensor<CPUContext, 1, 3> grad_a_in(ctx);
+  std::array<std::array<float, 3>, 1> grad_values = {{1.0f, 1.0f, 1.0f}};
+  grad_a_in.set(grad_values);
+  Tensor<CPUContext, 1, 3> grad_z_out(ctx);
+  from_context.backward(grad_a_in, grad_z_out);
+  EXPECT_EQ(grad_z_out.get()[0], 0.0f);
+  EXPECT_FLOAT_EQ(grad_z_out.get()[1], 1.0f / 6.0f);
+  tanh_act.backward(grad_a_in, grad_z_out);
+  EXPECT_EQ(grad_z_out.get()[0], 0.0f);
+  EXPECT_EQ(grad_z_out.get()[2], 0.0f);
+}
@@ -0,0 +1,196 @@
+#include "../src/network/multi_head_attention.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/ops/random.hpp"
+
+namespace {
+
+// Attention with the full score matrix, straight from the definition.
+std::vector<float> reference_attention(std::span<float> qkv, int T, int D,
+                                       int heads, bool causal) {
+  int dh = D / heads;
+  std::vector<float> out(T * D, 0.0f);
+  for (int h = 0; h < heads; ++h) {
+    for (int i = 0; i < T; ++i) {
+      std::vector<float> scores(T, -INFINITY);
+      float max_score = -INFINITY;
+      for (int j = 0; j < (causal ? i + 1 : T); ++j) {
+        float dot = 0.0f;
+        for (int d = 0; d < dh; ++d) {
+          dot += qkv[i * 3 * D + h * dh + d] * qkv[j * 3 * D + D + h * dh + d];
+        }
+        scores[j] = dot / std::sqrt(static_cast<float>(dh));
+        max_score = std::max(max_score, scores[j]);
+      }
+      float sum = 0.0f;
+      for (int j = 0; j < T; ++j) {
+        scores[j] = std::exp(scores[j] - max_score);
+        sum += scores[j];
+      }
+      for (int j = 0; j < T; ++j) {
+        for (int d = 0; d < dh; ++d) {
+          out[i * D + h * dh + d] +=
+              scores[j] / sum * qkv[j * 3 * D + 2 * D + h * dh + d];
+        }
+      }
+    }
+  }
+  return out;
+}
+
+template <int T, int D, int Heads, bool Causal>
+void expect_matches_reference(CPUContext& ctx) {
+  std::vector<float> qkv(T * 3 * D);
+  uniform_fill(ctx, std::span<float>(qkv), -2.0f, 2.0f, 5, 0);
+  std::vector<float> out(T * D);
+  std::vector<float> lse(Heads * T);
+  std::vector<float> row_sum(Heads * T);
+
+  flash_attention<T, D, Heads, Causal>(
+      ctx, std::span<float, T * 3 * D>(qkv), std::span<float, T * D>(out),
+      std::span<float, Heads * T>(lse), std::span<float, Heads * T>(row_sum));
+
+  std::vector<float> expected = reference_attention(qkv, T, D, Heads, Causal);
+  for (int i = 0; i < T * D; ++i) {
+    EXPECT_NEAR(out[i], expected[i], 1e-5f) << "at " << i;
+  }
+}
+
+}  // namespace
+
+TEST(AttentionTest, MatchesReference) {
+  CPUContext ctx(kAnyNumaNode);
+  expect_matches_reference<5, 8, 2, false>(ctx);
+  expect_matches_reference<5, 8, 2, true>(ctx);
+  // Longer than one tile, and not a multiple of the tile size.
+  expect_matches_reference<kAttentionTile * 2 + 7, 8, 4, false>(ctx);
+  expect_matches_reference<kAttentionTile * 2 + 7, 8, 4, true>(ctx);
+}
+
+TEST(AttentionTest, MatchesReferenceOnThreads) {
+  CPUContext ctx(kAnyNumaNode, 4);
+  expect_matches_reference<kAttentionTile * 3, 12, 3, true>(ctx);
+}
+
+TEST(AttentionTest, CausalOutputIgnoresLaterTokens) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(8);
+  MultiHeadAttention<CPUContext, 6, 4, 2, true> attention(ctx);
+
+  Tensor<CPUContext, 1, 24> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 8, 0);
+  Tensor<CPUContext, 1, 24> before(ctx);
+  attention.forward(input, before);
+  std::vector<float> expected(before.get().begin(), before.get().end());
+
+  // Changing the last token leaves every earlier output as it was.
+  input.get()[23] += 1.0f;
+  Tensor<CPUContext, 1, 24> after(ctx);
+  attention.forward(input, after);
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_FLOAT_EQ(after.get()[i], expected[i]) << "at " << i;
+  }
+}
+
+TEST(AttentionTest, GradientsMatchFiniteDifferences) {
+  CPUContext ctx(kAnyNumaNode, 2);
+  ctx.set_seed(6);
+  // Spans two key tiles, so the causal tile skipping is exercised too.
+  using AttentionT =
+      MultiHeadAttention<CPUContext, kAttentionTile + 3, 4, 2, true>;
+  AttentionT attention(ctx);
+
+  Tensor<CPUContext, 1, AttentionT::kIn> input(ctx);
+  Tensor<CPUContext, 1, AttentionT::kOut> output(ctx);
+  Tensor<CPUContext, 1, AttentionT::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, AttentionT::kIn> grad_input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 6, 0);
+  uniform_fill(ctx, grad_output.get(), -1.0f, 1.0f, 6, 1);
+  uniform_fill(ctx, attention.get_qkv_biases(), -0.5f, 0.5f, 6, 2);
+
+  auto loss = [&] {
+    attention.forward(input, output);
+    double total = 0.0;
+    for (int i = 0; i < AttentionT::kOut; ++i) {
+      total += output.get()[i] * grad_output.get()[i];
+    }
+    return total;
+  };
+  const float eps = 1e-2f;
+  auto numeric = [&](float& x) {
+    float saved = x;
+    x = saved + eps;
+    double plus = loss();
+    x = saved - eps;
+    double minus = loss();
+    x = saved;
+    return static_cast<float>((plus - minus) / (2 * eps));
+  };
+
+  loss();
+  attention.backward(grad_output, grad_input);
+  for (int i = 0; i < AttentionT::kIn; ++i) {
+    EXPECT_NEAR(grad_input.get()[i], numeric(input.get()[i]), 5e-3f)
+        << "input " << i;
+  }
+
+  // A learning rate of 1 moves each parameter by exactly minus its gradient.
+  std::vector<std::span<float>> params = {
+      attention.get_qkv_weights(), attention.get_qkv_biases(),
+      attention.get_out_weights(), attention.get_out_biases()};
+  std::vector<std::vector<float>> before;
+  for (std::span<float> param : params) {
+    before.emplace_back(param.begin(), param.end());
+  }
+  attention.update_parameters(1.0f);
+  std::vector<std::vector<float>> grads;
+  for (size_t p = 0; p < params.size(); ++p) {
+    grads.emplace_back(params[p].size());
+    for (size_t i = 0; i < params[p].size(); ++i) {
+      grads[p][i] = before[p][i] - params[p][i];
+    }
+    std::ranges::copy(before[p], params[p].begin());
+  }
+  for (size_t p = 0; p < params.size(); ++p) {
+    for (size_t i = 0; i < params[p].size(); ++i) {
+      EXPECT_NEAR(grads[p][i], numeric(params[p][i]), 5e-3f)
+          << "parameter " << p << " at " << i;
+    }
+  }
+}
+
+TEST(AttentionTest, ChainsThroughNetwork) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(3);
+
+  using AttentionT = MultiHeadAttention<CPUContext, 8, 4, 2>;
+  using DenseT = IdentityLayer<CPUContext, 8 * 4, 2>;
+  static_assert(ValidLayer<AttentionT, CPUContext>);
+
+  AttentionT attention(ctx);
+  IdentityActivation<CPUContext, 2> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 32, 2, CrossEntropyLossLayer<CPUContext, 2>, AttentionT,
+          DenseT>
+      network(ctx, loss_layer, attention, dense);
+
+  Tensor<CPUContext, 1, 32> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 3, 0);
+  Tensor<CPUContext, 1, 2> targets(ctx);
+  std::ranges::fill(targets.get(), 0.0f);
+
+  for (float value : network.forward(input).get()) {
+    EXPECT_TRUE(std::isfinite(value));
+  }
+  network.backward(targets);
+}
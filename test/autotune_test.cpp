@@ -0,0 +1,202 @@
+#include "../src/ops/autotune.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/network/tuning.hpp"
+#include "../src/ops/operations.hpp"
+#include "../src/ops/random.hpp"
+
+TEST(AutotuneTest, TunedMatmulMatchesFastor) {
+  CPUContext ctx(kAnyNumaNode, 2);
+  Autotuner tuner;
+
+  Tensor<CPUContext, 3, 4> A(ctx);
+  Tensor<CPUContext, 4, 5> B(ctx);
+  Tensor<CPUContext, 3, 5> expected(ctx);
+  Tensor<CPUContext, 3, 5> C(ctx);
+
+  std::span<float, 3 * 4> a = A.get();
+  for (size_t i = 0; i < a.size(); ++i) {
+    a[i] = 0.5f * i - 2.0f;
+  }
+  std::span<float, 4 * 5> b = B.get();
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = 1.0f - 0.25f * i;
+  }
+
+  matmul(ctx, A, B, expected);
+  ctx.set_autotuner(&tuner);
+  matmul(ctx, A, B, C);
+
+  EXPECT_TRUE(tuner.lookup("matmul 3x4x5 t2").has_value());
+  for (size_t i = 0; i < 3 * 5; ++i) {
+    EXPECT_FLOAT_EQ(C.get()[i], expected.get()[i]);
+  }
+
+  Tensor<CPUContext, 5, 3> Ct(ctx);
+  mattranspose(ctx, C, Ct);
+  EXPECT_TRUE(tuner.lookup("mattranspose 3x5 t2").has_value());
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      EXPECT_EQ(Ct.get()[j * 3 + i], C.get()[i * 5 + j]);
+    }
+  }
+}
+
+TEST(AutotuneTest, BlockedGemmMatchesReference) {
+  CPUContext ctx(kAnyNumaNode, 3);
+  const size_t M = 7, K = 37, N = 19;
+  std::vector<float> A(M * K), B(K * N), C(M * N), reference(M * N, 0.0f);
+  for (size_t i = 0; i < A.size(); ++i) {
+    A[i] = static_cast<float>(i % 11) - 5.0f;
+  }
+  for (size_t i = 0; i < B.size(); ++i) {
+    B[i] = static_cast<float>(i % 7) * 0.5f;
+  }
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t k = 0; k < K; ++k) {
+      for (size_t j = 0; j < N; ++j) {
+        reference[i * N + j] += A[i * K + k] * B[k * N + j];
+      }
+    }
+  }
+
+  blocked_gemm(ctx, A.data(), B.data(), C.data(), M, K, N, {4, 8, 8});
+  for (size_t i = 0; i < M * N; ++i) {
+    EXPECT_FLOAT_EQ(C[i], reference[i]);
+  }
+
+  // Single row, split over columns.
+  blocked_gemm(ctx, A.data(), B.data(), C.data(), 1, K, N, {4, 8, 8});
+  for (size_t j = 0; j < N; ++j) {
+    EXPECT_FLOAT_EQ(C[j], reference[j]);
+  }
+
+  // Accumulating adds the product to C on both paths.
+  blocked_gemm(ctx, A.data(), B.data(), C.data(), M, K, N, {4, 8, 8}, true);
+  blocked_gemm(ctx, A.data(), B.data(), C.data(), 1, K, N, {4, 8, 8}, true);
+  for (size_t i = 0; i < M * N; ++i) {
+    EXPECT_FLOAT_EQ(C[i], (i < N ? 3 : 2) * reference[i]);
+  }
+}
+
+TEST(AutotuneTest, MatmulAccumulates) {
+  CPUContext ctx(kAnyNumaNode, 2);
+  Autotuner tuner;
+
+  Tensor<CPUContext, 3, 4> A(ctx);
+  Tensor<CPUContext, 4, 5> B(ctx);
+  Tensor<CPUContext, 3, 5> product(ctx);
+  Tensor<CPUContext, 3, 5> C(ctx);
+  uniform_fill(ctx, A.get(), -1.0f, 1.0f, 4, 0);
+  uniform_fill(ctx, B.get(), -1.0f, 1.0f, 4, 1);
+  matmul(ctx, A, B, product);
+
+  std::ranges::fill(C.get(), 1.0f);
+  matmul(ctx, A, B, C, true);
+  ctx.set_autotuner(&tuner);
+  matmul(ctx, A, B, C, true);
+  for (size_t i = 0; i < 3 * 5; ++i) {
+    EXPECT_NEAR(C.get()[i], 1.0f + 2.0f * product.get()[i], 1e-5f);
+  }
+}
+
+TEST(AutotuneTest, KeysIncludeThreadBudget) {
+  CPUContext ctx(kAnyNumaNode, 4);
+  Autotuner tuner;
+  ctx.set_autotuner(&tuner);
+
+  Tensor<CPUContext, 1, 4> A(ctx);
+  Tensor<CPUContext, 4, 5> B(ctx);
+  Tensor<CPUContext, 1, 5> C(ctx);
+  uniform_fill(ctx, A.get(), -1.0f, 1.0f, 4, 0);
+  uniform_fill(ctx, B.get(), -1.0f, 1.0f, 4, 1);
+  matmul(ctx, A, B, C);
+  ctx.set_num_threads(1);
+  matmul(ctx, A, B, C);
+  EXPECT_TRUE(tuner.lookup("matmul 1x4x5 t4").has_value());
+  EXPECT_TRUE(tuner.lookup("matmul 1x4x5 t1").has_value());
+
+  // A single row on several threads ignores the tiles: one candidate per
+  // thread count above 1, next to Fastor and the single-thread tiles.
+  ctx.set_num_threads(4);
+  EXPECT_EQ(gemm_candidates(ctx, 1).size(), 1u + 3u + 1u + 1u);
+  EXPECT_EQ(gemm_candidates(ctx, 2).size(), 1u + 3u * 3u);
+}
+
+TEST(AutotuneTest, TunesNetworkForThreadBudget) {
+  CPUContext ctx = CPUContext();
+  Autotuner tuner;
+  IdentityActivation<CPUContext, 3> act(ctx);
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+  using DenseT = IdentityLayer<CPUContext, 5, 3>;
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>, DenseT>
+      network(ctx, loss_layer, DenseT(ctx, act));
+
+  tune_network(ctx, network, tuner, 2);
+  EXPECT_TRUE(tuner.lookup("matmul 1x5x3 t2").has_value());
+  EXPECT_FALSE(tuner.lookup("matmul 1x5x3 t1").has_value());
+  EXPECT_EQ(ctx.autotuner(), nullptr);
+  EXPECT_EQ(ctx.num_threads(), 1u);
+}
+
+TEST(AutotuneTest, CacheRoundTrip) {
+  std::string path = testing::TempDir() + "autotune_cache.txt";
+  std::remove(path.c_str());
+
+  {
+    Autotuner tuner(path);
+    tuner.tune("matmul 1x2x3", {{Kernel::kBlocked, 2, {8, 16, 32}}},
+               [](const KernelConfig&) {});
+  }
+
+  Autotuner reloaded(path);
+  std::optional<KernelConfig> config = reloaded.lookup("matmul 1x2x3");
+  ASSERT_TRUE(config.has_value());
+  EXPECT_EQ(config->kernel, Kernel::kBlocked);
+  EXPECT_EQ(config->threads, 2u);
+  EXPECT_EQ(config->tiles.m, 8u);
+  EXPECT_EQ(config->tiles.k, 16u);
+  EXPECT_EQ(config->tiles.n, 32u);
+  // Saving goes through a temporary file that is renamed into place.
+  EXPECT_FALSE(std::ifstream(path + ".tmp").good());
+  std::remove(path.c_str());
+}
+
+TEST(AutotuneTest, StampTracksEntries) {
+  Autotuner tuner;
+  Autotuner other;
+  uint64_t stamp = tuner.stamp();
+  EXPECT_NE(stamp, 0u);
+  EXPECT_NE(stamp, other.stamp());
+
+  // A cached config is dropped once the tuner's entries change.
+  TunedKernelCache cache;
+  int tunes = 0;
+  auto make_key = []() { return std::string("matmul 1x2x3 t1"); };
+  auto tune = [&](const std::string& key) {
+    ++tunes;
+    KernelConfig config;
+    tuner.record(key, config);
+    return config;
+  };
+  cached_kernel_config(cache, tuner, 1, make_key, tune);
+  cached_kernel_config(cache, tuner, 1, make_key, tune);
+  EXPECT_EQ(tunes, 1);
+  EXPECT_NE(tuner.stamp(), stamp);
+
+  tuner.record("matmul 1x2x3 t1", {Kernel::kBlocked, 1, {8, 8, 8}});
+  EXPECT_EQ(cached_kernel_config(cache, tuner, 1, make_key, tune).kernel,
+            Kernel::kBlocked);
+  EXPECT_EQ(tunes, 1);
+}
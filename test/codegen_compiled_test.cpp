@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "../src/context/contexts.hpp"
+#include "../src/ops/random.hpp"
+#include "codegen_fixture.hpp"
+// Written at build time by codegen_fixture_export.
+#include "codegen_fixture_forward.hpp"
+
+TEST(CodegenTest, GeneratedSourceMatchesForward) {
+  with_codegen_fixture([](CPUContext& ctx, auto& network) {
+    static_assert(generated::kIn == 6 && generated::kOut == 4);
+    for (uint64_t trial = 0; trial < 8; ++trial) {
+      Tensor<CPUContext, 1, generated::kIn> input(ctx);
+      uniform_fill(ctx, input.get(), -2.0f, 2.0f, 3, trial);
+      std::array<float, generated::kOut> output;
+      generated::fixture_forward(input.get().data(), output.data());
+      std::span<float, generated::kOut> expected =
+          network.forward(input).get();
+      for (int i = 0; i < generated::kOut; ++i) {
+        EXPECT_NEAR(output[i], expected[i], 1e-5f)
+            << "trial " << trial << " at " << i;
+      }
+    }
+  });
+}
@@ -0,0 +1,36 @@
+#ifndef CODEGEN_FIXTURE_HPP
+#define CODEGEN_FIXTURE_HPP
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/activation.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+
+// The network behind codegen_compiled_test. codegen_fixture_export builds it
+// to generate codegen_fixture_forward.hpp, and the test builds it again to
+// compare Network::forward with the generated function. It covers the
+// unrolled and the looped layer forms and every activation math mode.
+template <typename F>
+void with_codegen_fixture(F&& f) {
+  CPUContext ctx = CPUContext();
+  ctx.set_seed(3);
+
+  using ReLULayerT = ReLULayer<CPUContext, 6, 40>;
+  using TanhLayerT = Layer<CPUContext, 40, 32, TanhActivation<CPUContext, 32>>;
+  using FastSigmoidLayerT =
+      Layer<CPUContext, 32, 8, SigmoidActivation<CPUContext, 8>>;
+  using HardSigmoidLayerT =
+      Layer<CPUContext, 8, 4, SigmoidActivation<CPUContext, 4>>;
+  ReLUActivation<CPUContext, 40> act1(ctx);
+  TanhActivation<CPUContext, 32> act2(ctx, MathMode::kFast);
+  SigmoidActivation<CPUContext, 8> act3(ctx, MathMode::kFast);
+  SigmoidActivation<CPUContext, 4> act4(ctx, MathMode::kHard);
+  CrossEntropyLossLayer<CPUContext, 4> loss_layer(ctx);
+  Network<CPUContext, 6, 4, CrossEntropyLossLayer<CPUContext, 4>, ReLULayerT,
+          TanhLayerT, FastSigmoidLayerT, HardSigmoidLayerT>
+      network(ctx, loss_layer, ReLULayerT(ctx, act1), TanhLayerT(ctx, act2),
+              FastSigmoidLayerT(ctx, act3), HardSigmoidLayerT(ctx, act4));
+  f(ctx, network);
+}
+
+#endif  // CODEGEN_FIXTURE_HPP
@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+#include <fstream>
+
+#include "../src/codegen/inference_codegen.hpp"
+#include "codegen_fixture.hpp"
+
+// Writes the forward pass of the codegen fixture network, which CMake
+// compiles into the tests for codegen_compiled_test.
+int main(int argc, char** argv) {
+  const char* output_path =
+      argc > 1 ? argv[1] : "codegen_fixture_forward.hpp";
+
+  std::ofstream out(output_path);
+  if (!out) {
+    fprintf(stderr, "Cannot open %s\n", output_path);
+    return 1;
+  }
+  with_codegen_fixture([&](CPUContext&, auto& network) {
+    emit_inference_source(network, out, "fixture_forward");
+  });
+  return 0;
+}
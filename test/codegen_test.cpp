@@ -0,0 +1,96 @@
+#include "../src/codegen/inference_codegen.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+
+TEST(CodegenTest, FloatLiteralRoundTrips) {
+  EXPECT_EQ(float_literal(1.0f), "1.0f");
+  EXPECT_EQ(float_literal(-0.5f), "-0.5f");
+  for (float value : {0.1f, 3.14159265f, -1.0e-7f, 123456789.0f}) {
+    std::string literal = float_literal(value);
+    literal.pop_back();
+    EXPECT_EQ(std::strtof(literal.c_str(), nullptr), value);
+  }
+  EXPECT_EQ(float_literal(std::numeric_limits<float>::infinity()),
+            "std::numeric_limits<float>::infinity()");
+  EXPECT_EQ(float_literal(-std::numeric_limits<float>::infinity()),
+            "-std::numeric_limits<float>::infinity()");
+  EXPECT_EQ(float_literal(std::numeric_limits<float>::quiet_NaN()),
+            "std::numeric_limits<float>::quiet_NaN()");
+}
+
+TEST(CodegenTest, EmitsWeightsAndForwardPass) {
+  CPUContext ctx = CPUContext();
+
+  ReLUActivation<CPUContext, 3> act1(ctx);
+  ReLULayer<CPUContext, 2, 3> layer1(ctx, act1);
+  IdentityActivation<CPUContext, 1> act2(ctx);
+  IdentityLayer<CPUContext, 3, 1> layer2(ctx, act2);
+  CrossEntropyLossLayer<CPUContext, 1> loss_layer(ctx);
+  Network<CPUContext, 2, 1, CrossEntropyLossLayer<CPUContext, 1>,
+          ReLULayer<CPUContext, 2, 3>, IdentityLayer<CPUContext, 3, 1> >
+      network(ctx, loss_layer, layer1, layer2);
+
+  std::ostringstream out;
+  emit_inference_source(network, out, "predict");
+  std::string source = out.str();
+
+  EXPECT_NE(source.find("constexpr int kIn = 2;"), std::string::npos);
+  EXPECT_NE(source.find("constexpr int kOut = 1;"), std::string::npos);
+  EXPECT_NE(source.find("alignas(64) constexpr float kWeights0[6]"),
+            std::string::npos);
+  EXPECT_NE(source.find("alignas(64) constexpr float kBiases1[1]"),
+            std::string::npos);
+  EXPECT_NE(source.find("inline void predict(const float* input, float* "
+                        "output)"),
+            std::string::npos);
+  EXPECT_NE(source.find(float_literal(
+                network.get_layer<0>().get_weights()[4])),
+            std::string::npos);
+  // Only the hidden layer has a ReLU, and the last layer writes to output.
+  EXPECT_NE(source.find("a0[j] > 0.0f"), std::string::npos);
+  EXPECT_NE(source.find("output[0] = kBiases1[0]"), std::string::npos);
+}
+
+TEST(CodegenTest, EmitsActivationMathModes) {
+  CPUContext ctx = CPUContext();
+  ctx.set_math_mode(MathMode::kFast);
+
+  using TanhLayerT = Layer<CPUContext, 2, 3, TanhActivation<CPUContext, 3>>;
+  using SigmoidLayerT =
+      Layer<CPUContext, 3, 1, SigmoidActivation<CPUContext, 1>>;
+  TanhActivation<CPUContext, 3> act1(ctx);
+  SigmoidActivation<CPUContext, 1> act2(ctx, MathMode::kHard);
+  CrossEntropyLossLayer<CPUContext, 1> loss_layer(ctx);
+  Network<CPUContext, 2, 1, CrossEntropyLossLayer<CPUContext, 1>, TanhLayerT,
+          SigmoidLayerT>
+      network(ctx, loss_layer, TanhLayerT(ctx, act1),
+              SigmoidLayerT(ctx, act2));
+
+  std::ostringstream out;
+  emit_inference_source(network, out);
+  std::string source = out.str();
+  // The tanh layer follows the context, the sigmoid layer its own mode.
+  EXPECT_NE(source.find("inline float fast_tanh(float x)"), std::string::npos);
+  EXPECT_NE(source.find("a0[j] = fast_tanh(a0[j])"), std::string::npos);
+  EXPECT_NE(source.find("output[j] = hard_sigmoid(output[j])"),
+            std::string::npos);
+  // The kernels are copied from ops/fast_math.hpp.
+  EXPECT_NE(source.find("inline float fast_exp(float x)"), std::string::npos);
+
+  ctx.set_math_mode(MathMode::kPrecise);
+  std::ostringstream precise_out;
+  emit_inference_source(network, precise_out);
+  std::string precise = precise_out.str();
+  EXPECT_EQ(precise.find("= fast_tanh("), std::string::npos);
+  EXPECT_NE(precise.find("inline float hard_sigmoid"), std::string::npos);
+  EXPECT_NE(precise.find("a0[j] = std::tanh(a0[j])"), std::string::npos);
+}
@@ -0,0 +1,352 @@
+#include "../src/network/conv2d.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/network/pooling.hpp"
+#include "../src/ops/random.hpp"
+
+namespace {
+
+template <typename ConvT>
+std::vector<float> reference_conv(std::span<float> input,
+                                  std::span<float> weights,
+                                  std::span<float> biases) {
+  using G = typename ConvT::Geometry;
+  int filters = biases.size();
+  std::vector<float> output(ConvT::kOut);
+  for (int oy = 0; oy < G::kOutHeight; ++oy) {
+    for (int ox = 0; ox < G::kOutWidth; ++ox) {
+      for (int f = 0; f < filters; ++f) {
+        float sum = biases[f];
+        for (int ky = 0; ky < G::kKernel; ++ky) {
+          for (int kx = 0; kx < G::kKernel; ++kx) {
+            int y = oy * G::kStride - G::kPadding + ky * G::kDilation;
+            int x = ox * G::kStride - G::kPadding + kx * G::kDilation;
+            if (y < 0 || y >= G::kHeight || x < 0 || x >= G::kWidth) {
+              continue;
+            }
+            for (int c = 0; c < G::kChannels; ++c) {
+              sum += input[(y * G::kWidth + x) * G::kChannels + c] *
+                     weights[((ky * G::kKernel + kx) * G::kChannels + c) *
+                                 filters +
+                             f];
+            }
+          }
+        }
+        output[(oy * G::kOutWidth + ox) * filters + f] = sum;
+      }
+    }
+  }
+  return output;
+}
+
+template <typename ConvT>
+void expect_matches_reference(CPUContext& ctx, ConvT& conv) {
+  Tensor<CPUContext, 1, ConvT::kIn> input(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> output(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 7, 0);
+  uniform_fill(ctx, conv.get_biases(), -1.0f, 1.0f, 7, 1);
+
+  conv.forward(input, output);
+
+  std::vector<float> expected =
+      reference_conv<ConvT>(input.get(), conv.get_weights(), conv.get_biases());
+  for (int i = 0; i < ConvT::kOut; ++i) {
+    EXPECT_NEAR(output.get()[i], expected[i], 1e-4f) << "at " << i;
+  }
+}
+
+}  // namespace
+
+TEST(ConvTest, Geometry) {
+  using G = ConvGeometry<7, 5, 3, 3, 2, 1, 1>;
+  EXPECT_EQ(G::kOutHeight, 4);
+  EXPECT_EQ(G::kOutWidth, 3);
+  EXPECT_EQ(G::kPatch, 27);
+
+  using Dilated = ConvGeometry<7, 7, 1, 3, 1, 0, 2>;
+  EXPECT_EQ(Dilated::kOutHeight, 3);
+  EXPECT_EQ(Dilated::kOutWidth, 3);
+}
+
+TEST(ConvTest, MatchesReferenceConvolution) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(3);
+
+  IdentityActivation<CPUContext, 3 * 3 * 4> act(ctx);
+  Conv2D<CPUContext, 6, 5, 3, 4, 3, 2, 1> strided(ctx, act);
+  expect_matches_reference(ctx, strided);
+
+  IdentityActivation<CPUContext, 4 * 3 * 2> dilated_act(ctx);
+  Conv2D<CPUContext, 8, 7, 2, 2, 3, 1, 0, 2> dilated(ctx, dilated_act);
+  expect_matches_reference(ctx, dilated);
+
+  IdentityActivation<CPUContext, 4 * 4 * 5> pointwise_act(ctx);
+  Conv2D<CPUContext, 4, 4, 3, 5, 1> pointwise(ctx, pointwise_act);
+  static_assert(decltype(pointwise)::kPointwise);
+  expect_matches_reference(ctx, pointwise);
+}
+
+TEST(ConvTest, TiledIm2colMatchesReference) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(5);
+
+  // 40 * 40 output pixels of 3 * 3 * 16 inputs do not fit in a single tile,
+  // and do not divide evenly into tiles either.
+  using ConvT = Conv2D<CPUContext, 40, 40, 16, 2, 3, 1, 1>;
+  static_assert(im2col_tile_rows<ConvT::Geometry>() < ConvT::kPositions);
+  static_assert(ConvT::kPositions % im2col_tile_rows<ConvT::Geometry>() != 0);
+  IdentityActivation<CPUContext, ConvT::kOut> act(ctx);
+  ConvT conv(ctx, act);
+  expect_matches_reference(ctx, conv);
+
+  // Inference reuses one tile for the whole image, which leaves nothing for
+  // backward to work from.
+  conv.set_training(false);
+  expect_matches_reference(ctx, conv);
+  Tensor<CPUContext, 1, ConvT::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, ConvT::kIn> grad_input(ctx);
+  EXPECT_THROW(conv.backward(grad_output, grad_input), std::logic_error);
+}
+
+TEST(ConvTest, GradientsMatchFiniteDifferences) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(11);
+
+  using ConvT = Conv2D<CPUContext, 5, 4, 2, 3, 3, 2, 1, 1,
+                       SigmoidActivation<CPUContext, 3 * 2 * 3>>;
+  SigmoidActivation<CPUContext, ConvT::kOut> act(ctx);
+  ConvT conv(ctx, act);
+
+  Tensor<CPUContext, 1, ConvT::kIn> input(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> output(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, ConvT::kIn> grad_input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 11, 0);
+  uniform_fill(ctx, grad_output.get(), -1.0f, 1.0f, 11, 1);
+
+  // loss = sum(output * grad_output), so d loss / d output = grad_output.
+  auto loss = [&] {
+    conv.forward(input, output);
+    float total = 0.0f;
+    for (int i = 0; i < ConvT::kOut; ++i) {
+      total += output.get()[i] * grad_output.get()[i];
+    }
+    return total;
+  };
+
+  loss();
+  conv.backward(grad_output, grad_input);
+  std::vector<float> analytic(grad_input.get().begin(), grad_input.get().end());
+
+  const float eps = 1e-2f;
+  for (int i = 0; i < ConvT::kIn; ++i) {
+    float saved = input.get()[i];
+    input.get()[i] = saved + eps;
+    float plus = loss();
+    input.get()[i] = saved - eps;
+    float minus = loss();
+    input.get()[i] = saved;
+    EXPECT_NEAR(analytic[i], (plus - minus) / (2 * eps), 2e-3f) << "at " << i;
+  }
+
+  // A learning rate of 1 moves each weight by exactly minus its gradient.
+  std::vector<float> before(conv.get_weights().begin(),
+                            conv.get_weights().end());
+  std::vector<float> biases(conv.get_biases().begin(), conv.get_biases().end());
+  loss();
+  conv.backward(grad_output, grad_input);
+  conv.update_parameters(1.0f);
+  std::ranges::copy(biases, conv.get_biases().begin());
+  std::vector<float> weights_grad(before.size());
+  for (size_t i = 0; i < before.size(); ++i) {
+    weights_grad[i] = before[i] - conv.get_weights()[i];
+    conv.get_weights()[i] = before[i];
+  }
+  for (size_t i = 0; i < before.size(); ++i) {
+    conv.get_weights()[i] = before[i] + eps;
+    float plus = loss();
+    conv.get_weights()[i] = before[i] - eps;
+    float minus = loss();
+    conv.get_weights()[i] = before[i];
+    EXPECT_NEAR(weights_grad[i], (plus - minus) / (2 * eps), 2e-3f)
+        << "at " << i;
+  }
+}
+
+TEST(ConvTest, TiledBackwardMatchesReference) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(13);
+
+  // 81 output pixels of 3 * 3 * 64 inputs split into a full tile and a
+  // partial one.
+  using ConvT = Conv2D<CPUContext, 9, 9, 64, 2, 3, 1, 1>;
+  using G = ConvT::Geometry;
+  static_assert(ConvT::kTile < ConvT::kPositions);
+  static_assert(ConvT::kPositions % ConvT::kTile != 0);
+  IdentityActivation<CPUContext, ConvT::kOut> act(ctx);
+  ConvT conv(ctx, act);
+
+  Tensor<CPUContext, 1, ConvT::kIn> input(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> output(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, ConvT::kIn> grad_input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 13, 0);
+  uniform_fill(ctx, grad_output.get(), -1.0f, 1.0f, 13, 1);
+  std::vector<float> weights(conv.get_weights().begin(),
+                             conv.get_weights().end());
+
+  std::vector<float> expected_input(ConvT::kIn, 0.0f);
+  std::vector<float> expected_weights(weights.size(), 0.0f);
+  for (int p = 0; p < ConvT::kPositions; ++p) {
+    int oy = p / G::kOutWidth;
+    int ox = p % G::kOutWidth;
+    for (int ky = 0; ky < G::kKernel; ++ky) {
+      for (int kx = 0; kx < G::kKernel; ++kx) {
+        int y = oy - G::kPadding + ky;
+        int x = ox - G::kPadding + kx;
+        if (y < 0 || y >= G::kHeight || x < 0 || x >= G::kWidth) {
+          continue;
+        }
+        for (int c = 0; c < G::kChannels; ++c) {
+          int pixel = (y * G::kWidth + x) * G::kChannels + c;
+          int row = (ky * G::kKernel + kx) * G::kChannels + c;
+          for (int f = 0; f < 2; ++f) {
+            float grad = grad_output.get()[p * 2 + f];
+            expected_input[pixel] += grad * weights[row * 2 + f];
+            expected_weights[row * 2 + f] += grad * input.get()[pixel];
+          }
+        }
+      }
+    }
+  }
+
+  conv.forward(input, output);
+  conv.backward(grad_output, grad_input);
+  for (int i = 0; i < ConvT::kIn; ++i) {
+    EXPECT_NEAR(grad_input.get()[i], expected_input[i], 1e-4f) << "at " << i;
+  }
+  // A learning rate of 1 moves each weight by exactly minus its gradient.
+  conv.update_parameters(1.0f);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    EXPECT_NEAR(weights[i] - conv.get_weights()[i], expected_weights[i], 1e-3f)
+        << "at " << i;
+  }
+}
+
+TEST(ConvTest, MaxPool) {
+  CPUContext ctx = CPUContext();
+  MaxPool2D<CPUContext, 4, 4, 1, 2> pool(ctx);
+
+  Tensor<CPUContext, 1, 16> input(ctx);
+  std::array<std::array<float, 16>, 1> values = {
+      {{1, 2, 5, 6, 3, 4, 8, 7, -1, -2, 0, 0, -3, -4, 0, 9}}};
+  input.set(values);
+  Tensor<CPUContext, 1, 4> output(ctx);
+  pool.forward(input, output);
+  EXPECT_EQ(output.get()[0], 4.0f);
+  EXPECT_EQ(output.get()[1], 8.0f);
+  EXPECT_EQ(output.get()[2], -1.0f);
+  EXPECT_EQ(output.get()[3], 9.0f);
+
+  Tensor<CPUContext, 1, 4> grad_output(ctx);
+  std::array<std::array<float, 4>, 1> grads = {{{1, 2, 3, 4}}};
+  grad_output.set(grads);
+  Tensor<CPUContext, 1, 16> grad_input(ctx);
+  pool.backward(grad_output, grad_input);
+  std::array<float, 16> expected = {0, 0, 0, 0, 0, 1, 2, 0,
+                                    3, 0, 0, 0, 0, 0, 0, 4};
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(grad_input.get()[i], expected[i]) << "at " << i;
+  }
+}
+
+TEST(ConvTest, MaxPoolSkipsPaddingOnlyWindows) {
+  CPUContext ctx = CPUContext();
+  // With padding 2 only the centre of the 3 x 3 output sees the image.
+  MaxPool2D<CPUContext, 2, 2, 1, 2, 2, 2> pool(ctx);
+
+  Tensor<CPUContext, 1, 4> input(ctx);
+  std::array<std::array<float, 4>, 1> values = {{{-4, -1, -3, -2}}};
+  input.set(values);
+  Tensor<CPUContext, 1, 9> output(ctx);
+  pool.forward(input, output);
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(output.get()[i], i == 4 ? -1.0f : 0.0f) << "at " << i;
+  }
+
+  Tensor<CPUContext, 1, 9> grad_output(ctx);
+  std::ranges::fill(grad_output.get(), 1.0f);
+  Tensor<CPUContext, 1, 4> grad_input(ctx);
+  pool.backward(grad_output, grad_input);
+  std::array<float, 4> expected = {0, 1, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(grad_input.get()[i], expected[i]) << "at " << i;
+  }
+}
+
+TEST(ConvTest, AvgPoolKeepsChannelsApart) {
+  CPUContext ctx = CPUContext();
+  AvgPool2D<CPUContext, 2, 2, 2, 2> pool(ctx);
+
+  Tensor<CPUContext, 1, 8> input(ctx);
+  std::array<std::array<float, 8>, 1> values = {{{1, 10, 2, 20, 3, 30, 4, 40}}};
+  input.set(values);
+  Tensor<CPUContext, 1, 2> output(ctx);
+  pool.forward(input, output);
+  EXPECT_FLOAT_EQ(output.get()[0], 2.5f);
+  EXPECT_FLOAT_EQ(output.get()[1], 25.0f);
+
+  Tensor<CPUContext, 1, 2> grad_output(ctx);
+  std::array<std::array<float, 2>, 1> grads = {{{4, 8}}};
+  grad_output.set(grads);
+  Tensor<CPUContext, 1, 8> grad_input(ctx);
+  pool.backward(grad_output, grad_input);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_FLOAT_EQ(grad_input.get()[i], i % 2 == 0 ? 1.0f : 2.0f);
+  }
+}
+
+TEST(ConvTest, ChainsThroughNetwork) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(1);
+
+  using ConvT = Conv2D<CPUContext, 8, 8, 1, 4, 3, 1, 1, 1,
+                       ReLUActivation<CPUContext, 8 * 8 * 4>>;
+  using PoolT = MaxPool2D<CPUContext, 8, 8, 4, 2>;
+  using DenseT = IdentityLayer<CPUContext, 4 * 4 * 4, 3>;
+  static_assert(ValidLayer<ConvT, CPUContext>);
+  static_assert(ValidLayer<PoolT, CPUContext>);
+
+  ReLUActivation<CPUContext, ConvT::kOut> conv_act(ctx);
+  ConvT conv(ctx, conv_act);
+  PoolT pool(ctx);
+  IdentityActivation<CPUContext, 3> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+
+  Network<CPUContext, 64, 3, CrossEntropyLossLayer<CPUContext, 3>, ConvT,
+          PoolT, DenseT>
+      network(ctx, loss_layer, conv, pool, dense);
+
+  Tensor<CPUContext, 1, 64> input(ctx);
+  uniform_fill(ctx, input.get(), 0.0f, 1.0f, 1, 0);
+  Tensor<CPUContext, 1, 3> targets(ctx);
+  std::ranges::fill(targets.get(), 0.0f);
+
+  std::span<float, 3> output = network.forward(input).get();
+  for (float value : output) {
+    EXPECT_TRUE(std::isfinite(value));
+  }
+  network.backward(targets);
+}
@@ -0,0 +1,161 @@
+#include "../src/network/dropout.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/ops/random.hpp"
+
+namespace {
+
+bool kept(std::span<const uint32_t> mask, int i) {
+  return (mask[i / kDropoutMaskBits] >> (i % kDropoutMaskBits)) & 1u;
+}
+
+}  // namespace
+
+TEST(DropoutTest, BatchedPhiloxMatchesScalar) {
+  std::array<uint32_t, 32> words =
+      Philox4x32::generate_blocks<8>(42, 7, (uint64_t(1) << 32) - 3);
+  for (int b = 0; b < 8; ++b) {
+    Philox4x32::Block block =
+        Philox4x32::generate(42, 7, (uint64_t(1) << 32) - 3 + b);
+    for (int lane = 0; lane < 4; ++lane) {
+      EXPECT_EQ(words[4 * b + lane], block[lane]) << "block " << b;
+    }
+  }
+}
+
+TEST(DropoutTest, MaskFollowsPhiloxStream) {
+  CPUContext ctx = CPUContext(kAnyNumaNode, 4);
+  constexpr int kSize = 100;
+  Tensor<CPUContext, 1, kSize> input(ctx);
+  uniform_fill(ctx, input.get(), 1.0f, 2.0f, 1, 0);
+  Tensor<CPUContext, 1, kSize> output(ctx);
+  std::vector<uint32_t> mask(dropout_mask_words(kSize));
+  float rate = 0.25f;
+  dropout<kSize>(ctx, input.get(), output.get(), mask, rate, 3, 5, 64);
+
+  uint32_t threshold = dropout_threshold(rate);
+  for (int i = 0; i < kSize; ++i) {
+    uint32_t word = Philox4x32::generate(3, 5, (64 + i) / 4)[(64 + i) % 4];
+    ASSERT_EQ(kept(mask, i), word >= threshold) << "at " << i;
+    float expected = kept(mask, i) ? input.get()[i] / (1.0f - rate) : 0.0f;
+    EXPECT_FLOAT_EQ(output.get()[i], expected) << "at " << i;
+  }
+}
+
+TEST(DropoutTest, DropsAtRate) {
+  CPUContext ctx = CPUContext();
+  constexpr int kSize = 1 << 14;
+  Dropout<CPUContext, kSize> layer(ctx, 0.3f);
+  EXPECT_EQ(layer.mask().size(), size_t(kSize / 32));
+
+  Tensor<CPUContext, 1, kSize> input(ctx);
+  std::ranges::fill(input.get(), 1.0f);
+  Tensor<CPUContext, 1, kSize> output(ctx);
+  layer.forward(input, output);
+
+  int kept_count = 0;
+  for (uint32_t word : layer.mask()) {
+    kept_count += std::popcount(word);
+  }
+  EXPECT_NEAR(kept_count / float(kSize), 0.7f, 0.02f);
+  // Inverted scaling keeps the expected sum.
+  float sum = 0.0f;
+  for (float value : output.get()) {
+    sum += value;
+  }
+  EXPECT_NEAR(sum / kSize, 1.0f, 0.05f);
+}
+
+TEST(DropoutTest, BackwardUsesForwardMask) {
+  CPUContext ctx = CPUContext();
+  constexpr int kSize = 70;
+  Dropout<CPUContext, kSize> layer(ctx, 0.5f);
+  Tensor<CPUContext, 1, kSize> input(ctx);
+  std::ranges::fill(input.get(), 1.0f);
+  Tensor<CPUContext, 1, kSize> output(ctx);
+  layer.forward(input, output);
+
+  Tensor<CPUContext, 1, kSize> grad(ctx);
+  uniform_fill(ctx, grad.get(), -1.0f, 1.0f, 2, 0);
+  Tensor<CPUContext, 1, kSize> grad_input(ctx);
+  layer.backward(grad, grad_input);
+  for (int i = 0; i < kSize; ++i) {
+    float expected = kept(layer.mask(), i) ? 2.0f * grad.get()[i] : 0.0f;
+    EXPECT_FLOAT_EQ(grad_input.get()[i], expected) << "at " << i;
+    EXPECT_FLOAT_EQ(output.get()[i], kept(layer.mask(), i) ? 2.0f : 0.0f);
+  }
+}
+
+TEST(DropoutTest, FreshMaskPerStep) {
+  CPUContext ctx = CPUContext();
+  Dropout<CPUContext, 256> layer(ctx);
+  Tensor<CPUContext, 1, 256> input(ctx);
+  std::ranges::fill(input.get(), 1.0f);
+  Tensor<CPUContext, 1, 256> output(ctx);
+  layer.forward(input, output);
+  std::vector<uint32_t> first(layer.mask().begin(), layer.mask().end());
+  layer.forward(input, output);
+  EXPECT_FALSE(std::ranges::equal(first, layer.mask()));
+}
+
+TEST(DropoutTest, InferenceIsIdentity) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(9);
+
+  using DenseT = IdentityLayer<CPUContext, 8, 16>;
+  using DropoutT = Dropout<CPUContext, 16>;
+  using OutT = ReLULayer<CPUContext, 16, 4>;
+  IdentityActivation<CPUContext, 16> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  DropoutT drop(ctx, 0.9f);
+  ReLUActivation<CPUContext, 4> out_act(ctx);
+  OutT out(ctx, out_act);
+  CrossEntropyLossLayer<CPUContext, 4> loss_layer(ctx);
+  Network<CPUContext, 8, 4, CrossEntropyLossLayer<CPUContext, 4>, DenseT,
+          DropoutT, OutT>
+      network(ctx, loss_layer, dense, drop, out);
+  network.set_training(false);
+  EXPECT_FALSE(network.get_layer<1>().training());
+
+  Tensor<CPUContext, 1, 8> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 9, 0);
+  Tensor<CPUContext, 1, 16> hidden(ctx);
+  Tensor<CPUContext, 1, 4> expected(ctx);
+  network.get_layer<0>().forward(input, hidden);
+  network.get_layer<2>().forward(hidden, expected);
+
+  std::span<float, 4> output = network.forward(input).get();
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_FLOAT_EQ(output[i], expected.get()[i]);
+  }
+  // Backward copies the gradient into the caller's own buffer.
+  Tensor<CPUContext, 1, 16> grad_in(ctx);
+  uniform_fill(ctx, grad_in.get(), -1.0f, 1.0f, 9, 1);
+  Tensor<CPUContext, 1, 16> grad_out(ctx);
+  drop.set_training(false);
+  drop.backward(grad_in, grad_out);
+  EXPECT_NE(std::as_const(grad_out).get().data(),
+            std::as_const(grad_in).get().data());
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(grad_out.get()[i], grad_in.get()[i]);
+  }
+}
+
+TEST(DropoutTest, RejectsInvalidRate) {
+  CPUContext ctx = CPUContext();
+  EXPECT_THROW((Dropout<CPUContext, 4>(ctx, 1.0f)), std::invalid_argument);
+  EXPECT_THROW((Dropout<CPUContext, 4>(ctx, -0.1f)), std::invalid_argument);
+}
@@ -0,0 +1,289 @@
+#include "../src/network/embedding.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+
+namespace {
+
+// Row r of the table is filled with r + d / 10 in column d.
+template <typename EmbeddingT, int Rows, int Dim>
+void fill_table(EmbeddingT& embedding) {
+  std::span<float, Rows * Dim> table = embedding.get_weights();
+  for (int r = 0; r < Rows; ++r) {
+    for (int d = 0; d < Dim; ++d) {
+      table[r * Dim + d] = r + d / 10.0f;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(EmbeddingTest, GathersRows) {
+  CPUContext ctx = CPUContext();
+  Embedding<CPUContext, 10, 3, 3> embedding(ctx);
+  fill_table<decltype(embedding), 10, 3>(embedding);
+
+  Tensor<CPUContext, 1, 3> ids(ctx);
+  std::array<std::array<float, 3>, 1> values = {{{7, -1, 2}}};
+  ids.set(values);
+  Tensor<CPUContext, 1, 9> output(ctx);
+  embedding.forward(ids, output);
+
+  std::array<float, 9> expected = {7.0f, 7.1f, 7.2f, 0, 0, 0,
+                                   2.0f, 2.1f, 2.2f};
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_FLOAT_EQ(output.get()[i], expected[i]) << "at " << i;
+  }
+}
+
+TEST(EmbeddingTest, PoolsBags) {
+  CPUContext ctx = CPUContext();
+  Tensor<CPUContext, 1, 4> ids(ctx);
+  std::array<std::array<float, 4>, 1> values = {{{1, 4, -1, 4}}};
+  ids.set(values);
+  Tensor<CPUContext, 1, 2> output(ctx);
+
+  Embedding<CPUContext, 5, 2, 4, EmbeddingPooling::kSum> sum(ctx);
+  fill_table<decltype(sum), 5, 2>(sum);
+  sum.forward(ids, output);
+  EXPECT_FLOAT_EQ(output.get()[0], 9.0f);
+  EXPECT_FLOAT_EQ(output.get()[1], 9.3f);
+
+  // Padding does not count towards the mean.
+  Embedding<CPUContext, 5, 2, 4, EmbeddingPooling::kMean> mean(ctx);
+  fill_table<decltype(mean), 5, 2>(mean);
+  mean.forward(ids, output);
+  EXPECT_FLOAT_EQ(output.get()[0], 3.0f);
+  EXPECT_FLOAT_EQ(output.get()[1], 3.1f);
+}
+
+TEST(EmbeddingTest, RejectsOutOfRangeIds) {
+  CPUContext ctx = CPUContext();
+  Embedding<CPUContext, 5, 2> embedding(ctx);
+  Tensor<CPUContext, 1, 1> ids(ctx);
+  ids.get()[0] = 5.0f;
+  Tensor<CPUContext, 1, 2> output(ctx);
+  EXPECT_THROW(embedding.forward(ids, output), std::out_of_range);
+}
+
+TEST(EmbeddingTest, SparseGradientAndUpdate) {
+  CPUContext ctx = CPUContext();
+  Embedding<CPUContext, 1000, 2, 3, EmbeddingPooling::kMean> embedding(ctx);
+  std::vector<float> before(embedding.get_weights().begin(),
+                            embedding.get_weights().end());
+
+  Tensor<CPUContext, 1, 3> ids(ctx);
+  std::array<std::array<float, 3>, 1> values = {{{42, 7, 42}}};
+  ids.set(values);
+  Tensor<CPUContext, 1, 2> output(ctx);
+  embedding.forward(ids, output);
+
+  Tensor<CPUContext, 1, 2> grad_output(ctx);
+  std::array<std::array<float, 2>, 1> grads = {{{3, -6}}};
+  grad_output.set(grads);
+  Tensor<CPUContext, 1, 3> grad_ids(ctx);
+  embedding.backward(grad_output, grad_ids);
+
+  // Each id contributes a third of the gradient; 42 appears twice.
+  const SparseRowGrad& grad = embedding.sparse_grad();
+  EXPECT_EQ(grad.rows, (std::vector<int>{7, 42}));
+  std::vector<float> expected = {1, -2, 2, -4};
+  ASSERT_EQ(grad.values.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_FLOAT_EQ(grad.values[i], expected[i]);
+  }
+
+  embedding.update_parameters(0.5f);
+  std::span<float, 2000> table = embedding.get_weights();
+  for (int r = 0; r < 1000; ++r) {
+    for (int d = 0; d < 2; ++d) {
+      float change = before[r * 2 + d] - table[r * 2 + d];
+      if (r == 7) {
+        EXPECT_FLOAT_EQ(change, 0.5f * expected[d]);
+      } else if (r == 42) {
+        EXPECT_FLOAT_EQ(change, 0.5f * expected[2 + d]);
+      } else {
+        EXPECT_EQ(change, 0.0f) << "row " << r;
+      }
+    }
+  }
+}
+
+TEST(EmbeddingTest, AccumulatesSparseGradients) {
+  CPUContext ctx = CPUContext();
+  Embedding<CPUContext, 100, 2, 2, EmbeddingPooling::kSum> embedding(ctx);
+  embedding.set_gradient_accumulation(true);
+
+  Tensor<CPUContext, 1, 2> ids(ctx);
+  Tensor<CPUContext, 1, 2> output(ctx);
+  Tensor<CPUContext, 1, 2> grad_output(ctx);
+  Tensor<CPUContext, 1, 2> grad_ids(ctx);
+  std::array<std::array<std::array<float, 2>, 1>, 2> bags = {
+      {{{{30, 10}}}, {{{20, 30}}}}};
+  std::array<std::array<std::array<float, 2>, 1>, 2> grads = {
+      {{{{1, 2}}}, {{{-3, 5}}}}};
+  for (int b = 0; b < 2; ++b) {
+    ids.set(bags[b]);
+    grad_output.set(grads[b]);
+    embedding.forward(ids, output);
+    embedding.backward(grad_output, grad_ids);
+  }
+
+  const SparseRowGrad& grad = embedding.sparse_grad();
+  EXPECT_EQ(grad.rows, (std::vector<int>{10, 20, 30}));
+  EXPECT_EQ(grad.values, (std::vector<float>{1, 2, -3, 5, -2, 7}));
+
+  embedding.zero_grad();
+  EXPECT_TRUE(embedding.sparse_grad().rows.empty());
+}
+
+TEST(EmbeddingTest, LazyAdamOnlyTouchesSeenRows) {
+  CPUContext ctx = CPUContext();
+  Embedding<CPUContext, 50, 1> embedding(ctx);
+  embedding.enable_adam();
+  std::vector<float> before(embedding.get_weights().begin(),
+                            embedding.get_weights().end());
+
+  Tensor<CPUContext, 1, 1> ids(ctx);
+  Tensor<CPUContext, 1, 1> output(ctx);
+  Tensor<CPUContext, 1, 1> grad_output(ctx);
+  Tensor<CPUContext, 1, 1> grad_ids(ctx);
+  grad_output.get()[0] = 2.0f;
+
+  // Row 3 on steps 1 and 2, row 9 on step 3 only.
+  for (float id : {3.0f, 3.0f, 9.0f}) {
+    ids.get()[0] = id;
+    embedding.forward(ids, output);
+    embedding.backward(grad_output, grad_ids);
+    embedding.update_parameters(0.1f);
+  }
+
+  // A constant gradient makes every bias-corrected Adam step -lr * sign(g),
+  // up to epsilon.
+  std::span<float, 50> table = embedding.get_weights();
+  EXPECT_NEAR(before[3] - table[3], 0.2f, 1e-5f);
+  // Row 9 was only seen on global step 3: its moments are fresh, so with
+  // step-3 bias correction its first update is smaller than lr.
+  float m = 0.1f * 2.0f;
+  float v = 0.001f * 4.0f;
+  float expected = 0.1f * (m / (1.0f - std::pow(0.9f, 3))) /
+                   (std::sqrt(v / (1.0f - std::pow(0.999f, 3))) + 1e-8f);
+  EXPECT_NEAR(before[9] - table[9], expected, 1e-5f);
+  for (int r = 0; r < 50; ++r) {
+    if (r != 3 && r != 9) {
+      EXPECT_EQ(table[r], before[r]) << "row " << r;
+    }
+  }
+}
+
+TEST(EmbeddingTest, ChainsThroughNetwork) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(12);
+
+  using EmbeddingT = Embedding<CPUContext, 100, 4, 3, EmbeddingPooling::kSum>;
+  using DenseT = IdentityLayer<CPUContext, 4, 2>;
+  static_assert(ValidLayer<EmbeddingT, CPUContext>);
+
+  EmbeddingT embedding(ctx);
+  IdentityActivation<CPUContext, 2> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 3, 2, CrossEntropyLossLayer<CPUContext, 2>, EmbeddingT,
+          DenseT>
+      network(ctx, loss_layer, std::move(embedding), dense);
+
+  Tensor<CPUContext, 1, 3> ids(ctx);
+  std::array<std::array<float, 3>, 1> values = {{{5, 17, 99}}};
+  ids.set(values);
+  Tensor<CPUContext, 1, 2> targets(ctx);
+  std::ranges::fill(targets.get(), 0.0f);
+
+  for (float value : network.forward(ids).get()) {
+    EXPECT_TRUE(std::isfinite(value));
+  }
+  network.backward(targets);
+}
+
+TEST(EmbeddingTest, AccumulatedAdamStepUsesMeanGradient) {
+  CPUContext ctx = CPUContext();
+  using EmbeddingT = Embedding<CPUContext, 10, 2>;
+  using DenseT = IdentityLayer<CPUContext, 2, 2>;
+  EmbeddingT embedding(ctx);
+  embedding.enable_adam();
+  IdentityActivation<CPUContext, 2> dense_act(ctx);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 1, 2, CrossEntropyLossLayer<CPUContext, 2>, EmbeddingT,
+          DenseT>
+      network(ctx, loss_layer, std::move(embedding),
+              DenseT(ctx, dense_act));
+  EmbeddingT& table = network.get_layer<0>();
+  std::vector<float> before(table.get_weights().begin(),
+                            table.get_weights().end());
+
+  Tensor<CPUContext, 1, 1> ids(ctx);
+  ids.get()[0] = 4.0f;
+  Tensor<CPUContext, 1, 2> grad(ctx);
+  std::array<std::array<float, 2>, 1> grad_values = {{{0.5f, -2.0f}}};
+  grad.set(grad_values);
+  Tensor<CPUContext, 1, 1> grad_ids(ctx);
+
+  // Adam ignores the gradient's scale, so dividing the learning rate by the
+  // step count would halve the first update. Scaling the gradients keeps it
+  // at lr * sign(g).
+  EXPECT_THROW(network.step(0.1f, 2), std::logic_error);
+  network.set_gradient_accumulation(true);
+  for (int b = 0; b < 2; ++b) {
+    network.forward(ids);
+    table.backward(grad, grad_ids);
+  }
+  network.step(0.1f, 2);
+  EXPECT_NEAR(before[8] - table.get_weights()[8], 0.1f, 1e-4f);
+  EXPECT_NEAR(before[9] - table.get_weights()[9], -0.1f, 1e-4f);
+}
+
+TEST(EmbeddingTest, MovedIntoNetworkUpdatesInPlace) {
+  std::shared_ptr<MemoryTracker> tracker = std::make_shared<MemoryTracker>();
+  CPUContext ctx = CPUContext();
+  ctx.set_memory_tracker(tracker);
+  using EmbeddingT = Embedding<CPUContext, 1000, 16>;
+  using DenseT = IdentityLayer<CPUContext, 16, 2>;
+  EmbeddingT embedding(ctx);
+  embedding.enable_adam();
+  IdentityActivation<CPUContext, 2> dense_act(ctx);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 1, 2, CrossEntropyLossLayer<CPUContext, 2>, EmbeddingT,
+          DenseT>
+      network(ctx, loss_layer, std::move(embedding),
+              DenseT(ctx, dense_act));
+
+  // The table and both moment tables, 64000 bytes each.
+  MemoryUsage weights = tracker->usage({0, MemoryRole::kWeights});
+  MemoryUsage optimizer = tracker->usage({0, MemoryRole::kOptimizer});
+  EXPECT_EQ(weights.current_bytes, 64000u);
+  EXPECT_EQ(optimizer.current_bytes, 2 * 64000u);
+
+  Tensor<CPUContext, 1, 1> ids(ctx);
+  ids.get()[0] = 3.0f;
+  Tensor<CPUContext, 1, 16> grad(ctx);
+  std::ranges::fill(grad.get(), 1.0f);
+  Tensor<CPUContext, 1, 1> grad_ids(ctx);
+  network.forward(ids);
+  network.get_layer<0>().backward(grad, grad_ids);
+  network.step(0.1f);
+
+  // Nothing else held the buffers, so the update did not copy them.
+  EXPECT_EQ(tracker->usage({0, MemoryRole::kWeights}).peak_bytes, 64000u);
+  EXPECT_EQ(tracker->usage({0, MemoryRole::kOptimizer}).peak_bytes,
+            2 * 64000u);
+}
@@ -3,11 +3,15 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <vector>
 
 #include "../src/context/contexts.hpp"
 #include "../src/network/activation.hpp"
 #include "../src/network/uniform_distribution.hpp"
+#include "../src/ops/random.hpp"
 
 class MockUniformDistribution : public UniformDistribution<float> {
  public:
@@ -156,4 +160,140 @@ TEST(LayerTest, ReLULayerForwardBackward) {
   for (size_t i = 0; i < 1 * 3; ++i) {
     EXPECT_EQ(biases_span[i], expected_updated_biases[i]);
   }
-}
\ No newline at end of file
+}
+
+TEST(LayerTest, FrozenLayerMatchesUnfrozen) {
+  CPUContext ctx = CPUContext();
+  ctx.set_seed(7);
+
+  // Out is not a multiple of the panel width, so the last panel is padded.
+  ReLUActivation<CPUContext, 37> relu_act(ctx);
+  ReLULayer<CPUContext, 5, 37> layer(ctx, relu_act);
+  std::span<float, 37> biases = layer.get_biases();
+  for (size_t i = 0; i < 37; ++i) {
+    biases[i] = 0.01f * i - 0.1f;
+  }
+
+  Tensor<CPUContext, 1, 5> input(ctx);
+  std::array<std::array<float, 5>, 1> input_values = {
+      {{1.0f, -2.0f, 0.5f, 3.0f, -1.0f}}};
+  input.set(input_values);
+
+  Tensor<CPUContext, 1, 37> expected(ctx);
+  layer.forward(input, expected);
+
+  layer.freeze();
+  EXPECT_TRUE(layer.frozen());
+  Tensor<CPUContext, 1, 37> output(ctx);
+  layer.forward(input, output);
+  for (size_t i = 0; i < 37; ++i) {
+    EXPECT_NEAR(output.get()[i], expected.get()[i], 1e-5f);
+  }
+
+  // Reading the parameters unpacks them again but keeps the packing;
+  // writing them drops it.
+  const ReLULayer<CPUContext, 5, 37>& const_layer = layer;
+  EXPECT_FLOAT_EQ(const_layer.get_biases()[3], 0.01f * 3 - 0.1f);
+  EXPECT_TRUE(layer.frozen());
+  layer.get_biases()[0] = 100.0f;
+  EXPECT_FALSE(layer.frozen());
+  layer.forward(input, output);
+  EXPECT_GT(output.get()[0], 50.0f);
+
+  layer.freeze();
+  layer.unfreeze();
+  EXPECT_FALSE(layer.frozen());
+}
+
+TEST(LayerTest, FreezeReleasesUnpackedParameters) {
+  std::shared_ptr<MemoryTracker> tracker = std::make_shared<MemoryTracker>();
+  CPUContext ctx = CPUContext();
+  ctx.set_memory_tracker(tracker);
+  ReLUActivation<CPUContext, 37> relu_act(ctx);
+  ReLULayer<CPUContext, 5, 37> layer(ctx, relu_act);
+  layer.set_memory_owner(0);
+  std::vector<float> weights(layer.get_weights().begin(),
+                             layer.get_weights().end());
+
+  // 5 x 37 weights and 37 biases, each rounded up to 64 byte blocks.
+  MemoryTag tag = {0, MemoryRole::kWeights};
+  size_t unpacked_bytes = round_up(5 * 37 * 4, 64) + round_up(37 * 4, 64);
+  size_t packed_bytes = round_up(packed_size<5, 37>() * 4, 64);
+  EXPECT_EQ(tracker->usage(tag).current_bytes, unpacked_bytes);
+  layer.freeze();
+  EXPECT_EQ(tracker->usage(tag).current_bytes, packed_bytes);
+
+  // Reading rebuilds the unpacked copy, and freezing again drops it.
+  const ReLULayer<CPUContext, 5, 37>& const_layer = layer;
+  EXPECT_TRUE(std::ranges::equal(const_layer.get_weights(), weights));
+  EXPECT_EQ(tracker->usage(tag).current_bytes, unpacked_bytes + packed_bytes);
+  layer.freeze();
+  EXPECT_EQ(tracker->usage(tag).current_bytes, packed_bytes);
+
+  layer.unfreeze();
+  EXPECT_EQ(tracker->usage(tag).current_bytes, unpacked_bytes);
+  EXPECT_TRUE(std::ranges::equal(layer.get_weights(), weights));
+}
+
+TEST(LayerTest, AccumulatesGradientsAcrossMicroBatches) {
+  CPUContext ctx = CPUContext();
+  ReLUActivation<CPUContext, 3> relu_act(ctx);
+  ReLULayer<CPUContext, 4, 3> layer(ctx, relu_act);
+
+  std::array<Tensor<CPUContext, 1, 4>, 2> inputs = {
+      Tensor<CPUContext, 1, 4>(ctx), Tensor<CPUContext, 1, 4>(ctx)};
+  std::array<Tensor<CPUContext, 1, 3>, 2> grads = {
+      Tensor<CPUContext, 1, 3>(ctx), Tensor<CPUContext, 1, 3>(ctx)};
+  for (int b = 0; b < 2; ++b) {
+    uniform_fill(ctx, inputs[b].get(), -1.0f, 1.0f, 5, 2 * b);
+    uniform_fill(ctx, grads[b].get(), -1.0f, 1.0f, 5, 2 * b + 1);
+  }
+  Tensor<CPUContext, 1, 3> output(ctx);
+  Tensor<CPUContext, 1, 4> grad_input(ctx);
+
+  // A learning rate of 1 moves each parameter by exactly minus its gradient;
+  // the parameters are restored afterwards.
+  std::vector<float> weights(layer.get_weights().begin(),
+                             layer.get_weights().end());
+  std::vector<float> biases(layer.get_biases().begin(),
+                            layer.get_biases().end());
+  auto take_gradients = [&] {
+    layer.update_parameters(1.0f);
+    std::vector<float> gradients;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      gradients.push_back(weights[i] - layer.get_weights()[i]);
+    }
+    for (size_t i = 0; i < biases.size(); ++i) {
+      gradients.push_back(biases[i] - layer.get_biases()[i]);
+    }
+    std::ranges::copy(weights, layer.get_weights().begin());
+    std::ranges::copy(biases, layer.get_biases().begin());
+    return gradients;
+  };
+
+  std::vector<float> expected(weights.size() + biases.size(), 0.0f);
+  for (int b = 0; b < 2; ++b) {
+    layer.forward(inputs[b], output);
+    layer.backward(grads[b], grad_input);
+    std::vector<float> gradients = take_gradients();
+    for (size_t i = 0; i < expected.size(); ++i) {
+      expected[i] += gradients[i];
+    }
+  }
+
+  layer.set_gradient_accumulation(true);
+  EXPECT_TRUE(layer.gradient_accumulation());
+  for (int b = 0; b < 2; ++b) {
+    layer.forward(inputs[b], output);
+    layer.backward(grads[b], grad_input);
+  }
+  std::vector<float> accumulated = take_gradients();
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(accumulated[i], expected[i], 1e-6f) << "at " << i;
+  }
+
+  layer.zero_grad();
+  for (float gradient : take_gradients()) {
+    EXPECT_EQ(gradient, 0.0f);
+  }
+}
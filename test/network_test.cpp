@@ -2,6 +2,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <sstream>
+#include <vector>
+
 #include "../src/context/contexts.hpp"
 #include "../src/network/activation.hpp"
 #include "../src/network/layer.hpp"
@@ -34,3 +40,126 @@ TEST(NetworkTest, LargerNetworkCompiles) {
           IdentityLayer<CPUContext, 5, 4>, IdentityLayer<CPUContext, 4, 3> >
       network(ctx, loss_layer, layer1, layer2);
 }
+
+TEST(NetworkTest, FrozenNetworkForward) {
+  CPUContext ctx = CPUContext();
+
+  ReLUActivation<CPUContext, 4> act1(ctx);
+  ReLULayer<CPUContext, 5, 4> layer1(ctx, act1);
+
+  IdentityActivation<CPUContext, 3> act2(ctx);
+  IdentityLayer<CPUContext, 4, 3> layer2(ctx, act2);
+
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>,
+          ReLULayer<CPUContext, 5, 4>, IdentityLayer<CPUContext, 4, 3> >
+      network(ctx, loss_layer, layer1, layer2);
+
+  Tensor<CPUContext, 1, 5> input(ctx);
+  std::array<std::array<float, 5>, 1> input_values = {
+      {{0.5f, -1.0f, 2.0f, 0.0f, 1.5f}}};
+  input.set(input_values);
+
+  std::array<float, 3> expected;
+  std::ranges::copy(network.forward(input).get(), expected.begin());
+
+  network.freeze();
+  EXPECT_TRUE(network.get_layer<0>().frozen());
+  EXPECT_TRUE(network.get_layer<1>().frozen());
+  std::span<float, 3> output = network.forward(input).get();
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_NEAR(output[i], expected[i], 1e-5f);
+  }
+}
+
+TEST(NetworkTest, TracksMemoryPerLayer) {
+  std::shared_ptr<MemoryTracker> tracker = std::make_shared<MemoryTracker>();
+  CPUContext ctx = CPUContext();
+  ctx.set_memory_tracker(tracker);
+
+  ReLUActivation<CPUContext, 4> act1(ctx);
+  IdentityActivation<CPUContext, 3> act2(ctx);
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+
+  // The layers are passed as temporaries, so the network holds the only
+  // reference to their buffers. Named layers would keep sharing them, and
+  // the network's first write to each would allocate a private copy.
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>,
+          ReLULayer<CPUContext, 5, 4>, IdentityLayer<CPUContext, 4, 3> >
+      network(ctx, loss_layer, ReLULayer<CPUContext, 5, 4>(ctx, act1),
+              IdentityLayer<CPUContext, 4, 3>(ctx, act2));
+
+  // Every buffer so far belongs to a layer. Each weight matrix and bias
+  // vector is rounded up to a 64 byte block.
+  MemoryTag untagged;
+  EXPECT_EQ(tracker->usage(untagged).current_bytes, 0u);
+  EXPECT_EQ(tracker->usage({0, MemoryRole::kWeights}).current_bytes,
+            128u + 64u);
+  EXPECT_EQ(tracker->usage({1, MemoryRole::kWeights}).current_bytes,
+            64u + 64u);
+  EXPECT_EQ(tracker->usage({1, MemoryRole::kActivation}).current_bytes,
+            2 * 64u);
+  size_t setup_bytes = tracker->current_bytes();
+
+  Tensor<CPUContext, 1, 5> input(ctx);
+  Tensor<CPUContext, 1, 3> targets(ctx);
+  tracker->reset_peak();
+  network.forward(input);
+  network.backward(targets);
+
+  // The first layer's input gradient is a temporary of backward.
+  MemoryUsage scratch = tracker->usage({0, MemoryRole::kScratch});
+  EXPECT_EQ(scratch.current_bytes, 0u);
+  EXPECT_EQ(scratch.peak_bytes, 64u);
+  // Plus the untagged input and targets.
+  EXPECT_EQ(tracker->current_bytes(), setup_bytes + 2 * 64u);
+  EXPECT_EQ(tracker->peak_bytes(), setup_bytes + 3 * 64u);
+
+  std::ostringstream dump;
+  tracker->dump(dump);
+  EXPECT_NE(dump.str().find("weights"), std::string::npos);
+  EXPECT_NE(dump.str().find("total"), std::string::npos);
+}
+
+TEST(NetworkTest, StepAppliesMeanOfAccumulatedGradients) {
+  CPUContext ctx = CPUContext();
+  using DenseT = IdentityLayer<CPUContext, 4, 2>;
+  IdentityActivation<CPUContext, 2> act(ctx);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 4, 2, CrossEntropyLossLayer<CPUContext, 2>, DenseT>
+      network(ctx, loss_layer, DenseT(ctx, act));
+  DenseT& dense = network.get_layer<0>();
+  std::vector<float> before(dense.get_weights().begin(),
+                            dense.get_weights().end());
+
+  // x^T * g for two micro-batches, fed straight to the layer.
+  std::array<std::array<float, 4>, 2> x = {{{1, 2, 0, -1}, {0, 1, 3, 2}}};
+  std::array<std::array<float, 2>, 2> g = {{{1, -1}, {2, 4}}};
+  network.set_gradient_accumulation(true);
+  Tensor<CPUContext, 1, 4> input(ctx);
+  Tensor<CPUContext, 1, 2> grad(ctx);
+  Tensor<CPUContext, 1, 4> grad_input(ctx);
+  for (int b = 0; b < 2; ++b) {
+    std::ranges::copy(x[b], input.get().begin());
+    std::ranges::copy(g[b], grad.get().begin());
+    network.forward(input);
+    dense.backward(grad, grad_input);
+  }
+
+  network.step(0.5f, 2);
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      float mean = (x[0][i] * g[0][j] + x[1][i] * g[1][j]) / 2;
+      EXPECT_FLOAT_EQ(dense.get_weights()[i * 2 + j],
+                      before[i * 2 + j] - 0.5f * mean);
+    }
+  }
+  EXPECT_FLOAT_EQ(dense.get_biases()[1], -0.5f * 1.5f);
+
+  // The step cleared the gradients.
+  std::vector<float> after(dense.get_weights().begin(),
+                           dense.get_weights().end());
+  network.step(0.5f);
+  EXPECT_TRUE(std::ranges::equal(dense.get_weights(), after));
+}
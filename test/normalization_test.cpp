@@ -0,0 +1,301 @@
+#include "../src/network/normalization.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/conv2d.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/ops/random.hpp"
+
+namespace {
+
+// Checks a normalisation layer's input gradient against central differences
+// of loss = sum(output * grad_output).
+template <typename NormT>
+void expect_input_gradient_matches(CPUContext& ctx, NormT& norm) {
+  Tensor<CPUContext, 1, NormT::kIn> input(ctx);
+  Tensor<CPUContext, 1, NormT::kOut> output(ctx);
+  Tensor<CPUContext, 1, NormT::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, NormT::kIn> grad_input(ctx);
+  uniform_fill(ctx, input.get(), -2.0f, 2.0f, 31, 0);
+  uniform_fill(ctx, grad_output.get(), -1.0f, 1.0f, 31, 1);
+  uniform_fill(ctx, norm.get_gamma(), 0.5f, 1.5f, 31, 2);
+
+  auto loss = [&] {
+    norm.forward(input, output);
+    double total = 0.0;
+    for (int i = 0; i < NormT::kOut; ++i) {
+      total += output.get()[i] * grad_output.get()[i];
+    }
+    return total;
+  };
+  loss();
+  norm.backward(grad_output, grad_input);
+  std::vector<float> analytic(grad_input.get().begin(), grad_input.get().end());
+
+  const float eps = 1e-2f;
+  for (int i = 0; i < NormT::kIn; ++i) {
+    float saved = input.get()[i];
+    input.get()[i] = saved + eps;
+    double plus = loss();
+    input.get()[i] = saved - eps;
+    double minus = loss();
+    input.get()[i] = saved;
+    EXPECT_NEAR(analytic[i], (plus - minus) / (2 * eps), 2e-3f) << "at " << i;
+  }
+}
+
+}  // namespace
+
+TEST(NormalizationTest, WelfordIsStableForLargeMeans) {
+  CPUContext ctx = CPUContext();
+  constexpr int M = 1000;
+  std::vector<float> x(M * 2);
+  for (int i = 0; i < M; ++i) {
+    x[i * 2] = 1.0e4f + (i % 2 == 0 ? 0.5f : -0.5f);
+    x[i * 2 + 1] = (i % 2 == 0 ? 3.0f : 1.0f);
+  }
+  std::array<float, 2> mean;
+  std::array<float, 2> var;
+  welford_columns<M, 2>(ctx, std::span<float, M * 2>(x), mean, var);
+  EXPECT_NEAR(mean[0], 1.0e4f, 1e-2f);
+  EXPECT_NEAR(var[0], 0.25f, 1e-3f);
+  EXPECT_NEAR(mean[1], 2.0f, 1e-5f);
+  EXPECT_NEAR(var[1], 1.0f, 1e-4f);
+
+  std::array<float, M> row_mean;
+  std::array<float, M> row_var;
+  welford_rows<M, 2>(ctx, std::span<float, M * 2>(x), row_mean, row_var);
+  EXPECT_NEAR(row_mean[0], (1.0e4f + 0.5f + 3.0f) / 2, 1e-2f);
+}
+
+// Rows long enough to fill every lane several times over, plus a tail.
+TEST(NormalizationTest, WelfordRowsMatchTwoPassReference) {
+  CPUContext ctx = CPUContext();
+  constexpr int M = 3;
+  constexpr int N = 4 * kWelfordLanes + 5;
+  std::vector<float> x(M * N);
+  uniform_fill(ctx, x, -1.0f, 1.0f, 17, 0);
+  for (int j = 0; j < N; ++j) {
+    x[N + j] += 1.0e3f;
+  }
+  std::array<float, M> mean;
+  std::array<float, M> var;
+  welford_rows<M, N>(ctx, std::span<float, M * N>(x), mean, var);
+  for (int i = 0; i < M; ++i) {
+    double sum = 0.0;
+    for (int j = 0; j < N; ++j) {
+      sum += x[i * N + j];
+    }
+    double expected_mean = sum / N;
+    double squares = 0.0;
+    for (int j = 0; j < N; ++j) {
+      double d = x[i * N + j] - expected_mean;
+      squares += d * d;
+    }
+    EXPECT_NEAR(mean[i], expected_mean, 1e-4 * (1.0 + std::abs(expected_mean)));
+    EXPECT_NEAR(var[i], squares / N, 1e-4);
+  }
+}
+
+TEST(NormalizationTest, BatchNormNormalizesFeatures) {
+  CPUContext ctx = CPUContext();
+  BatchNorm<CPUContext, 3, 8> norm(ctx, 0.5f);
+
+  Tensor<CPUContext, 1, 24> input(ctx);
+  uniform_fill(ctx, input.get(), 5.0f, 9.0f, 1, 0);
+  Tensor<CPUContext, 1, 24> output(ctx);
+  norm.forward(input, output);
+
+  for (int j = 0; j < 3; ++j) {
+    float mean = 0.0f;
+    float square = 0.0f;
+    float input_mean = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+      mean += output.get()[i * 3 + j] / 8;
+      square += output.get()[i * 3 + j] * output.get()[i * 3 + j] / 8;
+      input_mean += input.get()[i * 3 + j] / 8;
+    }
+    EXPECT_NEAR(mean, 0.0f, 1e-5f);
+    EXPECT_NEAR(square, 1.0f, 1e-3f);
+    // Momentum 0.5 from a running mean of 0.
+    EXPECT_NEAR(norm.get_running_mean()[j], input_mean / 2, 1e-5f);
+  }
+
+  // Inference uses the running statistics instead.
+  norm.set_training(false);
+  std::ranges::fill(norm.get_running_mean(), 1.0f);
+  std::ranges::fill(norm.get_running_var(), 4.0f);
+  norm.forward(input, output);
+  EXPECT_NEAR(output.get()[0], (input.get()[0] - 1.0f) / 2.0f, 1e-4f);
+}
+
+TEST(NormalizationTest, BatchNormGradients) {
+  CPUContext ctx = CPUContext();
+  BatchNorm<CPUContext, 3, 5> norm(ctx);
+  expect_input_gradient_matches(ctx, norm);
+
+  norm.set_training(false);
+  uniform_fill(ctx, norm.get_running_var(), 0.5f, 2.0f, 31, 3);
+  expect_input_gradient_matches(ctx, norm);
+}
+
+TEST(NormalizationTest, BatchNormBackwardAccumulates) {
+  CPUContext ctx = CPUContext();
+  constexpr int M = 5, N = 3;
+  std::array<float, M * N> xhat;
+  std::array<float, M * N> grad_y;
+  std::array<float, N> inv_std;
+  std::array<float, N> gamma;
+  uniform_fill(ctx, xhat, -1.0f, 1.0f, 8, 0);
+  uniform_fill(ctx, grad_y, -1.0f, 1.0f, 8, 1);
+  uniform_fill(ctx, inv_std, 0.5f, 2.0f, 8, 2);
+  uniform_fill(ctx, gamma, 0.5f, 1.5f, 8, 3);
+
+  std::array<float, M * N> grad_x;
+  std::array<float, N> grad_gamma;
+  std::array<float, N> grad_beta;
+  batch_norm_backward<M, N>(ctx, xhat, inv_std, gamma, grad_y, grad_x,
+                            grad_gamma, grad_beta);
+
+  // dx only depends on this step; the parameter gradients add up.
+  std::array<float, M * N> accumulated_grad_x;
+  std::array<float, N> accumulated_gamma = grad_gamma;
+  std::array<float, N> accumulated_beta = grad_beta;
+  batch_norm_backward<M, N>(ctx, xhat, inv_std, gamma, grad_y,
+                            accumulated_grad_x, accumulated_gamma,
+                            accumulated_beta, true);
+  for (int i = 0; i < M * N; ++i) {
+    EXPECT_NEAR(accumulated_grad_x[i], grad_x[i], 1e-6f) << "at " << i;
+  }
+  for (int j = 0; j < N; ++j) {
+    EXPECT_NEAR(accumulated_gamma[j], 2 * grad_gamma[j], 1e-6f);
+    EXPECT_NEAR(accumulated_beta[j], 2 * grad_beta[j], 1e-6f);
+  }
+}
+
+TEST(NormalizationTest, LayerNormNormalizesRows) {
+  CPUContext ctx = CPUContext();
+  LayerNorm<CPUContext, 6, 2> norm(ctx);
+
+  Tensor<CPUContext, 1, 12> input(ctx);
+  uniform_fill(ctx, input.get(), -3.0f, 7.0f, 2, 0);
+  Tensor<CPUContext, 1, 12> output(ctx);
+  norm.forward(input, output);
+  for (int i = 0; i < 2; ++i) {
+    float mean = 0.0f;
+    float square = 0.0f;
+    for (int j = 0; j < 6; ++j) {
+      mean += output.get()[i * 6 + j] / 6;
+      square += output.get()[i * 6 + j] * output.get()[i * 6 + j] / 6;
+    }
+    EXPECT_NEAR(mean, 0.0f, 1e-5f);
+    EXPECT_NEAR(square, 1.0f, 1e-3f);
+  }
+}
+
+TEST(NormalizationTest, LayerNormGradients) {
+  CPUContext ctx = CPUContext();
+  LayerNorm<CPUContext, 5, 3> norm(ctx);
+  expect_input_gradient_matches(ctx, norm);
+}
+
+TEST(NormalizationTest, FoldsIntoPrecedingLayer) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(17);
+
+  using DenseT = IdentityLayer<CPUContext, 5, 4>;
+  using NormT = BatchNorm<CPUContext, 4>;
+  using OutT = ReLULayer<CPUContext, 4, 3>;
+  IdentityActivation<CPUContext, 4> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  NormT norm(ctx);
+  ReLUActivation<CPUContext, 3> out_act(ctx);
+  OutT out(ctx, out_act);
+  CrossEntropyLossLayer<CPUContext, 3> loss_layer(ctx);
+  Network<CPUContext, 5, 3, CrossEntropyLossLayer<CPUContext, 3>, DenseT,
+          NormT, OutT>
+      network(ctx, loss_layer, dense, norm, out);
+
+  NormT& trained = network.get_layer<1>();
+  uniform_fill(ctx, trained.get_gamma(), 0.5f, 2.0f, 17, 0);
+  uniform_fill(ctx, trained.get_beta(), -1.0f, 1.0f, 17, 1);
+  uniform_fill(ctx, trained.get_running_mean(), -1.0f, 1.0f, 17, 2);
+  uniform_fill(ctx, trained.get_running_var(), 0.2f, 3.0f, 17, 3);
+  network.set_training(false);
+
+  Tensor<CPUContext, 1, 5> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 17, 4);
+  std::vector<float> expected(3);
+  std::ranges::copy(network.forward(input).get(), expected.begin());
+
+  network.fold_batch_norms();
+  EXPECT_TRUE(trained.folded());
+  std::span<float, 3> output = network.forward(input).get();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(output[i], expected[i], 1e-5f);
+  }
+}
+
+TEST(NormalizationTest, FoldsIntoConv2D) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(19);
+
+  using ConvT = Conv2D<CPUContext, 5, 5, 2, 3, 3, 1, 1>;
+  IdentityActivation<CPUContext, ConvT::kOut> act(ctx);
+  ConvT conv(ctx, act);
+  BatchNorm<CPUContext, 3, ConvT::kPositions> norm(ctx);
+  uniform_fill(ctx, norm.get_gamma(), 0.5f, 2.0f, 19, 0);
+  uniform_fill(ctx, norm.get_beta(), -1.0f, 1.0f, 19, 1);
+  uniform_fill(ctx, norm.get_running_mean(), -1.0f, 1.0f, 19, 2);
+  uniform_fill(ctx, norm.get_running_var(), 0.2f, 3.0f, 19, 3);
+  norm.set_training(false);
+
+  Tensor<CPUContext, 1, ConvT::kIn> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 19, 4);
+  Tensor<CPUContext, 1, ConvT::kOut> features(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> expected(ctx);
+  conv.forward(input, features);
+  norm.forward(features, expected);
+
+  norm.fold_into(conv);
+  Tensor<CPUContext, 1, ConvT::kOut> output(ctx);
+  conv.forward(input, output);
+  for (int i = 0; i < ConvT::kOut; ++i) {
+    EXPECT_NEAR(output.get()[i], expected.get()[i], 1e-4f) << "at " << i;
+  }
+}
+
+template <typename NormT, typename LayerT>
+concept FoldsInto = requires(NormT& norm, LayerT& layer) {
+  norm.fold_into(layer);
+};
+
+TEST(NormalizationTest, FoldedBatchNormIsInferenceOnly) {
+  CPUContext ctx(kAnyNumaNode);
+  using ConvT = Conv2D<CPUContext, 5, 5, 2, 3, 3, 1, 1>;
+  IdentityActivation<CPUContext, ConvT::kOut> act(ctx);
+  ConvT conv(ctx, act);
+  BatchNorm<CPUContext, 3, ConvT::kPositions> norm(ctx);
+  norm.set_training(false);
+
+  // Six features over three filters would put two features in one column.
+  using SmallConvT = Conv2D<CPUContext, 4, 4, 2, 3, 3, 1, 1>;
+  using SplitNormT = BatchNorm<CPUContext, 6, SmallConvT::kPositions / 2>;
+  static_assert(SplitNormT::kIn == SmallConvT::kOut);
+  static_assert(!FoldsInto<SplitNormT, SmallConvT>);
+  static_assert(FoldsInto<decltype(norm), ConvT>);
+
+  norm.fold_into(conv);
+  Tensor<CPUContext, 1, ConvT::kOut> grad(ctx);
+  Tensor<CPUContext, 1, ConvT::kOut> grad_out(ctx);
+  EXPECT_THROW(norm.backward(grad, grad_out), std::logic_error);
+  EXPECT_THROW(norm.set_training(true), std::logic_error);
+  EXPECT_NO_THROW(norm.set_training(false));
+}
@@ -0,0 +1,94 @@
+#include "../src/ops/random.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/uniform_distribution.hpp"
+
+TEST(RandomTest, PhiloxKnownAnswers) {
+  // Known-answer vectors from the Random123 distribution.
+  Philox4x32::Block zeros = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+  Philox4x32::Block expected_zeros = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                      0x9b00dbd8};
+  EXPECT_EQ(zeros, expected_zeros);
+
+  Philox4x32::Block ones = Philox4x32::generate(
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+      {0xffffffff, 0xffffffff});
+  Philox4x32::Block expected_ones = {0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                     0x6d5451fd};
+  EXPECT_EQ(ones, expected_ones);
+}
+
+TEST(RandomTest, UniformFillIndependentOfThreadCount) {
+  CPUContext single = CPUContext();
+  CPUContext multi(kAnyNumaNode, 4);
+
+  // Large enough to split across the threads despite the grain.
+  std::vector<float> a(10001), b(10001);
+  uniform_fill(single, a, -1.0f, 1.0f, 42, 7);
+  uniform_fill(multi, b, -1.0f, 1.0f, 42, 7);
+  EXPECT_EQ(a, b);
+  for (float value : a) {
+    EXPECT_GE(value, -1.0f);
+    EXPECT_LT(value, 1.0f);
+  }
+
+  // An offset fill continues the same sequence.
+  std::vector<float> tail(9998);
+  uniform_fill(multi, tail, -1.0f, 1.0f, 42, 7, 3);
+  for (size_t i = 0; i < tail.size(); ++i) {
+    EXPECT_EQ(tail[i], a[i + 3]);
+  }
+}
+
+TEST(RandomTest, UniformFillMatchesPhiloxBlocks) {
+  CPUContext ctx = CPUContext();
+  // Several batches of blocks, with partial blocks at both ends.
+  std::vector<float> values(1000);
+  uniform_fill(ctx, values, 0.0f, 1.0f, 9, 2, 6);
+  for (size_t i = 0; i < values.size(); ++i) {
+    uint64_t element = i + 6;
+    Philox4x32::Block bits = Philox4x32::generate(9, 2, element / 4);
+    EXPECT_EQ(values[i], uint32_to_unit_float(bits[element % 4])) << "at " << i;
+  }
+}
+
+TEST(RandomTest, PhiloxDistributionSequentialMatchesFill) {
+  CPUContext ctx = CPUContext();
+  PhiloxDistribution sequential(ctx, 0.0f, 1.0f, 1234, 5);
+  PhiloxDistribution bulk(ctx, 0.0f, 1.0f, 1234, 5);
+
+  std::vector<float> filled(10);
+  bulk.fill(std::span<float>(filled).first(3));
+  bulk.fill(std::span<float>(filled).subspan(3));
+  for (float value : filled) {
+    EXPECT_EQ(sequential(), value);
+  }
+}
+
+TEST(RandomTest, SeededLayersAreReproducible) {
+  CPUContext ctx = CPUContext();
+  IdentityActivation<CPUContext, 3> act(ctx);
+
+  ctx.set_seed(99);
+  IdentityLayer<CPUContext, 4, 3> first(ctx, act);
+  IdentityLayer<CPUContext, 4, 3> second(ctx, act);
+
+  ctx.set_seed(99);
+  ctx.set_num_threads(3);
+  IdentityLayer<CPUContext, 4, 3> replayed(ctx, act);
+
+  std::span<float, 4 * 3> first_weights = first.get_weights();
+  std::span<float, 4 * 3> second_weights = second.get_weights();
+  std::span<float, 4 * 3> replayed_weights = replayed.get_weights();
+  bool differs = false;
+  for (size_t i = 0; i < 4 * 3; ++i) {
+    EXPECT_EQ(first_weights[i], replayed_weights[i]);
+    differs |= first_weights[i] != second_weights[i];
+  }
+  EXPECT_TRUE(differs);
+}
@@ -0,0 +1,214 @@
+#include "../src/network/recurrent.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/ops/fast_math.hpp"
+#include "../src/ops/random.hpp"
+
+namespace {
+
+float sigmoid_ref(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// Checks the input gradient and every parameter gradient of a recurrent layer
+// against central differences of loss = sum(output * grad_output).
+template <typename RNN>
+void expect_gradients_match(CPUContext& ctx, RNN& rnn,
+                            std::vector<std::span<float>> params) {
+  Tensor<CPUContext, 1, RNN::kIn> input(ctx);
+  Tensor<CPUContext, 1, RNN::kOut> output(ctx);
+  Tensor<CPUContext, 1, RNN::kOut> grad_output(ctx);
+  Tensor<CPUContext, 1, RNN::kIn> grad_input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 21, 0);
+  uniform_fill(ctx, grad_output.get(), -1.0f, 1.0f, 21, 1);
+  for (size_t p = 0; p < params.size(); ++p) {
+    uniform_fill(ctx, params[p], -0.5f, 0.5f, 21, 2 + p);
+  }
+
+  auto loss = [&] {
+    rnn.forward(input, output);
+    float total = 0.0f;
+    for (int i = 0; i < RNN::kOut; ++i) {
+      total += output.get()[i] * grad_output.get()[i];
+    }
+    return total;
+  };
+  const float eps = 1e-2f;
+  auto numeric = [&](float& x) {
+    float saved = x;
+    x = saved + eps;
+    float plus = loss();
+    x = saved - eps;
+    float minus = loss();
+    x = saved;
+    return (plus - minus) / (2 * eps);
+  };
+
+  loss();
+  rnn.backward(grad_output, grad_input);
+  for (int i = 0; i < RNN::kIn; ++i) {
+    EXPECT_NEAR(grad_input.get()[i], numeric(input.get()[i]), 2e-3f)
+        << "input " << i;
+  }
+
+  // A learning rate of 1 moves each parameter by exactly minus its gradient.
+  std::vector<std::vector<float>> before;
+  for (std::span<float> param : params) {
+    before.emplace_back(param.begin(), param.end());
+  }
+  rnn.update_parameters(1.0f);
+  std::vector<std::vector<float>> grads;
+  for (size_t p = 0; p < params.size(); ++p) {
+    grads.emplace_back(params[p].size());
+    for (size_t i = 0; i < params[p].size(); ++i) {
+      grads[p][i] = before[p][i] - params[p][i];
+    }
+    std::ranges::copy(before[p], params[p].begin());
+  }
+  for (size_t p = 0; p < params.size(); ++p) {
+    for (size_t i = 0; i < params[p].size(); ++i) {
+      EXPECT_NEAR(grads[p][i], numeric(params[p][i]), 2e-3f)
+          << "parameter " << p << " at " << i;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(RecurrentTest, LSTMSingleStepMatchesReference) {
+  CPUContext ctx(kAnyNumaNode);
+  LSTM<CPUContext, 1, 1, 1> lstm(ctx);
+  // Gates [i f g o], input weights then biases; recurrent weights are unused
+  // on the first step.
+  std::ranges::copy(std::array<float, 4>{0.5f, -1.0f, 2.0f, 1.5f},
+                    lstm.get_input_weights().begin());
+  std::ranges::copy(std::array<float, 4>{0.1f, 0.2f, -0.3f, 0.4f},
+                    lstm.get_biases().begin());
+
+  Tensor<CPUContext, 1, 1> input(ctx);
+  input.get()[0] = 0.8f;
+  Tensor<CPUContext, 1, 1> output(ctx);
+  lstm.forward(input, output);
+
+  float i = sigmoid_ref(0.5f * 0.8f + 0.1f);
+  float g = std::tanh(2.0f * 0.8f - 0.3f);
+  float o = sigmoid_ref(1.5f * 0.8f + 0.4f);
+  EXPECT_NEAR(output.get()[0], o * std::tanh(i * g), 1e-6f);
+}
+
+TEST(RecurrentTest, LSTMGatesFollowMathMode) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_math_mode(MathMode::kHard);
+  LSTM<CPUContext, 1, 1, 1> lstm(ctx);
+  std::ranges::copy(std::array<float, 4>{0.5f, -1.0f, 2.0f, 1.5f},
+                    lstm.get_input_weights().begin());
+  std::ranges::copy(std::array<float, 4>{0.1f, 0.2f, -0.3f, 0.4f},
+                    lstm.get_biases().begin());
+
+  Tensor<CPUContext, 1, 1> input(ctx);
+  input.get()[0] = 0.8f;
+  Tensor<CPUContext, 1, 1> output(ctx);
+  lstm.forward(input, output);
+
+  // g saturates at 1 under hard tanh.
+  float i = hard_sigmoid(0.5f * 0.8f + 0.1f);
+  float g = hard_tanh(2.0f * 0.8f - 0.3f);
+  float o = hard_sigmoid(1.5f * 0.8f + 0.4f);
+  EXPECT_EQ(g, 1.0f);
+  EXPECT_NEAR(output.get()[0], o * hard_tanh(i * g), 1e-6f);
+}
+
+TEST(RecurrentTest, LSTMGradientsMatchFiniteDifferences) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(4);
+  LSTM<CPUContext, 4, 3, 5> lstm(ctx);
+  expect_gradients_match(ctx, lstm,
+                         {lstm.get_input_weights(),
+                          lstm.get_recurrent_weights(), lstm.get_biases()});
+}
+
+TEST(RecurrentTest, GRUGradientsMatchFiniteDifferences) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(4);
+  GRU<CPUContext, 4, 3, 5> gru(ctx);
+  expect_gradients_match(
+      ctx, gru,
+      {gru.get_input_weights(), gru.get_recurrent_weights(), gru.get_biases(),
+       gru.get_hidden_biases()});
+}
+
+TEST(RecurrentTest, GradientsMatchFiniteDifferencesInEveryMathMode) {
+  for (MathMode mode : {MathMode::kFast, MathMode::kHard}) {
+    CPUContext ctx(kAnyNumaNode);
+    ctx.set_seed(4);
+    ctx.set_math_mode(mode);
+    LSTM<CPUContext, 4, 3, 5> lstm(ctx);
+    expect_gradients_match(ctx, lstm,
+                           {lstm.get_input_weights(),
+                            lstm.get_recurrent_weights(), lstm.get_biases()});
+    GRU<CPUContext, 4, 3, 5> gru(ctx);
+    expect_gradients_match(
+        ctx, gru,
+        {gru.get_input_weights(), gru.get_recurrent_weights(),
+         gru.get_biases(), gru.get_hidden_biases()});
+  }
+}
+
+TEST(RecurrentTest, LaterStepsSeeEarlierInputs) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(9);
+  GRU<CPUContext, 3, 2, 4> gru(ctx);
+
+  Tensor<CPUContext, 1, 6> input(ctx);
+  std::ranges::fill(input.get(), 0.0f);
+  Tensor<CPUContext, 1, 12> baseline(ctx);
+  gru.forward(input, baseline);
+  std::vector<float> expected(baseline.get().begin(), baseline.get().end());
+
+  // Changing only the first timestep changes every later hidden state.
+  input.get()[0] = 1.0f;
+  Tensor<CPUContext, 1, 12> output(ctx);
+  gru.forward(input, output);
+  for (int t = 0; t < 3; ++t) {
+    float change = 0.0f;
+    for (int j = 0; j < 4; ++j) {
+      change += std::abs(output.get()[t * 4 + j] - expected[t * 4 + j]);
+    }
+    EXPECT_GT(change, 0.0f) << "step " << t;
+  }
+}
+
+TEST(RecurrentTest, ChainsThroughNetwork) {
+  CPUContext ctx(kAnyNumaNode);
+  ctx.set_seed(2);
+
+  using LSTMT = LSTM<CPUContext, 5, 3, 4>;
+  using DenseT = IdentityLayer<CPUContext, 5 * 4, 2>;
+  static_assert(ValidLayer<LSTMT, CPUContext>);
+  static_assert(ValidLayer<GRU<CPUContext, 5, 3, 4>, CPUContext>);
+
+  LSTMT lstm(ctx);
+  IdentityActivation<CPUContext, 2> dense_act(ctx);
+  DenseT dense(ctx, dense_act);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 15, 2, CrossEntropyLossLayer<CPUContext, 2>, LSTMT,
+          DenseT>
+      network(ctx, loss_layer, lstm, dense);
+
+  Tensor<CPUContext, 1, 15> input(ctx);
+  uniform_fill(ctx, input.get(), -1.0f, 1.0f, 2, 0);
+  Tensor<CPUContext, 1, 2> targets(ctx);
+  std::ranges::fill(targets.get(), 0.0f);
+
+  for (float value : network.forward(input).get()) {
+    EXPECT_TRUE(std::isfinite(value));
+  }
+  network.backward(targets);
+}
@@ -0,0 +1,123 @@
+#include "../src/network/sequential.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/tensor/dynamic_tensor.hpp"
+
+// A const DynamicTensor only hands out read-only views of its buffer.
+static_assert(std::is_same_v<
+              decltype(std::declval<const DynamicTensor<CPUContext>&>().get()),
+              std::span<const float>>);
+
+TEST(SequentialTest, ParsesSpec) {
+  std::vector<LayerSpec> specs = parse_layer_specs(
+      "# two layer model\n"
+      "dense 4 3 relu\n"
+      "\n"
+      "dense 3 2 sigmoid  # output\n"
+      "dense 2 2 tanh\n");
+  ASSERT_EQ(specs.size(), 3u);
+  EXPECT_EQ(specs[0].in, 4u);
+  EXPECT_EQ(specs[0].out, 3u);
+  EXPECT_EQ(specs[0].activation, ActivationKind::kReLU);
+  EXPECT_EQ(specs[1].activation, ActivationKind::kSigmoid);
+  EXPECT_EQ(specs[2].activation, ActivationKind::kTanh);
+
+  EXPECT_THROW(parse_layer_specs("conv 4 3 relu"), std::invalid_argument);
+  EXPECT_THROW(parse_layer_specs("dense 4 relu"), std::invalid_argument);
+  EXPECT_THROW(parse_layer_specs("dense 4 3 softplus"), std::invalid_argument);
+
+  CPUContext ctx = CPUContext();
+  EXPECT_THROW(Sequential::from_spec(ctx, "dense 4 3 relu\ndense 2 1 relu"),
+               std::invalid_argument);
+}
+
+// Same setup as LayerTest.ReLULayerForwardBackward, but built from a spec.
+TEST(SequentialTest, ReLUDenseForwardBackward) {
+  CPUContext ctx = CPUContext();
+  Sequential model = Sequential::from_spec(ctx, "dense 2 3 relu");
+  EXPECT_EQ(model.planned_size(), 4u * 3u);
+
+  std::array<float, 6> initial_weights = {0.5f, 0.5f, -0.5f, -0.5f, 1.0f, 1.0f};
+  std::ranges::copy(initial_weights, model.layer(0).weights().begin());
+
+  std::array<float, 2> input = {1.0f, -2.0f};
+  std::span<const float> output = model.forward(input);
+  std::array<float, 3> expected_output = {1.5f, 0.0f, 0.0f};
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(output[i], expected_output[i]);
+  }
+
+  std::array<float, 3> grad_a_in = {-1.0f, -0.5f, 0.5f};
+  model.backward(grad_a_in);
+  model.update_parameters(0.5f);
+
+  std::array<float, 6> expected_weights = {1.0f, 0.5f, -0.5f,
+                                           -1.5f, 1.0f, 1.0f};
+  std::span<float> weights = model.layer(0).weights();
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_EQ(weights[i], expected_weights[i]);
+  }
+  std::array<float, 3> expected_biases = {0.5f, 0.0f, 0.0f};
+  std::span<float> biases = model.layer(0).biases();
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(biases[i], expected_biases[i]);
+  }
+}
+
+TEST(SequentialTest, ShapeSpecialisedKernelGivesSameResult) {
+  CPUContext ctx = CPUContext();
+  ctx.set_seed(3);
+  Sequential generic = Sequential::from_spec(ctx, "dense 5 4 identity");
+
+  register_matmul_shape<1, 5, 4>();
+  ctx.set_seed(3);
+  Sequential specialised = Sequential::from_spec(ctx, "dense 5 4 identity");
+
+  std::array<float, 5> input = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+  std::vector<float> expected(4);
+  std::ranges::copy(generic.forward(input), expected.begin());
+  std::span<const float> output = specialised.forward(input);
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_FLOAT_EQ(output[i], expected[i]);
+  }
+
+  // Shapes are resolved on construction.
+  EXPECT_TRUE(DynamicMatmul(1, 5, 4).specialised());
+  EXPECT_FALSE(DynamicMatmul(5, 1, 4).specialised());
+}
+
+// Tanh follows the context's math mode, like TanhActivation.
+TEST(SequentialTest, TanhDenseFollowsMathMode) {
+  CPUContext ctx = CPUContext();
+  Sequential model = Sequential::from_spec(ctx, "dense 2 2 tanh");
+  std::array<float, 4> weights = {0.5f, -1.0f, 2.0f, 0.25f};
+  std::ranges::copy(weights, model.layer(0).weights().begin());
+  std::array<float, 2> input = {1.0f, 0.5f};
+  std::array<float, 2> linear = {1.5f, -0.875f};
+
+  for (MathMode mode : {MathMode::kPrecise, MathMode::kFast, MathMode::kHard}) {
+    ctx.set_math_mode(mode);
+    std::span<const float> output = model.forward(input);
+    std::array<float, 2> expected;
+    tanh<1, 2>(ctx, linear, expected, mode);
+    for (size_t i = 0; i < 2; ++i) {
+      EXPECT_FLOAT_EQ(output[i], expected[i]);
+    }
+  }
+
+  // Hard tanh saturates the first unit, which then has no gradient.
+  std::array<float, 2> grad_a_in = {1.0f, 1.0f};
+  model.backward(grad_a_in);
+  model.update_parameters(1.0f);
+  EXPECT_EQ(model.layer(0).biases()[0], 0.0f);
+  EXPECT_FLOAT_EQ(model.layer(0).biases()[1], -1.0f);
+}
@@ -0,0 +1,101 @@
+#include "../src/tensor/storage.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "../src/tensor/cpu_allocator.hpp"
+
+TEST(StorageTest, HugePageStorage) {
+  // 8 MB, above the default huge page threshold.
+  Storage<float, 2 * 1024 * 1024, DeviceType::CPU> storage;
+  std::span<float, 2 * 1024 * 1024> data = storage.get();
+  EXPECT_EQ(reinterpret_cast<size_t>(data.data()) % kHugePageSize, 0u);
+  data[0] = 1.0f;
+  data[data.size() - 1] = 2.0f;
+  EXPECT_EQ(data[0] + data[data.size() - 1], 3.0f);
+  // Transparent huge pages are only reported, as requested, when the kernel
+  // honours madvise at all.
+  if (!transparent_huge_pages_enabled()) {
+    EXPECT_NE(storage.huge_pages(), HugePages::kTransparentRequested);
+  }
+
+  Storage<float, 16, DeviceType::CPU> small;
+  EXPECT_EQ(small.huge_pages(), HugePages::kNone);
+
+  StorageOptions no_huge_pages;
+  no_huge_pages.huge_page_threshold = 0;
+  Storage<float, 2 * 1024 * 1024, DeviceType::CPU> disabled(no_huge_pages);
+  EXPECT_EQ(disabled.huge_pages(), HugePages::kNone);
+}
+
+TEST(StorageTest, MemoryTrackerFollowsBuffers) {
+  std::shared_ptr<MemoryTracker> tracker = std::make_shared<MemoryTracker>();
+  StorageOptions options;
+  options.tracker = tracker;
+  options.tag = {2, MemoryRole::kWeights};
+  MemoryTag weights_tag = options.tag;
+  MemoryTag grad_tag = {2, MemoryRole::kGrad};
+  {
+    // 16 floats fill exactly one 64 byte aligned block.
+    Storage<float, 16, DeviceType::CPU> storage(options);
+    EXPECT_EQ(tracker->current_bytes(), 64u);
+
+    // Copies share the buffer until written, and the private copy keeps the
+    // tag of the buffer it was copied from.
+    Storage<float, 16, DeviceType::CPU> copy(storage);
+    EXPECT_EQ(tracker->current_bytes(), 64u);
+    copy.get();
+    EXPECT_EQ(tracker->current_bytes(), 128u);
+    EXPECT_EQ(tracker->usage(weights_tag).current_bytes, 128u);
+
+    copy.set_memory_tag(grad_tag);
+    EXPECT_EQ(copy.memory_tag(), grad_tag);
+    EXPECT_EQ(tracker->usage(weights_tag).current_bytes, 64u);
+    EXPECT_EQ(tracker->usage(grad_tag).current_bytes, 64u);
+    EXPECT_EQ(tracker->current_bytes(), 128u);
+  }
+  EXPECT_EQ(tracker->current_bytes(), 0u);
+  EXPECT_EQ(tracker->peak_bytes(), 128u);
+  EXPECT_EQ(tracker->usage(weights_tag).peak_bytes, 128u);
+  EXPECT_EQ(tracker->usage(grad_tag).peak_bytes, 64u);
+
+  tracker->reset_peak();
+  EXPECT_EQ(tracker->peak_bytes(), 0u);
+  EXPECT_EQ(tracker->breakdown().size(), 2u);
+}
+
+// Copy and move assignment take the options along with the buffer, so a
+// private copy made on write is allocated and tracked like the original.
+TEST(StorageTest, AssignmentCarriesOptions) {
+  std::shared_ptr<MemoryTracker> tracker = std::make_shared<MemoryTracker>();
+  StorageOptions options;
+  options.tracker = tracker;
+  Storage<float, 16, DeviceType::CPU> storage(options);
+  Storage<float, 16, DeviceType::CPU> copied;
+  Storage<float, 16, DeviceType::CPU> moved;
+  copied = storage;
+  copied.get();
+  EXPECT_EQ(tracker->current_bytes(), 128u);
+  moved = std::move(copied);
+  Storage<float, 16, DeviceType::CPU> shared(moved);
+  moved.get();
+  EXPECT_EQ(tracker->current_bytes(), 192u);
+}
+
+TEST(StorageTest, BuffersKeepTheirTrackerAlive) {
+  std::weak_ptr<MemoryTracker> weak_tracker;
+  std::optional<Storage<float, 16, DeviceType::CPU>> storage;
+  {
+    StorageOptions options;
+    options.tracker = std::make_shared<MemoryTracker>();
+    weak_tracker = options.tracker;
+    storage.emplace(options);
+  }
+  ASSERT_FALSE(weak_tracker.expired());
+  EXPECT_EQ(weak_tracker.lock()->current_bytes(), 64u);
+  storage.reset();
+  EXPECT_TRUE(weak_tracker.expired());
+}
@@ -0,0 +1,136 @@
+#include "../src/tensor/tensor.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <stdexcept>
+
+#include "../src/context/contexts.hpp"
+#include "../src/network/layer.hpp"
+#include "../src/network/network.hpp"
+#include "../src/ops/operations.hpp"
+
+TEST(TensorTest, CopiesShareUntilWritten) {
+  CPUContext ctx = CPUContext();
+
+  Tensor<CPUContext, 1, 3> a(ctx);
+  std::array<std::array<float, 3>, 1> values = {{1.0f, 2.0f, 3.0f}};
+  a.set(values);
+
+  Tensor<CPUContext, 1, 3> b(a);
+  EXPECT_TRUE(b.shares_storage_with(a));
+
+  b.get()[0] = 10.0f;
+  EXPECT_FALSE(b.shares_storage_with(a));
+  EXPECT_EQ(a.get()[0], 1.0f);
+  EXPECT_EQ(b.get()[0], 10.0f);
+  EXPECT_EQ(b.get()[2], 3.0f);
+}
+
+TEST(TensorTest, IdentityActivationDoesNotCopy) {
+  CPUContext ctx = CPUContext();
+  IdentityActivation<CPUContext, 3> identity_act(ctx);
+
+  Tensor<CPUContext, 1, 3> input(ctx);
+  Tensor<CPUContext, 1, 3> output(ctx);
+  identity_act.forward(input, output);
+  EXPECT_TRUE(output.shares_storage_with(input));
+}
+
+TEST(TensorTest, RowAndColumnSlices) {
+  CPUContext ctx = CPUContext();
+
+  Tensor<CPUContext, 3, 4> t(ctx);
+  std::array<std::array<float, 4>, 3> values = {
+      {{0.0f, 1.0f, 2.0f, 3.0f},
+       {4.0f, 5.0f, 6.0f, 7.0f},
+       {8.0f, 9.0f, 10.0f, 11.0f}}};
+  t.set(values);
+
+  ConstTensorView<CPUContext, 2, 4> rows = t.rows<1, 2>();
+  EXPECT_TRUE(rows.is_contiguous());
+  EXPECT_EQ(rows.get()[0], 4.0f);
+  EXPECT_EQ(rows.data(), t.get().data() + 4);
+
+  ConstTensorView<CPUContext, 3, 2> cols = t.cols<1, 2>();
+  EXPECT_FALSE(cols.is_contiguous());
+  EXPECT_EQ(cols(2, 1), 10.0f);
+
+  // Strided operands go through the row-wise / naive paths.
+  Tensor<CPUContext, 2, 3> B(ctx);
+  std::array<std::array<float, 3>, 2> b_values = {
+      {{1.0f, 0.0f, 2.0f}, {0.0f, 1.0f, -1.0f}}};
+  B.set(b_values);
+  Tensor<CPUContext, 3, 3> C(ctx);
+  matmul(ctx, cols, B.view(), C.mutable_view());
+  std::array<float, 9> expected = {1.0f, 2.0f, 0.0f,  5.0f, 6.0f,
+                                   4.0f, 9.0f, 10.0f, 8.0f};
+  for (size_t i = 0; i < 9; ++i) {
+    EXPECT_EQ(C.get()[i], expected[i]);
+  }
+
+  Tensor<CPUContext, 2, 3> colsT(ctx);
+  mattranspose(ctx, cols, colsT.mutable_view());
+  EXPECT_EQ(colsT.get()[2], 9.0f);
+  EXPECT_EQ(colsT.get()[3], 2.0f);
+
+  TensorView<CPUContext, 3, 2> out = t.mutable_cols<1, 2>();
+  matadd(ctx, out, out, out);
+  EXPECT_EQ(t.get()[1], 2.0f);
+  EXPECT_EQ(t.get()[0], 0.0f);
+  EXPECT_EQ(t.get()[3], 3.0f);
+}
+
+TEST(TensorTest, ViewsKeepCopyOnWrite) {
+  CPUContext ctx = CPUContext();
+
+  Tensor<CPUContext, 2, 3> a(ctx);
+  std::array<std::array<float, 3>, 2> values = {
+      {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}}};
+  a.set(values);
+
+  // Read-only views leave the buffer shared.
+  Tensor<CPUContext, 2, 3> b(a);
+  ConstTensorView<CPUContext, 2, 2> shared_cols = b.cols<1, 2>();
+  EXPECT_EQ(shared_cols(1, 0), 5.0f);
+  EXPECT_EQ(b.row(1)(0, 2), 6.0f);
+  EXPECT_TRUE(b.shares_storage_with(a));
+
+  // Writable views detach first, so the copy does not see the write.
+  b.mutable_cols<1, 2>()(1, 0) = 50.0f;
+  b.mutable_row(0)(0, 0) = 10.0f;
+  EXPECT_FALSE(b.shares_storage_with(a));
+  EXPECT_EQ(b.view()(1, 1), 50.0f);
+  EXPECT_EQ(b.view()(0, 0), 10.0f);
+  EXPECT_EQ(a.view()(1, 1), 5.0f);
+  EXPECT_EQ(a.view()(0, 0), 1.0f);
+
+  // A column slice has no flat span.
+  EXPECT_THROW(shared_cols.get(), std::logic_error);
+  TensorView<CPUContext, 2, 2> own_cols = b.mutable_cols<0, 2>();
+  EXPECT_THROW(own_cols.get(), std::logic_error);
+}
+
+TEST(TensorTest, NetworkRunsOnBatchRows) {
+  CPUContext ctx = CPUContext();
+
+  IdentityActivation<CPUContext, 2> act(ctx);
+  IdentityLayer<CPUContext, 3, 2> layer(ctx, act);
+  CrossEntropyLossLayer<CPUContext, 2> loss_layer(ctx);
+  Network<CPUContext, 3, 2, CrossEntropyLossLayer<CPUContext, 2>,
+          IdentityLayer<CPUContext, 3, 2> >
+      network(ctx, loss_layer, layer);
+
+  Tensor<CPUContext, 2, 3> batch(ctx);
+  std::array<std::array<float, 3>, 2> values = {
+      {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}};
+  batch.set(values);
+
+  std::span<float, 3 * 2> weights = layer.get_weights();
+  for (size_t row = 0; row < 2; ++row) {
+    Tensor<CPUContext, 1, 2>& output = network.forward(batch.row(row));
+    size_t weight_row = row == 0 ? 0 : 2;
+    EXPECT_EQ(output.get()[0], weights[weight_row * 2]);
+    EXPECT_EQ(output.get()[1], weights[weight_row * 2 + 1]);
+  }
+}
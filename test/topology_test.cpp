@@ -0,0 +1,82 @@
+#include "../src/context/topology.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "../src/context/contexts.hpp"
+#include "../src/context/parallel.hpp"
+#include "../src/tensor/storage.hpp"
+
+TEST(TopologyTest, ParseCpuList) {
+  std::vector<int> expected = {0, 1, 2, 3, 8, 10, 11};
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), expected);
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(TopologyTest, NodeBoundStorage) {
+  const CPUTopology& topology = CPUTopology::get();
+  if (topology.num_nodes() == 0) {
+    GTEST_SKIP() << "No NUMA information available.";
+  }
+  int node = topology.nodes()[0].id;
+
+  StorageOptions options;
+  options.numa_node = node;
+  Storage<float, 1000, DeviceType::CPU> storage(options);
+  EXPECT_EQ(storage.numa_node(), node);
+  std::span<float, 1000> data = storage.get();
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(data[i], 0.0f);
+  }
+  data[999] = 1.0f;
+
+  Storage<float, 1000, DeviceType::CPU> copy(storage);
+  EXPECT_EQ(copy.get()[999], 1.0f);
+}
+
+TEST(TopologyTest, ParallelForCoversRange) {
+  CPUContext ctx(kAnyNumaNode, 4);
+
+  std::vector<std::atomic<int>> visits(103);
+  parallel_for(ctx, visits.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      visits[i]++;
+    }
+  });
+
+  for (size_t i = 0; i < visits.size(); ++i) {
+    EXPECT_EQ(visits[i], 1);
+  }
+}
+
+TEST(TopologyTest, ParallelForReusesPooledWorkers) {
+  CPUContext ctx(kAnyNumaNode, 4);
+  ThreadPool* pool = ctx.thread_pool();
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool->num_workers(), 3u);
+
+  // Copies share the pool, and a lower thread count keeps it.
+  CPUContext copy = ctx;
+  copy.set_num_threads(2);
+  EXPECT_EQ(copy.thread_pool(), pool);
+
+  // Below two grains the range runs inline as a single chunk.
+  std::vector<std::pair<size_t, size_t>> chunks;
+  parallel_for(ctx, 100, 64, [&](size_t begin, size_t end) {
+    chunks.emplace_back(begin, end);
+  });
+  ASSERT_EQ(chunks.size(), 1u);
+  EXPECT_EQ(chunks[0], std::make_pair(size_t{0}, size_t{100}));
+
+  // A nested call runs inline instead of waiting on the busy pool.
+  std::atomic<int> visits = 0;
+  parallel_for(ctx, 4, [&](size_t begin, size_t end) {
+    parallel_for(ctx, 4, [&](size_t inner_begin, size_t inner_end) {
+      visits += (end - begin) * (inner_end - inner_begin);
+    });
+  });
+  EXPECT_EQ(visits, 16);
+}